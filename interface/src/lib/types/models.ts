@@ -112,6 +112,8 @@ export type OTAStatus = {
 	progress: number;
 	bytes_written?: number;
 	total_bytes?: number;
+	network_rate?: number;
+	flash_rate?: number;
 	error: string;
 };
 
@@ -0,0 +1,76 @@
+#include "BodyStream.h"
+
+BodyStream::BodyStream(PsychicRequest *request) :
+  _request(request),
+  _remaining(request->contentLength()),
+  _pos(0),
+  _length(0),
+  _failed(false)
+{}
+
+bool BodyStream::_fill()
+{
+  //still got some left?
+  if (_pos < _length)
+    return true;
+
+  if (_remaining == 0 || _failed)
+    return false;
+
+  size_t wanted = std::min(sizeof(_buffer), _remaining);
+
+  int received;
+  do {
+    received = httpd_req_recv(_request->request(), (char *)_buffer, wanted);
+  } while (received == HTTPD_SOCK_ERR_TIMEOUT);
+
+  if (received <= 0)
+  {
+    ESP_LOGE(PH_TAG, "Failed to receive data.");
+    _failed = true;
+    return false;
+  }
+
+  _remaining -= received;
+  _pos = 0;
+  _length = received;
+
+  return true;
+}
+
+int BodyStream::available()
+{
+  return (_length - _pos) + _remaining;
+}
+
+int BodyStream::read()
+{
+  if (!_fill())
+    return -1;
+
+  return _buffer[_pos++];
+}
+
+int BodyStream::peek()
+{
+  if (!_fill())
+    return -1;
+
+  return _buffer[_pos];
+}
+
+size_t BodyStream::readBytes(char *buffer, size_t length)
+{
+  size_t count = 0;
+
+  while (count < length && _fill())
+  {
+    size_t blockSize = std::min(_length - _pos, length - count);
+
+    memcpy(buffer + count, _buffer + _pos, blockSize);
+    _pos += blockSize;
+    count += blockSize;
+  }
+
+  return count;
+}
@@ -0,0 +1,41 @@
+#ifndef BodyStream_h
+#define BodyStream_h
+
+#include "PsychicRequest.h"
+#include <Stream.h>
+
+#ifndef BODY_STREAM_BUFFER_SIZE
+  #define BODY_STREAM_BUFFER_SIZE 256
+#endif
+
+/*
+* Read only Stream over the request body, fed straight from httpd_req_recv().
+* Reads up to the Content-Length, which the handler checks against its limit
+* before building the stream.
+*/
+
+class BodyStream : public Stream
+{
+  private:
+    PsychicRequest *_request;
+    size_t _remaining;
+    uint8_t _buffer[BODY_STREAM_BUFFER_SIZE];
+    size_t _pos;
+    size_t _length;
+    bool _failed;
+
+    bool _fill();
+
+  public:
+    BodyStream(PsychicRequest *request);
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t readBytes(char *buffer, size_t length) override;
+    size_t write(uint8_t c) override { return 0; }
+
+    bool failed() { return _failed; } // the socket gave up on us
+};
+
+#endif
@@ -5,7 +5,8 @@ ChunkPrinter::ChunkPrinter(PsychicResponse *response, uint8_t *buffer, size_t le
   _response(response),
   _buffer(buffer),
   _length(len),
-  _pos(0)
+  _pos(0),
+  _sent(0)
 {}
 
 ChunkPrinter::~ChunkPrinter()
@@ -25,6 +26,8 @@ size_t ChunkPrinter::write(uint8_t c)
 	
     if (err != ESP_OK)
       return 0;
+
+    _sent += _length;
   }    
 
   _buffer[_pos] = c;
@@ -50,6 +53,8 @@ size_t ChunkPrinter::write(const uint8_t *buffer, size_t size)
 
       if (_response->sendChunk(_buffer, _length) != ESP_OK)
         return written;
+
+      _sent += _length;
     }
     written += blockSize; //Update if sent correctly.
   }
@@ -60,7 +65,8 @@ void ChunkPrinter::flush()
 {
   if (_pos)
   {
-    _response->sendChunk(_buffer, _pos);
+    if (_response->sendChunk(_buffer, _pos) == ESP_OK)
+      _sent += _pos;
     _pos = 0;
   }
 }
@@ -73,7 +79,8 @@ size_t ChunkPrinter::copyFrom(Stream &stream)
     
     if (_pos == _length)
     {
-      _response->sendChunk(_buffer, _length);
+      if (_response->sendChunk(_buffer, _length) == ESP_OK)
+        _sent += _length;
       _pos = 0;
     }
     
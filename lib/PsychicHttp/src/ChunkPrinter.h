@@ -11,6 +11,7 @@ class ChunkPrinter : public Print
     uint8_t *_buffer;
     size_t _length;
     size_t _pos;
+    size_t _sent;
 
   public:
     ChunkPrinter(PsychicResponse *response, uint8_t *buffer, size_t len);
@@ -22,6 +23,11 @@ class ChunkPrinter : public Print
     size_t copyFrom(Stream &stream);
 
     void flush() override;
+
+    //nothing has gone out yet while sent() is 0, the whole output is still in the buffer
+    size_t sent() { return _sent; }
+    size_t buffered() { return _pos; }
+    void clear() { _pos = 0; }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "PsychicArena.h"
+#include <stdlib.h>
+#include <string.h>
+
+//everything we hand out is aligned for any type
+#define ARENA_ALIGN(size) (((size) + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1))
+#define ARENA_HEADER ARENA_ALIGN(sizeof(Block))
+
+PsychicArena::PsychicArena() :
+  _blocks(NULL),
+  _used(0),
+  _count(0)
+{
+}
+
+PsychicArena::~PsychicArena()
+{
+  reset();
+}
+
+PsychicArena::Block * PsychicArena::_newBlock(size_t size)
+{
+  Block *block = (Block *)malloc(ARENA_HEADER + size);
+  if (block == NULL)
+    return NULL;
+
+  block->size = size;
+  block->used = 0;
+  _count++;
+
+  return block;
+}
+
+void * PsychicArena::alloc(size_t size)
+{
+  size = ARENA_ALIGN(size);
+
+  //bump the current block if it has room
+  if (_blocks != NULL && _blocks->size - _blocks->used >= size)
+  {
+    void *ptr = (uint8_t *)_blocks + ARENA_HEADER + _blocks->used;
+    _blocks->used += size;
+    _used += size;
+    return ptr;
+  }
+
+  //big ones get a block of their own, behind the current one so it stays in use
+  if (size > ARENA_BLOCK_SIZE / 2 && _blocks != NULL)
+  {
+    Block *block = _newBlock(size);
+    if (block == NULL)
+      return NULL;
+
+    block->used = size;
+    block->next = _blocks->next;
+    _blocks->next = block;
+    _used += size;
+    return (uint8_t *)block + ARENA_HEADER;
+  }
+
+  Block *block = _newBlock(size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE);
+  if (block == NULL)
+    return NULL;
+
+  block->used = size;
+  block->next = _blocks;
+  _blocks = block;
+  _used += size;
+  return (uint8_t *)block + ARENA_HEADER;
+}
+
+char * PsychicArena::strdup(const char *str)
+{
+  return strndup(str, strlen(str));
+}
+
+char * PsychicArena::strndup(const char *str, size_t len)
+{
+  char *copy = (char *)alloc(len + 1);
+  if (copy == NULL)
+    return NULL;
+
+  memcpy(copy, str, len);
+  copy[len] = '\0';
+  return copy;
+}
+
+bool PsychicArena::owns(const void *ptr)
+{
+  for (Block *block = _blocks; block != NULL; block = block->next)
+  {
+    const uint8_t *data = (const uint8_t *)block + ARENA_HEADER;
+    if (ptr >= data && ptr < data + block->used)
+      return true;
+  }
+
+  return false;
+}
+
+void PsychicArena::reset()
+{
+  while (_blocks != NULL)
+  {
+    Block *next = _blocks->next;
+    free(_blocks);
+    _blocks = next;
+  }
+
+  _used = 0;
+  _count = 0;
+}
@@ -0,0 +1,57 @@
+#ifndef PsychicArena_h
+#define PsychicArena_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#include <utility>
+
+#ifndef ARENA_BLOCK_SIZE
+  #define ARENA_BLOCK_SIZE 512
+#endif
+
+/*
+* ARENA :: Bump allocator for data that lives exactly as long as a request.
+* Nothing is freed on its own, all blocks go at once when the arena is reset or destroyed.
+*/
+
+class PsychicArena
+{
+  private:
+    struct Block
+    {
+      Block *next;
+      size_t size;
+      size_t used;
+    };
+
+    Block *_blocks;
+    size_t _used;
+    size_t _count;
+
+    Block *_newBlock(size_t size);
+
+  public:
+    PsychicArena();
+    ~PsychicArena();
+
+    void *alloc(size_t size);
+    char *strdup(const char *str);
+    char *strndup(const char *str, size_t len);
+
+    //construct an object in the arena, its destructor has to be called by hand
+    template <typename T, typename... Args>
+    T *create(Args&&... args)
+    {
+      void *ptr = alloc(sizeof(T));
+      return ptr == NULL ? NULL : new (ptr) T(std::forward<Args>(args)...);
+    }
+
+    bool owns(const void *ptr);
+    void reset();
+
+    size_t used() { return _used; }    // bytes handed out
+    size_t blocks() { return _count; } // heap allocations made
+};
+
+#endif // PsychicArena_h
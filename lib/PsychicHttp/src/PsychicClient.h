@@ -2,6 +2,15 @@
 #define PsychicClient_h
 
 #include "PsychicCore.h"
+#include <lwip/sockets.h>
+#include <vector>
+
+//lwIP numbers its sockets from here on up
+#ifdef LWIP_SOCKET_OFFSET
+  #define PSYCHIC_SOCKET_OFFSET LWIP_SOCKET_OFFSET
+#else
+  #define PSYCHIC_SOCKET_OFFSET 0
+#endif
 
 /*
 * PsychicClient :: Generic wrapper around the ESP-IDF socket
@@ -32,4 +41,41 @@ class PsychicClient {
     IPAddress remoteIP();
 };
 
+/*
+* PsychicClientTable :: O(1) client lookup by socket.
+* Sockets are small integers bounded by the number of open sockets, so a plain array does the job.
+*/
+
+class PsychicClientTable {
+  private:
+    std::vector<PsychicClient*> _slots;
+
+  public:
+    PsychicClient * get(int socket)
+    {
+      size_t index = (size_t)(socket - PSYCHIC_SOCKET_OFFSET);
+      return socket >= PSYCHIC_SOCKET_OFFSET && index < _slots.size() ? _slots[index] : NULL;
+    }
+
+    void set(int socket, PsychicClient *client)
+    {
+      if (socket < PSYCHIC_SOCKET_OFFSET)
+        return;
+
+      size_t index = (size_t)(socket - PSYCHIC_SOCKET_OFFSET);
+      if (index >= _slots.size())
+        _slots.resize(index + 1, NULL);
+      _slots[index] = client;
+    }
+
+    //lwIP reuses the socket numbers, a late close of the old client must not drop the new one
+    void remove(int socket, PsychicClient *client)
+    {
+      if (client != NULL && get(socket) == client)
+        _slots[(size_t)(socket - PSYCHIC_SOCKET_OFFSET)] = NULL;
+    }
+
+    void clear() { _slots.clear(); }
+};
+
 #endif
\ No newline at end of file
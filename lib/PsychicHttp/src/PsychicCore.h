@@ -49,6 +49,7 @@ enum HTTPAuthMethod
 };
 
 String urlDecode(const char *encoded);
+char *urlDecode(const char *encoded, char *decoded);
 
 class PsychicHttpServer;
 class PsychicRequest;
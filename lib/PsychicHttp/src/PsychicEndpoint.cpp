@@ -41,30 +41,40 @@ String PsychicEndpoint::uri() {
   return _uri;
 }
 
+http_method PsychicEndpoint::method() {
+  return _method;
+}
+
 esp_err_t PsychicEndpoint::requestCallback(httpd_req_t *req)
 {
   PsychicEndpoint *self = (PsychicEndpoint *)req->user_ctx;
-  PsychicHandler *handler = self->handler();
   PsychicRequest request(self->_server, req);
 
+  return self->process(&request);
+}
+
+esp_err_t PsychicEndpoint::process(PsychicRequest *request)
+{
+  PsychicHandler *handler = this->handler();
+
   //make sure we have a handler
   if (handler != NULL)
   {
-    if (handler->filter(&request) && handler->canHandle(&request))
+    if (handler->filter(request) && handler->canHandle(request))
     {
       //check our credentials
-       if (handler->needsAuthentication(&request))
-        return handler->authenticate(&request);
+       if (handler->needsAuthentication(request))
+        return handler->authenticate(request);
 
       //pass it to our handler
-      return handler->handleRequest(&request);
+      return handler->handleRequest(request);
     }
     //pass it to our generic handlers
     else
-      return PsychicHttpServer::notFoundHandler(req, HTTPD_500_INTERNAL_SERVER_ERROR);
+      return PsychicHttpServer::notFoundHandler(request->request(), HTTPD_500_INTERNAL_SERVER_ERROR);
   }
   else
-    return request.reply(500, "text/html", "No handler registered.");
+    return request->reply(500, "text/html", "No handler registered.");
 }
 
 PsychicEndpoint* PsychicEndpoint::setFilter(PsychicRequestFilterFunction fn) {
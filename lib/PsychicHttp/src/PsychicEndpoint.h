@@ -26,7 +26,9 @@ class PsychicEndpoint
     PsychicEndpoint* setAuthentication(const char *username, const char *password, HTTPAuthMethod method = BASIC_AUTH, const char *realm = "", const char *authFailMsg = "");
 
     String uri();
+    http_method method();
 
+    esp_err_t process(PsychicRequest *request);
     static esp_err_t requestCallback(httpd_req_t *req);
 };
 
@@ -8,9 +8,16 @@ PsychicFileResponse::PsychicFileResponse(PsychicRequest *request, FS &fs, const
   //_code = 200;
   String _path(path);
 
-  if(!download && !fs.exists(_path) && fs.exists(_path+".gz")){
+  //precompressed brotli beats everything else, if the client takes it
+  if(!download && request->acceptsEncoding("br") && fs.exists(_path+".br")){
+    _path = _path+".br";
+    addHeader("Content-Encoding", "br");
+    addHeader("Vary", "Accept-Encoding");
+  }
+  else if(!download && !fs.exists(_path) && fs.exists(_path+".gz")){
     _path = _path+".gz";
     addHeader("Content-Encoding", "gzip");
+    addHeader("Vary", "Accept-Encoding");
   }
 
   _content = fs.open(_path, "r");
@@ -41,6 +48,11 @@ PsychicFileResponse::PsychicFileResponse(PsychicRequest *request, File content,
 
   if(!download && String(content.name()).endsWith(".gz") && !path.endsWith(".gz")){
     addHeader("Content-Encoding", "gzip");
+    addHeader("Vary", "Accept-Encoding");
+  }
+  else if(!download && String(content.name()).endsWith(".br") && !path.endsWith(".br")){
+    addHeader("Content-Encoding", "br");
+    addHeader("Vary", "Accept-Encoding");
   }
 
   _content = content;
@@ -90,6 +102,7 @@ void PsychicFileResponse::_setContentType(const String& path){
   else if (path.endsWith(".pdf")) _contentType = "application/pdf";
   else if (path.endsWith(".zip")) _contentType = "application/zip";
   else if(path.endsWith(".gz")) _contentType = "application/x-gzip";
+  else if(path.endsWith(".br")) _contentType = "application/x-brotli";
   else _contentType = "text/plain";
   
   setContentType(_contentType);
@@ -99,6 +112,20 @@ esp_err_t PsychicFileResponse::send()
 {
   esp_err_t err = ESP_OK;
 
+  //resumable downloads, ranges are in bytes of the stored (maybe precompressed) file
+  size_t total = getContentLength();
+  PsychicRange range = _request->range(total, getHeader("ETag"), getHeader("Last-Modified"));
+  setRange(range, total);
+
+  if (range.status == RANGE_UNSATISFIABLE)
+    return PsychicResponse::send();
+
+  if (range.status == RANGE_PARTIAL && !_content.seek(range.start))
+  {
+    httpd_resp_send_err(this->_request->request(), HTTPD_500_INTERNAL_SERVER_ERROR, "Unable to seek file.");
+    return ESP_FAIL;
+  }
+
   //just send small files directly
   size_t size = getContentLength();
   if (size < FILE_CHUNK_SIZE)
@@ -131,19 +158,21 @@ esp_err_t PsychicFileResponse::send()
 
     this->sendHeaders();
 
+    size_t remaining = size;
     size_t chunksize;
     do {
-        /* Read file in chunks into the scratch buffer */
-        chunksize = _content.readBytes(chunk, FILE_CHUNK_SIZE);
+        /* Read file in chunks into the scratch buffer, never past the end of the range */
+        chunksize = _content.readBytes(chunk, remaining < FILE_CHUNK_SIZE ? remaining : FILE_CHUNK_SIZE);
         if (chunksize > 0)
         {
           err = this->sendChunk((uint8_t *)chunk, chunksize);
           if (err != ESP_OK)
             break;
+          remaining -= chunksize;
         }
 
-        /* Keep looping till the whole file is sent */
-    } while (chunksize != 0);
+        /* Keep looping till the whole range is sent */
+    } while (chunksize != 0 && remaining > 0);
 
     //keep track of our memory
     free(chunk);
@@ -16,6 +16,7 @@ PsychicHandler::~PsychicHandler() {
   // for (PsychicClient *client : _clients)
   //   delete(client);
   _clients.clear();
+  _clientTable.clear();
 }
 
 PsychicHandler* PsychicHandler::setFilter(PsychicRequestFilterFunction fn) {
@@ -76,26 +77,32 @@ void PsychicHandler::checkForClosedClient(PsychicClient *client)
 }
 
 void PsychicHandler::addClient(PsychicClient *client) {
+  //drop whatever was left behind on a reused socket
+  PsychicClient *stale = _clientTable.get(client->socket());
+  if (stale != NULL && stale != client)
+    _clients.remove(stale);
+
   _clients.push_back(client);
+  _clientTable.set(client->socket(), client);
 }
 
 void PsychicHandler::removeClient(PsychicClient *client) {
+  _clientTable.remove(client->socket(), client);
   _clients.remove(client);
 }
 
 PsychicClient * PsychicHandler::getClient(int socket)
 {
-  //make sure the server has it too.
-  if (!_server->hasClient(socket))
+  //what about us?
+  PsychicClient *client = _clientTable.get(socket);
+  if (client == NULL)
     return NULL;
 
-  //what about us?
-  for (PsychicClient *client : _clients)
-    if (client->socket() == socket)
-      return client;
+  //make sure the server still has the very same one, sockets get reused.
+  if (_server->getClient(socket) != client)
+    return NULL;
 
-  //nothing found.
-  return NULL;
+  return client;
 }
 
 PsychicClient * PsychicHandler::getClient(PsychicClient *client) {
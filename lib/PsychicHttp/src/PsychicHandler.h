@@ -27,6 +27,7 @@ class PsychicHandler {
     String _subprotocol;
 
     std::list<PsychicClient*> _clients;
+    PsychicClientTable _clientTable;
 
   public:
     PsychicHandler();
@@ -8,9 +8,15 @@
 #include "WiFi.h"
 
 PsychicHttpServer::PsychicHttpServer() :
+  _routerMethods(0),
   _onOpen(NULL),
-  _onClose(NULL)
+  _onClose(NULL),
+  _jsonBuffer(NULL),
+  _jsonBufferTaken(false),
+  server(NULL)
 {
+  portMUX_INITIALIZE(&_jsonBufferLock);
+
   maxRequestBodySize = MAX_REQUEST_BODY_SIZE;
   maxUploadSize = MAX_UPLOAD_SIZE;
 
@@ -32,6 +38,7 @@ PsychicHttpServer::~PsychicHttpServer()
   for (auto *client : _clients)
     delete(client);
   _clients.clear();
+  _clientTable.clear();
 
   for (auto *endpoint : _endpoints)
     delete(endpoint);
@@ -42,6 +49,8 @@ PsychicHttpServer::~PsychicHttpServer()
   _handlers.clear();
 
   delete defaultEndpoint;
+
+  free(_jsonBuffer);
 }
 
 void PsychicHttpServer::destroy(void *ctx)
@@ -74,6 +83,14 @@ esp_err_t PsychicHttpServer::_start()
   if (ret != ESP_OK)
     ESP_LOGE(PH_TAG, "Add 404 handler failed (%s)", esp_err_to_name(ret)); 
 
+  // a request with a method we have no catch-all for ends up here, the router sorts it out
+  ret = httpd_register_err_handler(server, HTTPD_405_METHOD_NOT_ALLOWED, PsychicHttpServer::methodNotAllowedHandler);
+  if (ret != ESP_OK)
+    ESP_LOGE(PH_TAG, "Add 405 handler failed (%s)", esp_err_to_name(ret));
+
+  //endpoints added before listen() still need their httpd handlers
+  _registerUriHandlers();
+
   return ret;
 }
 
@@ -84,6 +101,44 @@ esp_err_t PsychicHttpServer::_startServer() {
 void PsychicHttpServer::stop()
 {
   httpd_stop(this->server);  
+  this->server = NULL;
+}
+
+char* PsychicHttpServer::takeJsonBuffer()
+{
+  //handlers normally run one after the other in the httpd task, so this is hardly ever contended
+  taskENTER_CRITICAL(&_jsonBufferLock);
+  bool shared = !_jsonBufferTaken;
+  _jsonBufferTaken = true;
+  taskEXIT_CRITICAL(&_jsonBufferLock);
+
+  if (!shared)
+    return (char *)malloc(JSON_BUFFER_SIZE);
+
+  if (_jsonBuffer == NULL)
+    _jsonBuffer = (char *)malloc(JSON_BUFFER_SIZE);
+
+  //out of memory, the next response tries again
+  if (_jsonBuffer == NULL)
+  {
+    taskENTER_CRITICAL(&_jsonBufferLock);
+    _jsonBufferTaken = false;
+    taskEXIT_CRITICAL(&_jsonBufferLock);
+  }
+
+  return _jsonBuffer;
+}
+
+void PsychicHttpServer::releaseJsonBuffer(char *buffer)
+{
+  if (buffer != NULL && buffer == _jsonBuffer)
+  {
+    taskENTER_CRITICAL(&_jsonBufferLock);
+    _jsonBufferTaken = false;
+    taskEXIT_CRITICAL(&_jsonBufferLock);
+  }
+  else
+    free(buffer);
 }
 
 PsychicHandler& PsychicHttpServer::addHandler(PsychicHandler* handler){
@@ -119,25 +174,105 @@ PsychicEndpoint* PsychicHttpServer::on(const char* uri, http_method method, Psyc
   //set our handler
   endpoint->setHandler(handler);
 
-  // URI handler structure
+  //add it to our router
+  if (!_router.insert(uri, method, endpoint))
+    ESP_LOGE(PH_TAG, "Add endpoint %s failed", uri);
+
+  //save it for later
+  _endpoints.push_back(endpoint);
+
+  //let httpd know about it if we are already running
+  if (this->server != NULL)
+  {
+    esp_err_t ret = _registerEndpoint(endpoint);
+    if (ret != ESP_OK)
+      ESP_LOGE(PH_TAG, "Add endpoint failed (%s)", esp_err_to_name(ret));
+  }
+
+  return endpoint;
+}
+
+esp_err_t PsychicHttpServer::_registerEndpoint(PsychicEndpoint *endpoint)
+{
+  PsychicHandler *handler = endpoint->handler();
+
+  //regular endpoints only need a catch-all for their method
+  if (!handler->isWebSocket())
+    return _registerCatchAll(endpoint->method());
+
+  //websockets need a real httpd handler for the handshake and framing.
+  //httpd matches in registration order, so they have to go in ahead of our catch-alls.
+  uint64_t methods = _unregisterCatchAlls();
+
+  String uri = endpoint->uri();
   httpd_uri_t my_uri {
-    .uri      = uri,
-    .method   = method,
+    .uri      = uri.c_str(),
+    .method   = endpoint->method(),
     .handler  = PsychicEndpoint::requestCallback,
     .user_ctx = endpoint,
-    .is_websocket = handler->isWebSocket(),
+    .is_websocket = true,
     .supported_subprotocol = handler->getSubprotocol()
   };
-  
+
   // Register endpoint with ESP-IDF server
   esp_err_t ret = httpd_register_uri_handler(this->server, &my_uri);
-  if (ret != ESP_OK)
-    ESP_LOGE(PH_TAG, "Add endpoint failed (%s)", esp_err_to_name(ret));
 
-  //save it for later
-  _endpoints.push_back(endpoint);
+  //put our catch-alls back in
+  for (int method = 0; method < 64; method++)
+    if (methods & (1ULL << method))
+      _registerCatchAll((http_method)method);
 
-  return endpoint;
+  return ret;
+}
+
+esp_err_t PsychicHttpServer::_registerCatchAll(http_method method)
+{
+  if (method < 0 || method >= 64)
+    return ESP_ERR_INVALID_ARG;
+
+  //only one of these per method
+  if (_routerMethods & (1ULL << method))
+    return ESP_OK;
+
+  httpd_uri_t my_uri {
+    .uri      = "*",
+    .method   = method,
+    .handler  = PsychicHttpServer::requestHandler,
+    .user_ctx = this,
+    .is_websocket = false,
+    .supported_subprotocol = NULL
+  };
+
+  esp_err_t ret = httpd_register_uri_handler(this->server, &my_uri);
+  if (ret == ESP_OK)
+    _routerMethods |= (1ULL << method);
+
+  return ret;
+}
+
+uint64_t PsychicHttpServer::_unregisterCatchAlls()
+{
+  uint64_t methods = _routerMethods;
+
+  for (int method = 0; method < 64; method++)
+    if (methods & (1ULL << method))
+      httpd_unregister_uri_handler(this->server, "*", (http_method)method);
+
+  _routerMethods = 0;
+  return methods;
+}
+
+void PsychicHttpServer::_registerUriHandlers()
+{
+  //a fresh httpd instance has none of our handlers
+  _routerMethods = 0;
+
+  for (PsychicEndpoint *endpoint : _endpoints)
+  {
+    esp_err_t ret = _registerEndpoint(endpoint);
+    if (ret != ESP_OK)
+      ESP_LOGE(PH_TAG, "Add endpoint %s failed (%s)", endpoint->uri().c_str(), esp_err_to_name(ret));
+  }
 }
 
 PsychicEndpoint* PsychicHttpServer::on(const char* uri, PsychicHttpRequestCallback fn)
@@ -176,6 +311,40 @@ void PsychicHttpServer::onNotFound(PsychicHttpRequestCallback fn)
   this->defaultEndpoint->setHandler(handler);
 }
 
+esp_err_t PsychicHttpServer::requestHandler(httpd_req_t *req)
+{
+  PsychicHttpServer *server = (PsychicHttpServer*)httpd_get_global_user_ctx(req->handle);
+
+  //the query string is not part of the route
+  size_t length = strcspn(req->uri, "?");
+
+  PsychicRouteParams params;
+  bool pathExists = false;
+  PsychicEndpoint *endpoint = server->_router.find(req->uri, length, (http_method)req->method, params, &pathExists);
+
+  if (endpoint == NULL)
+  {
+    //we know the uri, just not with this method
+    if (pathExists)
+      return httpd_resp_send_err(req, HTTPD_405_METHOD_NOT_ALLOWED, "Request method for this URI is not handled by server");
+
+    return PsychicHttpServer::notFoundHandler(req, HTTPD_404_NOT_FOUND);
+  }
+
+  PsychicRequest request(server, req);
+
+  //path parameters show up as regular params
+  for (PsychicRouteParam &param : params)
+    request._addParam(param.name, strlen(param.name), param.value, param.length, true, false);
+
+  return endpoint->process(&request);
+}
+
+esp_err_t PsychicHttpServer::methodNotAllowedHandler(httpd_req_t *req, httpd_err_code_t err)
+{
+  return PsychicHttpServer::requestHandler(req);
+}
+
 esp_err_t PsychicHttpServer::notFoundHandler(httpd_req_t *req, httpd_err_code_t err)
 {
   PsychicHttpServer *server = (PsychicHttpServer*)httpd_get_global_user_ctx(req->handle);
@@ -282,19 +451,17 @@ PsychicStaticFileHandler* PsychicHttpServer::serveStatic(const char* uri, fs::FS
 
 void PsychicHttpServer::addClient(PsychicClient *client) {
   _clients.push_back(client);
+  _clientTable.set(client->socket(), client);
 }
 
 void PsychicHttpServer::removeClient(PsychicClient *client) {
+  _clientTable.remove(client->socket(), client);
   _clients.remove(client);
   delete client;
 }
 
 PsychicClient * PsychicHttpServer::getClient(int socket) {
-  for (PsychicClient * client : _clients)
-    if (client->socket() == socket)
-      return client;
-
-  return NULL;
+  return _clientTable.get(socket);
 }
 
 PsychicClient * PsychicHttpServer::getClient(httpd_req_t *req) {
@@ -319,12 +486,21 @@ bool ON_AP_FILTER(PsychicRequest *request) {
 
 String urlDecode(const char* encoded)
 {
-  size_t length = strlen(encoded);
-  char* decoded = (char*)malloc(length + 1);
+  char* decoded = (char*)malloc(strlen(encoded) + 1);
   if (!decoded) {
     return "";
   }
 
+  String output(urlDecode(encoded, decoded));
+  free(decoded);
+
+  return output;
+}
+
+//decoded needs room for strlen(encoded) + 1 bytes, decoding never makes it longer
+char* urlDecode(const char* encoded, char* decoded)
+{
+  size_t length = strlen(encoded);
   size_t i, j = 0;
   for (i = 0; i < length; ++i) {
       if (encoded[i] == '%' && isxdigit(encoded[i + 1]) && isxdigit(encoded[i + 2])) {
@@ -344,8 +520,5 @@ String urlDecode(const char* encoded)
 
   decoded[j] = '\0';  // Null-terminate the decoded string
 
-  String output(decoded);
-  free(decoded);
-
-  return output;
+  return decoded;
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "PsychicCore.h"
 #include "PsychicClient.h"
 #include "PsychicHandler.h"
+#include "PsychicRouter.h"
 
 class PsychicEndpoint;
 class PsychicHandler;
@@ -16,13 +17,28 @@ class PsychicHttpServer
     std::list<PsychicEndpoint*> _endpoints;
     std::list<PsychicHandler*> _handlers;
     std::list<PsychicClient*> _clients;
+    PsychicClientTable _clientTable;
+
+    //all regular endpoints live in our own router, httpd only sees one catch-all per method
+    PsychicRouter _router;
+    uint64_t _routerMethods;
 
     PsychicClientCallback _onOpen;
     PsychicClientCallback _onClose;
 
+    //output buffer of the JSON responses, allocated once and reused by every request
+    char *_jsonBuffer;
+    bool _jsonBufferTaken;
+    portMUX_TYPE _jsonBufferLock;
+
     esp_err_t _start();
     virtual esp_err_t _startServer();
 
+    esp_err_t _registerEndpoint(PsychicEndpoint *endpoint);
+    esp_err_t _registerCatchAll(http_method method);
+    uint64_t _unregisterCatchAlls();
+    void _registerUriHandlers();
+
   public:
     PsychicHttpServer();
     virtual ~PsychicHttpServer();
@@ -63,6 +79,8 @@ class PsychicHttpServer
     PsychicEndpoint* on(const char* uri, PsychicJsonRequestCallback onRequest);
     PsychicEndpoint* on(const char* uri, http_method method, PsychicJsonRequestCallback onRequest);
 
+    static esp_err_t requestHandler(httpd_req_t *req);
+    static esp_err_t methodNotAllowedHandler(httpd_req_t *req, httpd_err_code_t err);
     static esp_err_t notFoundHandler(httpd_req_t *req, httpd_err_code_t err);
     static esp_err_t defaultNotFoundHandler(PsychicRequest *request);
     void onNotFound(PsychicHttpRequestCallback fn);
@@ -72,6 +90,10 @@ class PsychicHttpServer
     static esp_err_t openCallback(httpd_handle_t hd, int sockfd);
     static void closeCallback(httpd_handle_t hd, int sockfd);
 
+    //JSON_BUFFER_SIZE bytes, a temporary one if a response in another task holds the shared one
+    char* takeJsonBuffer();
+    void releaseJsonBuffer(char *buffer);
+
     PsychicStaticFileHandler* serveStatic(const char* uri, fs::FS& fs, const char* path, const char* cache_control = NULL);
 };
 
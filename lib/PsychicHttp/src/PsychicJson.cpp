@@ -32,51 +32,51 @@ size_t PsychicJsonResponse::getLength()
 esp_err_t PsychicJsonResponse::send()
 {
   esp_err_t err = ESP_OK;
-  size_t length = getLength();
-  size_t buffer_size;
-  char *buffer;
+  PsychicHttpServer *server = this->_request->server();
+  uint32_t start = micros();
+  size_t length;
+  bool chunked;
 
-  //how big of a buffer do we want?
-  if (length < JSON_BUFFER_SIZE)
-    buffer_size = length+1;
-  else
-    buffer_size = JSON_BUFFER_SIZE;
-
-  buffer = (char *)malloc(buffer_size);
+  //one fixed size buffer kept by the server, the document is only serialized once
+  char *buffer = server->takeJsonBuffer();
   if (buffer == NULL) {
     httpd_resp_send_err(this->_request->request(), HTTPD_500_INTERNAL_SERVER_ERROR, "Unable to allocate memory.");
     return ESP_FAIL;
   }
 
-  //send it in one shot or no?
-  if (length < JSON_BUFFER_SIZE)
-  {
-    serializeJson(_root, buffer, buffer_size);
+  //status and headers only go out with the first byte of data
+  this->sendHeaders();
 
-    this->setContent((uint8_t *)buffer, length);
-    this->setContentType(JSON_MIMETYPE);
-
-    err = PsychicResponse::send();
-  }
-  else
   {
-    //helper class that acts as a stream to print chunked responses
-    ChunkPrinter dest(this, (uint8_t *)buffer, buffer_size);
-
-    //keep our headers
-    this->sendHeaders();
-
+    //helper class that acts as a stream, it only starts chunking once the buffer is full
+    ChunkPrinter dest(this, (uint8_t *)buffer, JSON_BUFFER_SIZE);
     serializeJson(_root, dest);
 
-    //send the last bits
-    dest.flush();
+    length = dest.sent() + dest.buffered();
+    chunked = dest.sent() > 0;
+
+    //it all fit, send it in one shot with a proper Content-Length
+    if (!chunked)
+    {
+      err = httpd_resp_send(this->_request->request(), buffer, dest.buffered());
+      if (err != ESP_OK)
+        ESP_LOGE(PH_TAG, "Send response failed (%s)", esp_err_to_name(err));
+      dest.clear();
+    }
+    //we're chunking already, send the last bits
+    else
+    {
+      dest.flush();
 
-    //done with our chunked response too
-    err = this->finishChunking();
+      //done with our chunked response too
+      err = this->finishChunking();
+    }
   }
 
-  //let the buffer go
-  free(buffer);
+  //hand the buffer back once the printer is gone
+  server->releaseJsonBuffer(buffer);
+
+  ESP_LOGV(PH_TAG, "JSON response: %u bytes%s in %u us", (unsigned)length, chunked ? " chunked" : "", (unsigned)(micros() - start));
 
   return err;
 }
@@ -105,29 +105,39 @@ void PsychicJsonHandler::onRequest(PsychicJsonRequestCallback fn) { _onRequest =
 
 esp_err_t PsychicJsonHandler::handleRequest(PsychicRequest *request)
 {
-  //process basic stuff
-  PsychicWebHandler::handleRequest(request);
+  //lookup our client
+  PsychicClient *client = checkForNewClient(request->client());
+  if (client->isNew)
+    openCallback(client);
+
+  /* Request body cannot be larger than a limit */
+  if (request->contentLength() > request->server()->maxRequestBodySize)
+    return bodyTooLarge(request);
+
+  //only the query string, the body is parsed below
+  request->loadParams();
 
   if (_onRequest)
   {
+    //deserialize straight from the socket, the body is never copied into RAM as a whole
+    BodyStream body(request);
+
     #ifdef ARDUINOJSON_6_COMPATIBILITY
       DynamicJsonDocument jsonBuffer(this->_maxJsonBufferSize);
-      DeserializationError error = deserializeJson(jsonBuffer, request->body());
-      if (error)
-        return request->reply(400);
-
-      JsonVariant json = jsonBuffer.as<JsonVariant>();
     #else
       JsonDocument jsonBuffer;
-      DeserializationError error = deserializeJson(jsonBuffer, request->body());
-      if (error)
-        return request->reply(400);
-
-      JsonVariant json = jsonBuffer.as<JsonVariant>();
     #endif
 
+    DeserializationError error = deserializeJson(jsonBuffer, body);
+    if (body.failed())
+      return ESP_FAIL;
+    if (error)
+      return request->reply(400);
+
+    JsonVariant json = jsonBuffer.as<JsonVariant>();
+
     return _onRequest(request, json);
   }
   else
     return request->reply(500);
-}
\ No newline at end of file
+}
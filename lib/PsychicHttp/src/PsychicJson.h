@@ -11,6 +11,7 @@
 #include "PsychicRequest.h"
 #include "PsychicWebHandler.h"
 #include "ChunkPrinter.h"
+#include "BodyStream.h"
 #include <ArduinoJson.h>
 
 #if ARDUINOJSON_VERSION_MAJOR == 6
@@ -7,6 +7,8 @@ PsychicRequest::PsychicRequest(PsychicHttpServer *server, httpd_req_t *req) : _s
                                                                               _method(HTTP_GET),
                                                                               _query(""),
                                                                               _body(""),
+                                                                              _params(NULL),
+                                                                              _lastParam(NULL),
                                                                               _tempObject(NULL)
 {
     // load up our client.
@@ -34,10 +36,20 @@ PsychicRequest::~PsychicRequest()
     if (_tempObject != NULL)
         free(_tempObject);
 
-    // our web parameters
-    for (auto *param : _params)
-        delete (param);
-    _params.clear();
+    // our web parameters, the arena ones just need their destructor
+    PsychicWebParameter *param = _params;
+    while (param != NULL)
+    {
+        PsychicWebParameter *next = param->_next;
+        if (_arena.owns(param))
+            param->~PsychicWebParameter();
+        else
+            delete (param);
+        param = next;
+    }
+    _params = _lastParam = NULL;
+
+    ESP_LOGV(PH_TAG, "Request arena: %u bytes in %u blocks", (unsigned)_arena.used(), (unsigned)_arena.blocks());
 }
 
 void PsychicRequest::freeSession(void *ctx)
@@ -59,6 +71,11 @@ httpd_req_t *PsychicRequest::request()
     return _req;
 }
 
+PsychicArena *PsychicRequest::arena()
+{
+    return &_arena;
+}
+
 PsychicClient *PsychicRequest::client()
 {
     return _client;
@@ -218,6 +235,136 @@ bool PsychicRequest::hasHeader(const char *name)
     return httpd_req_get_hdr_value_len(this->_req, name) > 0;
 }
 
+bool PsychicRequest::acceptsEncoding(const char *encoding)
+{
+    String accept = this->header("Accept-Encoding");
+
+    // comma separated list of codings, each with an optional ;q= weight
+    // the coding itself overrides "*", whichever comes first
+    int explicitly = -1;
+    int wildcard = -1;
+    int start = 0;
+    while (start < (int)accept.length())
+    {
+        int end = accept.indexOf(',', start);
+        if (end < 0)
+            end = accept.length();
+
+        String coding = accept.substring(start, end);
+        String weight;
+        int semicolon = coding.indexOf(';');
+        if (semicolon >= 0)
+        {
+            weight = coding.substring(semicolon + 1);
+            coding = coding.substring(0, semicolon);
+        }
+        coding.trim();
+        weight.trim();
+
+        // q=0 means "not acceptable"
+        int acceptable = !weight.startsWith("q=") || weight.substring(2).toFloat() > 0;
+        if (coding.equalsIgnoreCase(encoding))
+            explicitly = acceptable;
+        else if (coding == "*")
+            wildcard = acceptable;
+
+        start = end + 1;
+    }
+
+    if (explicitly >= 0)
+        return explicitly;
+    return wildcard > 0;
+}
+
+PsychicRange PsychicRequest::range(size_t total, const char *etag, const char *lastModified)
+{
+    PsychicRange range = {RANGE_NONE, 0, total};
+
+    if (this->method() != HTTP_GET || !this->hasHeader("Range"))
+        return range;
+
+    // If-Range wants the strong validator we sent, otherwise the whole thing again
+    if (this->hasHeader("If-Range"))
+    {
+        String ifRange = this->header("If-Range");
+        bool matches = !ifRange.startsWith("W/") &&
+                       ((etag != NULL && ifRange.equals(etag)) || (lastModified != NULL && ifRange.equals(lastModified)));
+        if (!matches)
+            return range;
+    }
+
+    String value = this->header("Range");
+    value.trim();
+
+    // we only do a single range, anything else gets the full content which is always allowed
+    if (!value.substring(0, 6).equalsIgnoreCase("bytes=") || value.indexOf(',') >= 0)
+        return range;
+
+    value = value.substring(6);
+    value.trim();
+
+    int dash = value.indexOf('-');
+    if (dash < 0)
+        return range;
+
+    String first = value.substring(0, dash);
+    String last = value.substring(dash + 1);
+    first.trim();
+    last.trim();
+
+    // digits only, an invalid range header is ignored
+    auto digits = [](const String &part) {
+        for (size_t i = 0; i < part.length(); i++)
+            if (!isdigit(part[i]))
+                return false;
+        return true;
+    };
+    if (!digits(first) || !digits(last))
+        return range;
+
+    if (first.length() == 0)
+    {
+        // suffix range, the last n bytes
+        if (last.length() == 0)
+            return range;
+
+        size_t suffix = strtoull(last.c_str(), NULL, 10);
+        if (suffix == 0 || total == 0)
+        {
+            range.status = RANGE_UNSATISFIABLE;
+            return range;
+        }
+
+        range.length = suffix < total ? suffix : total;
+        range.start = total - range.length;
+    }
+    else
+    {
+        size_t start = strtoull(first.c_str(), NULL, 10);
+        if (start >= total)
+        {
+            range.status = RANGE_UNSATISFIABLE;
+            return range;
+        }
+
+        size_t end = total - 1;
+        if (last.length())
+        {
+            size_t requested = strtoull(last.c_str(), NULL, 10);
+            if (requested < start)
+                return range;
+            if (requested < end)
+                end = requested;
+        }
+
+        range.start = start;
+        range.length = end - start + 1;
+    }
+
+    range.status = RANGE_PARTIAL;
+    return range;
+}
+
 const String PsychicRequest::host()
 {
     return this->header("Host");
@@ -306,34 +453,53 @@ void PsychicRequest::loadParams()
 
 void PsychicRequest::_addParams(const String &params, bool post)
 {
-    size_t start = 0;
-    while (start < params.length())
+    const char *start = params.c_str();
+    const char *end = start + params.length();
+    while (start < end)
     {
-        int end = params.indexOf('&', start);
-        if (end < 0)
-            end = params.length();
-        int equal = params.indexOf('=', start);
-        if (equal < 0 || equal > end)
-            equal = end;
-        String name = params.substring(start, equal);
-        String value = equal + 1 < end ? params.substring(equal + 1, end) : String();
-        addParam(name, value, true, post);
-        start = end + 1;
+        const char *pairEnd = (const char *)memchr(start, '&', end - start);
+        if (pairEnd == NULL)
+            pairEnd = end;
+        const char *equal = (const char *)memchr(start, '=', pairEnd - start);
+        if (equal == NULL)
+            _addParam(start, pairEnd - start, "", 0, true, post);
+        else
+            _addParam(start, equal - start, equal + 1, pairEnd - equal - 1, true, post);
+        start = pairEnd + 1;
     }
 }
 
-PsychicWebParameter *PsychicRequest::addParam(const String &name, const String &value, bool decode, bool post)
+PsychicWebParameter *PsychicRequest::_addParam(const char *name, size_t nameLength, const char *value, size_t valueLength, bool decode, bool post)
 {
+    // the parameter and both strings live in the arena, decoding never makes them longer
+    char *paramName = _arena.strndup(name, nameLength);
+    char *paramValue = _arena.strndup(value, valueLength);
+    void *memory = _arena.alloc(sizeof(PsychicWebParameter));
+    if (paramName == NULL || paramValue == NULL || memory == NULL)
+        return NULL;
+
     if (decode)
-        return addParam(new PsychicWebParameter(urlDecode(name.c_str()), urlDecode(value.c_str()), post));
-    else
-        return addParam(new PsychicWebParameter(name, value, post));
+    {
+        urlDecode(paramName, paramName);
+        urlDecode(paramValue, paramValue);
+    }
+
+    return addParam(new (memory) PsychicWebParameter(paramName, paramValue, post));
+}
+
+PsychicWebParameter *PsychicRequest::addParam(const String &name, const String &value, bool decode, bool post)
+{
+    return _addParam(name.c_str(), name.length(), value.c_str(), value.length(), decode, post);
 }
 
 PsychicWebParameter *PsychicRequest::addParam(PsychicWebParameter *param)
 {
-    // ESP_LOGD(PH_TAG, "Adding param: '%s' = '%s'", param->name().c_str(), param->value().c_str());
-    _params.push_back(param);
+    // ESP_LOGD(PH_TAG, "Adding param: '%s' = '%s'", param->name(), param->value());
+    if (_lastParam == NULL)
+        _params = param;
+    else
+        _lastParam->_next = param;
+    _lastParam = param;
     return param;
 }
 
@@ -344,8 +510,8 @@ bool PsychicRequest::hasParam(const char *key)
 
 PsychicWebParameter *PsychicRequest::getParam(const char *key)
 {
-    for (auto *param : _params)
-        if (param->name().equals(key))
+    for (PsychicWebParameter *param = _params; param != NULL; param = param->_next)
+        if (strcmp(param->name(), key) == 0)
             return param;
 
     return NULL;
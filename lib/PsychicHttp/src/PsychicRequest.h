@@ -5,6 +5,7 @@
 #include "PsychicHttpServer.h"
 #include "PsychicClient.h"
 #include "PsychicWebParameter.h"
+#include "PsychicArena.h"
 #include "PsychicResponse.h"
 
 typedef std::map<String, String> SessionData;
@@ -17,6 +18,14 @@ struct ContentDisposition {
   String name;
 };
 
+enum RangeStatus { RANGE_NONE, RANGE_PARTIAL, RANGE_UNSATISFIABLE };
+
+struct PsychicRange {
+  RangeStatus status;
+  size_t start;
+  size_t length;
+};
+
 class PsychicRequest {
   friend PsychicHttpServer;
 
@@ -31,9 +40,13 @@ class PsychicRequest {
     String _query;
     String _body;
 
-    std::list<PsychicWebParameter*> _params;
+    PsychicWebParameter *_params;     // chained through the parameters themselves
+    PsychicWebParameter *_lastParam;
+
+    PsychicArena _arena;
 
     void _addParams(const String& params, bool post);
+    PsychicWebParameter * _addParam(const char *name, size_t nameLength, const char *value, size_t valueLength, bool decode, bool post);
     void _parseGETParams();
     void _parsePOSTParams();
 
@@ -48,6 +61,7 @@ class PsychicRequest {
 
     PsychicHttpServer * server();
     httpd_req_t * request();
+    PsychicArena * arena();     // scratch memory released when the request ends
     virtual PsychicClient * client();
 
     bool isMultipart();
@@ -55,6 +69,8 @@ class PsychicRequest {
 
     const String header(const char *name);
     bool hasHeader(const char *name);
+    bool acceptsEncoding(const char *encoding); // true if Accept-Encoding allows it (eg. "br" or "gzip")
+    PsychicRange range(size_t total, const char *etag = NULL, const char *lastModified = NULL); // the single byte range asked for, honouring If-Range
 
     static void freeSession(void *ctx);
     bool hasSessionKey(const String& key);
@@ -83,6 +99,7 @@ class PsychicRequest {
     PsychicWebParameter * addParam(const String &name, const String &value, bool decode = true, bool post = false);
     bool hasParam(const char *key);
     PsychicWebParameter * getParam(const char *name);
+    PsychicWebParameter * params() { return _params; } // the first parameter, follow next() for the others
 
     const String getFilename();
 
@@ -13,28 +13,56 @@ PsychicResponse::PsychicResponse(PsychicRequest *request) :
 
 PsychicResponse::~PsychicResponse()
 {
-  //clean up our header variables.  we have to do this on desctruct since httpd_resp_send doesn't store copies
-  for (HTTPHeader header : _headers)
-  {
-    free(header.field);
-    free(header.value);
-  }
+  //the header strings live in the request arena, httpd_resp_send doesn't store copies
   _headers.clear();
 }
 
 void PsychicResponse::addHeader(const char *field, const char *value)
 {
-  //these get freed after send by the destructor
+  //these stay around until the request is done
   HTTPHeader header;
-  header.field =(char *)malloc(strlen(field)+1);
-  header.value = (char *)malloc(strlen(value)+1);
+  header.field = _request->arena()->strdup(field);
+  header.value = _request->arena()->strdup(value);
 
-  strlcpy(header.field, field, strlen(field)+1);
-  strlcpy(header.value, value, strlen(value)+1);
+  if (header.field == NULL || header.value == NULL)
+  {
+    ESP_LOGE(PH_TAG, "Failed to allocate memory for header %s", field);
+    return;
+  }
 
   _headers.push_back(header);
 }
 
+const char * PsychicResponse::getHeader(const char *field)
+{
+  for (HTTPHeader header : _headers)
+    if (!strcasecmp(header.field, field))
+      return header.value;
+
+  return NULL;
+}
+
+void PsychicResponse::setRange(const PsychicRange &range, size_t total)
+{
+  addHeader("Accept-Ranges", "bytes");
+
+  char contentRange[64];
+  if (range.status == RANGE_PARTIAL)
+  {
+    snprintf(contentRange, sizeof(contentRange), "bytes %u-%u/%u", (unsigned)range.start, (unsigned)(range.start + range.length - 1), (unsigned)total);
+    addHeader("Content-Range", contentRange);
+    setCode(206);
+    setContentLength(range.length);
+  }
+  else if (range.status == RANGE_UNSATISFIABLE)
+  {
+    snprintf(contentRange, sizeof(contentRange), "bytes */%u", (unsigned)total);
+    addHeader("Content-Range", contentRange);
+    setCode(416);
+    setContent((const uint8_t *)"", 0);
+  }
+}
+
 void PsychicResponse::setCookie(const char *name, const char *value, unsigned long secondsFromNow, const char *extras)
 {
   time_t now = time(nullptr);
@@ -72,7 +100,9 @@ void PsychicResponse::setCode(int code)
 
 void PsychicResponse::setContentType(const char *contentType)
 {
-  httpd_resp_set_type(_request->request(), contentType);
+  //httpd only keeps the pointer, so keep a copy around for the rest of the request
+  const char *type = _request->arena()->strdup(contentType);
+  httpd_resp_set_type(_request->request(), type != NULL ? type : contentType);
 }
 
 void PsychicResponse::setContent(const char *content)
@@ -99,11 +129,7 @@ size_t PsychicResponse::getContentLength()
 
 esp_err_t PsychicResponse::send()
 {
-  //esp-idf makes you set the whole status.
-  sprintf(_status, "%u %s", _code, http_status_reason(_code));
-  httpd_resp_set_status(_request->request(), _status);
-
-  //our headers too
+  //status and headers
   this->sendHeaders();
 
   //now send it off
@@ -118,6 +144,10 @@ esp_err_t PsychicResponse::send()
 
 void PsychicResponse::sendHeaders()
 {
+  //esp-idf makes you set the whole status.
+  sprintf(_status, "%u %s", _code, http_status_reason(_code));
+  httpd_resp_set_status(_request->request(), _status);
+
   //get our global headers out of the way first
   for (HTTPHeader header : DefaultHeaders::Instance().getHeaders())
     httpd_resp_set_hdr(_request->request(), header.field, header.value);
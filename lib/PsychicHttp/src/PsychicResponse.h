@@ -5,6 +5,7 @@
 #include "time.h"
 
 class PsychicRequest;
+struct PsychicRange;
 
 class PsychicResponse
 {
@@ -28,6 +29,9 @@ class PsychicResponse
     int64_t getContentLength(int64_t contentLength) { return _contentLength; }
 
     void addHeader(const char *field, const char *value);
+    const char * getHeader(const char *field);
+
+    void setRange(const PsychicRange &range, size_t total);
 
     void setCookie(const char *key, const char *value, unsigned long max_age = 60*60*24*30, const char *extras = "");
 
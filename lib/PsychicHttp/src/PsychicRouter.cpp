@@ -0,0 +1,254 @@
+#include "PsychicRouter.h"
+
+PsychicRouter::Node::~Node()
+{
+  for (Node *child : children)
+    delete child;
+  children.clear();
+
+  delete param;
+  delete wildcard;
+}
+
+PsychicEndpoint * PsychicRouter::Node::endpointFor(http_method method)
+{
+  for (Route &route : routes)
+    if (route.method == method)
+      return route.endpoint;
+
+  return NULL;
+}
+
+PsychicRouter::PsychicRouter() :
+  _count(0)
+{
+}
+
+PsychicRouter::~PsychicRouter()
+{
+  // endpoints are owned by PsychicHttpServer, only the tree is ours
+}
+
+bool PsychicRouter::insert(const char *uri, http_method method, PsychicEndpoint *endpoint)
+{
+  size_t len = strlen(uri);
+
+  //httpd style optional character: "/path/?", "/path/?*" or "/path/*?"
+  bool asterisk = len > 0 && (uri[len - 1] == '*' || (len > 1 && uri[len - 2] == '*' && uri[len - 1] == '?'));
+  bool quest = len > 0 && (uri[len - 1] == '?' || (len > 1 && uri[len - 2] == '?' && uri[len - 1] == '*'));
+
+  if (!quest)
+    return _insert(uri, len, method, endpoint);
+
+  //the optional character sits right before the special characters
+  size_t special = asterisk ? 2 : 1;
+  if (len < special + 1)
+    return false;
+  size_t optional = len - special - 1;
+
+  //without the optional character it has to be an exact match
+  if (!_insert(uri, optional, method, endpoint))
+    return false;
+
+  //with it, anything may follow if there was an asterisk
+  if (!asterisk)
+    return _insert(uri, optional + 1, method, endpoint);
+
+  String withOptional;
+  withOptional.concat(uri, optional + 1);
+  withOptional += '*';
+  return _insert(withOptional.c_str(), withOptional.length(), method, endpoint);
+}
+
+bool PsychicRouter::_insert(const char *uri, size_t len, http_method method, PsychicEndpoint *endpoint)
+{
+  Node *node = &_root;
+  size_t i = 0;
+
+  while (i < len)
+  {
+    if (uri[i] == '{')
+    {
+      const char *close = (const char *)memchr(uri + i, '}', len - i);
+      if (close == NULL || close == uri + i + 1)
+      {
+        ESP_LOGE(PH_TAG, "Malformed path parameter in %.*s", (int)len, uri);
+        return false;
+      }
+
+      String name;
+      name.concat(uri + i + 1, close - uri - i - 1);
+
+      if (node->param == NULL)
+      {
+        node->param = new Node();
+        node->paramName = name;
+      }
+      else if (node->paramName != name)
+        ESP_LOGW(PH_TAG, "Path parameter {%s} already registered as {%s}", name.c_str(), node->paramName.c_str());
+
+      node = node->param;
+      i = close - uri + 1;
+    }
+    else if (uri[i] == '*')
+    {
+      if (i != len - 1)
+      {
+        ESP_LOGE(PH_TAG, "Wildcard must be the last character in %.*s", (int)len, uri);
+        return false;
+      }
+
+      if (node->wildcard == NULL)
+        node->wildcard = new Node();
+
+      node = node->wildcard;
+      i++;
+    }
+    else
+    {
+      size_t end = i;
+      while (end < len && uri[end] != '{' && uri[end] != '*')
+        end++;
+
+      node = _insertStatic(node, uri + i, end - i);
+      i = end;
+    }
+  }
+
+  if (node->endpointFor(method) != NULL)
+  {
+    ESP_LOGE(PH_TAG, "Endpoint %.*s already registered for %s", (int)len, uri, http_method_str(method));
+    return false;
+  }
+
+  node->routes.push_back({method, endpoint});
+  _count++;
+
+  return true;
+}
+
+PsychicRouter::Node * PsychicRouter::_insertStatic(Node *node, const char *path, size_t len)
+{
+  while (len > 0)
+  {
+    //children never share their first character
+    Node *child = NULL;
+    size_t index;
+    for (index = 0; index < node->children.size(); index++)
+    {
+      if (node->children[index]->prefix[0] == path[0])
+      {
+        child = node->children[index];
+        break;
+      }
+    }
+
+    //nothing in common, hang the rest of the path off this node
+    if (child == NULL)
+    {
+      child = new Node();
+      child->prefix.concat(path, len);
+      node->children.push_back(child);
+      return child;
+    }
+
+    size_t common = 0;
+    size_t prefixLength = child->prefix.length();
+    while (common < prefixLength && common < len && child->prefix[common] == path[common])
+      common++;
+
+    //split the edge where the paths diverge
+    if (common < prefixLength)
+    {
+      Node *split = new Node();
+      split->prefix = child->prefix.substring(0, common);
+      child->prefix.remove(0, common);
+      split->children.push_back(child);
+      node->children[index] = split;
+      child = split;
+    }
+
+    node = child;
+    path += common;
+    len -= common;
+  }
+
+  return node;
+}
+
+PsychicEndpoint * PsychicRouter::find(const char *path, size_t len, http_method method, PsychicRouteParams &params, bool *pathExists)
+{
+  bool exists = false;
+
+  params.clear();
+  PsychicEndpoint *endpoint = _find(&_root, path, len, method, params, exists);
+
+  if (pathExists != NULL)
+    *pathExists = exists;
+
+  return endpoint;
+}
+
+PsychicEndpoint * PsychicRouter::_find(Node *node, const char *path, size_t len, http_method method, PsychicRouteParams &params, bool &pathExists)
+{
+  PsychicEndpoint *endpoint;
+
+  //end of the path, do we have a route for it?
+  if (len == 0 && !node->routes.empty())
+  {
+    endpoint = node->endpointFor(method);
+    if (endpoint != NULL)
+      return endpoint;
+
+    //remember it for a 405 instead of a 404
+    pathExists = true;
+  }
+
+  if (len > 0)
+  {
+    //static children first
+    for (Node *child : node->children)
+    {
+      if (child->prefix[0] != path[0])
+        continue;
+
+      size_t prefixLength = child->prefix.length();
+      if (prefixLength <= len && !memcmp(child->prefix.c_str(), path, prefixLength))
+      {
+        endpoint = _find(child, path + prefixLength, len - prefixLength, method, params, pathExists);
+        if (endpoint != NULL)
+          return endpoint;
+      }
+      break;
+    }
+
+    //then a single path segment parameter
+    if (node->param != NULL && path[0] != '/')
+    {
+      size_t segment = 0;
+      while (segment < len && path[segment] != '/')
+        segment++;
+
+      params.push_back({node->paramName.c_str(), path, segment});
+
+      endpoint = _find(node->param, path + segment, len - segment, method, params, pathExists);
+      if (endpoint != NULL)
+        return endpoint;
+
+      params.pop_back();
+    }
+  }
+
+  //finally the wildcard swallows whatever is left
+  if (node->wildcard != NULL)
+  {
+    endpoint = node->wildcard->endpointFor(method);
+    if (endpoint != NULL)
+      return endpoint;
+
+    if (!node->wildcard->routes.empty())
+      pathExists = true;
+  }
+
+  return NULL;
+}
@@ -0,0 +1,71 @@
+#ifndef PsychicRouter_h
+#define PsychicRouter_h
+
+#include "PsychicCore.h"
+#include <vector>
+
+class PsychicEndpoint;
+
+/*
+* ROUTER :: Compact radix tree mapping uri templates to endpoints.
+*
+* Supported template syntax:
+*   /static/path        exact match
+*   /users/{id}         named parameter, matches one non-empty path segment
+*   /files/*            trailing wildcard, matches any remainder (httpd style)
+*   /path/?  /path/?*   optional last character (httpd style)
+*
+* Lookup priority is static > parameter > wildcard, with backtracking.
+*/
+
+struct PsychicRouteParam
+{
+  const char *name;
+  const char *value;
+  size_t length;
+};
+
+typedef std::vector<PsychicRouteParam> PsychicRouteParams;
+
+class PsychicRouter
+{
+  private:
+    struct Route
+    {
+      http_method method;
+      PsychicEndpoint *endpoint;
+    };
+
+    struct Node
+    {
+      String prefix;
+      std::vector<Node*> children;
+      Node *param;
+      String paramName;
+      Node *wildcard;
+      std::vector<Route> routes;
+
+      Node() : param(NULL), wildcard(NULL) {}
+      ~Node();
+
+      PsychicEndpoint *endpointFor(http_method method);
+    };
+
+    Node _root;
+    size_t _count;
+
+    bool _insert(const char *uri, size_t len, http_method method, PsychicEndpoint *endpoint);
+    Node *_insertStatic(Node *node, const char *path, size_t len);
+    PsychicEndpoint *_find(Node *node, const char *path, size_t len, http_method method, PsychicRouteParams &params, bool &pathExists);
+
+  public:
+    PsychicRouter();
+    ~PsychicRouter();
+
+    bool insert(const char *uri, http_method method, PsychicEndpoint *endpoint);
+    PsychicEndpoint *find(const char *path, size_t len, http_method method, PsychicRouteParams &params, bool *pathExists = NULL);
+
+    size_t count() { return _count; }
+};
+
+#endif // PsychicRouter_h
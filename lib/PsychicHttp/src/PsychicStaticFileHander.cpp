@@ -4,6 +4,9 @@
 /*  PsychicStaticFileHandler         */
 /*************************************/
 
+// Bumped by invalidateAll(), every handler compares it against its own copy
+uint32_t PsychicStaticFileHandler::_generation = 0;
+
 PsychicStaticFileHandler::PsychicStaticFileHandler(const char *uri, FS &fs, const char *path, const char *cache_control)
     : _fs(fs), _uri(uri), _path(path), _default_file("index.html"), _cache_control(cache_control), _last_modified("")
 {
@@ -24,9 +27,12 @@ PsychicStaticFileHandler::PsychicStaticFileHandler(const char *uri, FS &fs, cons
     if (_path[_path.length() - 1] == '/')
         _path = _path.substring(0, _path.length() - 1);
 
-    // Reset stats
-    _gzipFirst = false;
-    _gzipStats = 0xF8;
+    // Metadata is read from the filesystem on the first request
+    _cacheValid = false;
+    _cacheGeneration = _generation;
+    _variant = VARIANT_PLAIN;
+    _size = 0;
+    _modified = 0;
 }
 
 PsychicStaticFileHandler &PsychicStaticFileHandler::setIsDir(bool isDir)
@@ -73,16 +79,19 @@ bool PsychicStaticFileHandler::canHandle(PsychicRequest *request)
 
 bool PsychicStaticFileHandler::_getFile(PsychicRequest *request)
 {
-    // Remove the found uri
-    String path = request->uri().substring(_uri.length());
+    // Remove the found uri, the query string never names a file
+    String path = request->path().substring(_uri.length());
 
     // We can skip the file check and look for default if request is to the root of a directory or that request path ends with '/'
     bool canSkipFileCheck = (_isDir && path.length() == 0) || (path.length() && path[path.length() - 1] == '/');
 
     path = _path + path;
 
-    // Do we have a file or .gz file
-    if (!canSkipFileCheck && _fileExists(path))
+    // Only look for .br files if the client can take them
+    bool brotli = request->acceptsEncoding("br");
+
+    // Do we have a file, .br or .gz file
+    if (!canSkipFileCheck && _lookup(path, brotli))
         return true;
 
     // Can't handle if not default file
@@ -94,111 +103,178 @@ bool PsychicStaticFileHandler::_getFile(PsychicRequest *request)
         path += "/";
     path += _default_file;
 
-    return _fileExists(path);
+    return _lookup(path, brotli);
 }
 
-#define FILE_IS_REAL(f) (f == true && !f.isDirectory())
-
-bool PsychicStaticFileHandler::_fileExists(const String &path)
+bool PsychicStaticFileHandler::_lookup(const String &path, bool brotli)
 {
-    bool fileFound = false;
-    bool gzipFound = false;
+    if (!_cacheValid || _cacheGeneration != _generation)
+        _buildCache();
 
-    String gzip = path + ".gz";
+    auto it = _cache.find(path);
+    if (it == _cache.end())
+        return false;
 
-    if (_gzipFirst)
+    const FileInfo &info = it->second;
+
+    // A precompressed .br file always wins, then .gz, then the plain file
+    if (brotli && (info.variants & (1 << VARIANT_BROTLI)))
+        _variant = VARIANT_BROTLI;
+    else if (info.variants & (1 << VARIANT_GZIP))
+        _variant = VARIANT_GZIP;
+    else if (info.variants & (1 << VARIANT_PLAIN))
+        _variant = VARIANT_PLAIN;
+    else
+        return false;
+
+    _filename = path;
+    _size = info.size[_variant];
+    _modified = info.modified[_variant];
+    return true;
+}
+
+void PsychicStaticFileHandler::_buildCache()
+{
+    _cache.clear();
+    _cacheValid = true;
+    _cacheGeneration = _generation;
+
+    String rootPath = _path.length() ? _path : String("/");
+    File root = _fs.exists(rootPath) ? _fs.open(rootPath, "r") : File();
+    if (root && root.isDirectory())
     {
-        _file = _fs.open(gzip, "r");
-        gzipFound = FILE_IS_REAL(_file);
-        if (!gzipFound)
-        {
-            _file = _fs.open(path, "r");
-            fileFound = FILE_IS_REAL(_file);
-        }
+        _scanDir(root);
+        root.close();
     }
     else
     {
-        _file = _fs.open(path, "r");
-        fileFound = FILE_IS_REAL(_file);
-        if (!fileFound)
+        if (root)
+            root.close();
+
+        // A single file, which may only exist precompressed like /www/favicon.png.gz
+        const char *suffixes[] = {"", ".gz", ".br"};
+        for (const char *suffix : suffixes)
         {
-            _file = _fs.open(gzip, "r");
-            gzipFound = FILE_IS_REAL(_file);
+            String path = _path + suffix;
+            if (!_fs.exists(path))
+                continue;
+
+            File file = _fs.open(path, "r");
+            if (file && !file.isDirectory())
+                _addToCache(file);
+            if (file)
+                file.close();
         }
     }
 
-    bool found = fileFound || gzipFound;
+    ESP_LOGD(PH_TAG, "Indexed %u static files below %s", (unsigned)_cache.size(), _path.c_str());
+}
 
-    if (found)
+void PsychicStaticFileHandler::_scanDir(File &dir)
+{
+    File file = dir.openNextFile();
+    while (file)
     {
-        _filename = path;
-
-        // Calculate gzip statistic
-        _gzipStats = (_gzipStats << 1) + (gzipFound ? 1 : 0);
-        if (_gzipStats == 0x00)
-            _gzipFirst = false; // All files are not gzip
-        else if (_gzipStats == 0xFF)
-            _gzipFirst = true; // All files are gzip
+        if (file.isDirectory())
+            _scanDir(file);
         else
-            _gzipFirst = _countBits(_gzipStats) > 4; // IF we have more gzip files - try gzip first
+            _addToCache(file);
+
+        file.close();
+        file = dir.openNextFile();
     }
+}
 
-    return found;
+void PsychicStaticFileHandler::_addToCache(File &file)
+{
+    String path = file.path();
+    int variant = VARIANT_PLAIN;
+
+    if (path.endsWith(".br"))
+        variant = VARIANT_BROTLI;
+    else if (path.endsWith(".gz"))
+        variant = VARIANT_GZIP;
+
+    if (variant != VARIANT_PLAIN)
+        path.remove(path.length() - 3);
+
+    // new entries come out of the map zeroed
+    FileInfo &info = _cache[path];
+    info.variants |= 1 << variant;
+    info.size[variant] = file.size();
+    info.modified[variant] = file.getLastWrite();
+
+    // a real .gz file is also served as is when asked for by its full name
+    if (variant != VARIANT_PLAIN)
+    {
+        FileInfo &raw = _cache[file.path()];
+        raw.variants |= 1 << VARIANT_PLAIN;
+        raw.size[VARIANT_PLAIN] = file.size();
+        raw.modified[VARIANT_PLAIN] = info.modified[variant];
+    }
+}
+
+PsychicStaticFileHandler &PsychicStaticFileHandler::invalidate()
+{
+    _cacheValid = false;
+    _cache.clear();
+    return *this;
 }
 
-uint8_t PsychicStaticFileHandler::_countBits(const uint8_t value) const
+void PsychicStaticFileHandler::invalidateAll()
 {
-    uint8_t w = value;
-    uint8_t n;
-    for (n = 0; w != 0; n++)
-        w &= w - 1;
-    return n;
+    _generation++;
 }
 
 esp_err_t PsychicStaticFileHandler::handleRequest(PsychicRequest *request)
 {
-    if (_file == true)
+    // The size alone doesn't tell two versions of a file apart, so it only makes a weak
+    // ETag, which If-Range ignores. With the modification time it is a strong one.
+    char etag[32];
+    if (_modified > 0)
+        snprintf(etag, sizeof(etag), "\"%x-%llx\"", (unsigned)_size, (unsigned long long)_modified);
+    else
+        snprintf(etag, sizeof(etag), "W/\"%x\"", (unsigned)_size);
+
+    // is it not modified?
+    if (_last_modified.length() && _last_modified == request->header("If-Modified-Since"))
     {
-        // is it not modified?
-        String etag = String(_file.size());
-        if (_last_modified.length() && _last_modified == request->header("If-Modified-Since"))
-        {
-            _file.close();
-            request->reply(304); // Not modified
-        }
-        // does our Etag match?
-        else if (_cache_control.length() && request->hasHeader("If-None-Match") && request->header("If-None-Match").equals(etag))
-        {
-            _file.close();
+        return request->reply(304); // Not modified
+    }
+    // does our Etag match?
+    else if (_cache_control.length() && request->hasHeader("If-None-Match") && request->header("If-None-Match").equals(etag))
+    {
+        PsychicResponse response(request);
+        response.addHeader("Cache-Control", _cache_control.c_str());
+        response.addHeader("ETag", etag);
+        response.setCode(304);
+        return response.send();
+    }
 
-            PsychicResponse response(request);
-            response.addHeader("Cache-Control", _cache_control.c_str());
-            response.addHeader("ETag", etag.c_str());
-            response.setCode(304);
-            response.send();
-        }
-        // nope, send them the full file.
-        else
-        {
-            PsychicFileResponse response(request, _fs, _filename);
+    // nope, send them the full file, opened exactly once.
+    String filename = _filename;
+    if (_variant == VARIANT_BROTLI)
+        filename += ".br";
+    else if (_variant == VARIANT_GZIP)
+        filename += ".gz";
 
-            if (_last_modified.length())
-                response.addHeader("Last-Modified", _last_modified.c_str());
-            if (_cache_control.length())
-            {
-                response.addHeader("Cache-Control", _cache_control.c_str());
-                response.addHeader("ETag", etag.c_str());
-            }
+    File file = _fs.open(filename, "r");
+    if (!file || file.isDirectory())
+    {
+        // somebody changed the filesystem behind our back
+        invalidate();
+        return request->reply(404);
+    }
 
-            _file.close();
+    PsychicFileResponse response(request, file, _filename);
 
-            return response.send();
-        }
-    }
-    else
+    if (_last_modified.length())
+        response.addHeader("Last-Modified", _last_modified.c_str());
+    if (_cache_control.length())
     {
-        return request->reply(404);
+        response.addHeader("Cache-Control", _cache_control.c_str());
+        response.addHeader("ETag", etag);
     }
 
-    return ESP_OK;
-}
\ No newline at end of file
+    return response.send();
+}
@@ -11,21 +11,43 @@ class PsychicStaticFileHandler : public PsychicWebHandler {
   using File = fs::File;
   using FS = fs::FS;
   private:
+    enum {
+      VARIANT_PLAIN,
+      VARIANT_GZIP,
+      VARIANT_BROTLI,
+      VARIANT_COUNT
+    };
+
+    // what we know about a file and its precompressed variants
+    struct FileInfo {
+      uint8_t variants;
+      size_t size[VARIANT_COUNT];
+      time_t modified[VARIANT_COUNT];
+    };
+
+    static uint32_t _generation;
+
+    std::map<String, FileInfo> _cache;
+    uint32_t _cacheGeneration;
+    bool _cacheValid;
+
     bool _getFile(PsychicRequest *request);
-    bool _fileExists(const String& path);
-    uint8_t _countBits(const uint8_t value) const;
+    bool _lookup(const String& path, bool brotli);
+    void _buildCache();
+    void _scanDir(File &dir);
+    void _addToCache(File &file);
   protected:
     FS _fs;
-    File _file;
     String _filename;
+    int _variant;
+    size_t _size;
+    time_t _modified;
     String _uri;
     String _path;
     String _default_file;
     String _cache_control;
     String _last_modified;
     bool _isDir;
-    bool _gzipFirst;
-    uint8_t _gzipStats;
   public:
     PsychicStaticFileHandler(const char* uri, FS& fs, const char* path, const char* cache_control);
     bool canHandle(PsychicRequest *request) override;
@@ -36,6 +58,11 @@ class PsychicStaticFileHandler : public PsychicWebHandler {
     PsychicStaticFileHandler& setLastModified(const char* last_modified);
     PsychicStaticFileHandler& setLastModified(struct tm* last_modified);
     //PsychicStaticFileHandler& setTemplateProcessor(AwsTemplateProcessor newCallback) {_callback = newCallback; return *this;}
+
+    // forget the file metadata, call this after changing files below path
+    PsychicStaticFileHandler& invalidate();
+    // same for every static file handler at once
+    static void invalidateAll();
 };
 
 #endif /* PsychicHttp_h */
\ No newline at end of file
@@ -128,6 +128,7 @@ esp_err_t PsychicUploadHandler::_multipartUploadHandler(PsychicRequest *request)
     {
         _boundary = value.substring(value.indexOf('=') + 1);
         _boundary.replace("\"", "");
+        _delimiter = "\r\n--" + _boundary;
     }
     else
     {
@@ -161,15 +162,37 @@ esp_err_t PsychicUploadHandler::_multipartUploadHandler(PsychicRequest *request)
             }
         }
 
-        // parse it 1 byte at a time.
-        for (int i = 0; i < received; i++)
+        int i = 0;
+        while (i < received)
         {
+            // item data is handed over in spans up to the next possible delimiter
+            if (_multiParseState == WAIT_FOR_RETURN1)
+            {
+                size_t span = _scanItemData((uint8_t *)buf + i, received - i);
+                if (span)
+                {
+                    if (_itemIsFile)
+                        _handleUploadSpan((uint8_t *)buf + i, span);
+                    else
+                    {
+                        _itemValue.concat(buf + i, span);
+                        _itemSize += span;
+                    }
+
+                    i += span;
+                    remaining -= span;
+                    index += span;
+                    _parsedLength += span;
+                    continue;
+                }
+            }
+
             /* Keep track of remaining size of the file left to be uploaded */
             remaining--;
             index++;
 
-            // send it to our parser
-            _parseMultipartPostByte(buf[i], !remaining);
+            // boundaries and headers go through the parser 1 byte at a time.
+            _parseMultipartPostByte(buf[i++], !remaining);
             _parsedLength++;
         }
     }
@@ -198,6 +221,61 @@ void PsychicUploadHandler::_handleUploadByte(uint8_t data, bool last)
     }
 }
 
+void PsychicUploadHandler::_handleUploadSpan(uint8_t *data, size_t len)
+{
+    while (len > 0)
+    {
+        // once the first chunk is out and nothing is buffered, spans go to the callback as they are
+        if (_itemBufferIndex == 0 && _itemSize > 0)
+        {
+            if (_uploadCallback)
+                _uploadCallback(_request, _itemFilename, _itemSize, data, len, false);
+            _itemSize += len;
+            return;
+        }
+
+        // the first chunk is always a full buffer (or the whole file), callbacks check headers in there
+        size_t copy = FILE_CHUNK_SIZE - _itemBufferIndex;
+        if (copy > len)
+            copy = len;
+
+        memcpy(_itemBuffer + _itemBufferIndex, data, copy);
+        _itemBufferIndex += copy;
+        _itemSize += copy;
+        data += copy;
+        len -= copy;
+
+        if (_itemBufferIndex == FILE_CHUNK_SIZE)
+        {
+            if (_uploadCallback)
+                _uploadCallback(_request, _itemFilename, _itemSize - _itemBufferIndex, _itemBuffer, _itemBufferIndex, false);
+            _itemBufferIndex = 0;
+        }
+    }
+}
+
+// Length of the item data before the next "\r" that may start the delimiter.
+// A delimiter cut off by the end of the buffer counts as a match, the byte parser sorts it out.
+size_t PsychicUploadHandler::_scanItemData(const uint8_t *data, size_t len)
+{
+    const uint8_t *end = data + len;
+    const uint8_t *cr = data;
+
+    while ((cr = (const uint8_t *)memchr(cr, '\r', end - cr)) != NULL)
+    {
+        size_t compare = end - cr;
+        if (compare > _delimiter.length())
+            compare = _delimiter.length();
+
+        if (!memcmp(cr, _delimiter.c_str(), compare))
+            return cr - data;
+
+        cr++;
+    }
+
+    return len;
+}
+
 #define itemWriteByte(b)                \
     do                                  \
     {                                   \
@@ -24,6 +24,7 @@ class PsychicUploadHandler : public PsychicWebHandler {
     size_t _parsedLength;
     uint8_t _multiParseState;
     String _boundary;
+    String _delimiter;
     uint8_t _boundaryPosition;
     size_t _itemStartIndex;
     size_t _itemSize;
@@ -39,7 +40,9 @@ class PsychicUploadHandler : public PsychicWebHandler {
     esp_err_t _multipartUploadHandler(PsychicRequest *request);
 
     void _handleUploadByte(uint8_t data, bool last);
+    void _handleUploadSpan(uint8_t *data, size_t len);
     void _parseMultipartPostByte(uint8_t data, bool last);
+    size_t _scanItemData(const uint8_t *data, size_t len);
 
   public:
     PsychicUploadHandler();
@@ -21,17 +21,7 @@ esp_err_t PsychicWebHandler::handleRequest(PsychicRequest *request)
 
   /* Request body cannot be larger than a limit */
   if (request->contentLength() > request->server()->maxRequestBodySize)
-  {
-    ESP_LOGE(PH_TAG, "Request body too large : %d bytes", request->contentLength());
-
-    /* Respond with 400 Bad Request */
-    char error[60];
-    sprintf(error, "Request body must be less than %lu bytes!", request->server()->maxRequestBodySize);
-    httpd_resp_send_err(request->request(), HTTPD_400_BAD_REQUEST, error);
-
-    /* Return failure to close underlying connection else the incoming file content will keep the socket busy */
-    return ESP_FAIL;
-  }
+    return bodyTooLarge(request);
 
   //get our body loaded up.
   esp_err_t err = request->loadBody();
@@ -48,6 +38,19 @@ esp_err_t PsychicWebHandler::handleRequest(PsychicRequest *request)
   return err;
 }
 
+esp_err_t PsychicWebHandler::bodyTooLarge(PsychicRequest *request)
+{
+  ESP_LOGE(PH_TAG, "Request body too large : %d bytes", request->contentLength());
+
+  /* Respond with 400 Bad Request */
+  char error[60];
+  sprintf(error, "Request body must be less than %lu bytes!", request->server()->maxRequestBodySize);
+  httpd_resp_send_err(request->request(), HTTPD_400_BAD_REQUEST, error);
+
+  /* Return failure to close underlying connection else the incoming file content will keep the socket busy */
+  return ESP_FAIL;
+}
+
 PsychicWebHandler * PsychicWebHandler::onRequest(PsychicHttpRequestCallback fn) {
   _requestCallback = fn;
   return this;
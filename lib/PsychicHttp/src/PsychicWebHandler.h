@@ -16,6 +16,8 @@ class PsychicWebHandler : public PsychicHandler {
     PsychicClientCallback _onOpen;
     PsychicClientCallback _onClose;
 
+    esp_err_t bodyTooLarge(PsychicRequest *request);
+
   public:
     PsychicWebHandler();
     ~PsychicWebHandler();
@@ -3,23 +3,36 @@
 
 /*
  * PARAMETER :: Chainable object to hold GET/POST and FILE parameters
+ *
+ * Query and form parameters point into the arena of their request, the ones built from Strings keep a copy.
  * */
 
 class PsychicWebParameter {
+  friend class PsychicRequest;
+
   private:
-    String _name;
-    String _value;
+    String _nameCopy;
+    String _valueCopy;
+    const char *_name;
+    const char *_value;
     size_t _size;
     bool _isForm;
     bool _isFile;
+    PsychicWebParameter *_next;
+
+    PsychicWebParameter(const char *name, const char *value, bool form): _name(name), _value(value), _size(0), _isForm(form), _isFile(false), _next(NULL){}
 
   public:
-    PsychicWebParameter(const String& name, const String& value, bool form=false, bool file=false, size_t size=0): _name(name), _value(value), _size(size), _isForm(form), _isFile(file){}
-    const String& name() const { return _name; }
-    const String& value() const { return _value; }
+    PsychicWebParameter(const String& name, const String& value, bool form=false, bool file=false, size_t size=0): _nameCopy(name), _valueCopy(value), _name(_nameCopy.c_str()), _value(_valueCopy.c_str()), _size(size), _isForm(form), _isFile(file), _next(NULL){}
+    PsychicWebParameter(const PsychicWebParameter&) = delete;
+    PsychicWebParameter& operator=(const PsychicWebParameter&) = delete;
+
+    const char* name() const { return _name; }
+    const char* value() const { return _value; }
     size_t size() const { return _size; }
     bool isPost() const { return _isForm; }
     bool isFile() const { return _isFile; }
+    PsychicWebParameter* next() const { return _next; } // the following parameter of the request, NULL after the last one
 };
 
-#endif //PsychicWebParameter_h
\ No newline at end of file
+#endif //PsychicWebParameter_h
@@ -14,145 +14,293 @@
 
 #include "ArduinoJsonJWT.h"
 
-ArduinoJsonJWT::ArduinoJsonJWT(String secret) : _secret(secret)
+#define HMAC_BLOCK_SIZE 64
+
+ArduinoJsonJWT::ArduinoJsonJWT(String secret) : _keyLock(xSemaphoreCreateMutex())
+{
+    mbedtls_sha256_init(&_inner);
+    mbedtls_sha256_init(&_outer);
+    setSecret(secret);
+}
+
+ArduinoJsonJWT::~ArduinoJsonJWT()
+{
+    mbedtls_sha256_free(&_inner);
+    mbedtls_sha256_free(&_outer);
+    vSemaphoreDelete(_keyLock);
+}
+
+/*
+ * Hash one padded key block into state. The block is hashed in a context of its own and cloned,
+ * on chips where the SHA accelerator can't be shared the clone doesn't keep the engine locked.
+ */
+static void hashKeyBlock(mbedtls_sha256_context *state, const uint8_t *block)
 {
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    mbedtls_sha256_update(&ctx, block, HMAC_BLOCK_SIZE);
+
+    mbedtls_sha256_free(state);
+    mbedtls_sha256_init(state);
+    mbedtls_sha256_clone(state, &ctx);
+    mbedtls_sha256_free(&ctx);
 }
 
 void ArduinoJsonJWT::setSecret(String secret)
 {
+    // a token signed meanwhile waits, the two blocks are hashed quickly
+    xSemaphoreTake(_keyLock, portMAX_DELAY);
     _secret = secret;
+
+    // keys longer than a block are hashed first
+    uint8_t key[HMAC_BLOCK_SIZE] = {0};
+    if (_secret.length() > HMAC_BLOCK_SIZE)
+    {
+        mbedtls_sha256((const unsigned char *)_secret.c_str(), _secret.length(), key, 0);
+    }
+    else
+    {
+        memcpy(key, _secret.c_str(), _secret.length());
+    }
+
+    uint8_t pad[HMAC_BLOCK_SIZE];
+    for (size_t i = 0; i < HMAC_BLOCK_SIZE; i++)
+    {
+        pad[i] = key[i] ^ 0x36;
+    }
+    hashKeyBlock(&_inner, pad);
+    for (size_t i = 0; i < HMAC_BLOCK_SIZE; i++)
+    {
+        pad[i] = key[i] ^ 0x5c;
+    }
+    hashKeyBlock(&_outer, pad);
+    xSemaphoreGive(_keyLock);
+
+    memset(key, 0, sizeof(key));
+    memset(pad, 0, sizeof(pad));
 }
 
 String ArduinoJsonJWT::getSecret()
 {
-    return _secret;
+    xSemaphoreTake(_keyLock, portMAX_DELAY);
+    String secret = _secret;
+    xSemaphoreGive(_keyLock);
+    return secret;
 }
 
+static const char BASE64URL_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
 /*
- * ESP32 uses mbedtls,
- *
- * Both come with decent HMAC implmentations supporting sha256, as well as others.
+ * ESP32 uses mbedtls, which runs SHA-256 on the hardware accelerator where the chip supports it.
  *
- * No need to pull in additional crypto libraries - lets use what we already have.
+ * HMAC-SHA256 continues from the precomputed key states, so every token costs two SHA-256
+ * passes over its own data instead of another two over the padded key plus the md context setup.
  */
-String ArduinoJsonJWT::sign(String &payload)
+void ArduinoJsonJWT::sign(const char *data, size_t len, char *signature)
 {
     unsigned char hmacResult[32];
-    {
-        mbedtls_md_context_t ctx;
-        mbedtls_md_type_t md_type = MBEDTLS_MD_SHA256;
-        mbedtls_md_init(&ctx);
-        mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(md_type), 1);
-        mbedtls_md_hmac_starts(&ctx, (unsigned char *)_secret.c_str(), _secret.length());
-        mbedtls_md_hmac_update(&ctx, (unsigned char *)payload.c_str(), payload.length());
-        mbedtls_md_hmac_finish(&ctx, hmacResult);
-        mbedtls_md_free(&ctx);
-    }
-    return encode((char *)hmacResult, 32);
+    mbedtls_sha256_context inner;
+    mbedtls_sha256_context outer;
+
+    // copies of both key states, setSecret() may replace them while the token is hashed
+    mbedtls_sha256_init(&inner);
+    mbedtls_sha256_init(&outer);
+    xSemaphoreTake(_keyLock, portMAX_DELAY);
+    mbedtls_sha256_clone(&inner, &_inner);
+    mbedtls_sha256_clone(&outer, &_outer);
+    xSemaphoreGive(_keyLock);
+
+    // inner hash: H((key ^ ipad) || data)
+    mbedtls_sha256_update(&inner, (const unsigned char *)data, len);
+    mbedtls_sha256_finish(&inner, hmacResult);
+    mbedtls_sha256_free(&inner);
+
+    // outer hash: H((key ^ opad) || inner)
+    mbedtls_sha256_update(&outer, hmacResult, sizeof(hmacResult));
+    mbedtls_sha256_finish(&outer, hmacResult);
+    mbedtls_sha256_free(&outer);
+
+    encode(hmacResult, sizeof(hmacResult), signature);
 }
 
 String ArduinoJsonJWT::buildJWT(JsonObject &payload)
 {
-    // serialize, then encode payload
-    String jwt;
-    serializeJson(payload, jwt);
-    jwt = encode(jwt.c_str(), jwt.length());
+    // header.payload.signature in one buffer, the serialized payload waits behind it until it is encoded
+    size_t payloadLength = measureJson(payload);
+    size_t jwtLength = JWT_HEADER_SIZE + 1 + encodedLength(payloadLength) + 1 + JWT_SIGNATURE_SIZE;
+    char *buffer = (char *)malloc(jwtLength + 1 + payloadLength + 1);
+    if (buffer == nullptr)
+    {
+        return "";
+    }
+    char *json = buffer + jwtLength + 1;
+    serializeJson(payload, json, payloadLength + 1);
 
-    // add the header to payload
-    jwt = JWT_HEADER + '.' + jwt;
+    char *p = buffer;
+    memcpy(p, JWT_HEADER, JWT_HEADER_SIZE);
+    p += JWT_HEADER_SIZE;
+    *p++ = '.';
+    p += encode((const uint8_t *)json, payloadLength, p);
 
-    // add signature
-    jwt += '.' + sign(jwt);
+    // sign header and payload
+    size_t signedLength = p - buffer;
+    *p++ = '.';
+    sign(buffer, signedLength, p);
+    p += JWT_SIGNATURE_SIZE;
+    *p = '\0';
 
+    String jwt(buffer);
+    free(buffer);
     return jwt;
 }
 
-void ArduinoJsonJWT::parseJWT(String jwt, JsonDocument &jsonDocument)
+void ArduinoJsonJWT::parseJWT(const String &jwt, JsonDocument &jsonDocument)
+{
+    parseJWT(jwt.c_str(), jwt.length(), jsonDocument);
+}
+
+void ArduinoJsonJWT::parseJWT(const char *jwt, size_t len, JsonDocument &jsonDocument)
 {
     // clear json document before we begin, jsonDocument wil be null on failure
     jsonDocument.clear();
 
     // must have the correct header and delimiter
-    if (!jwt.startsWith(JWT_HEADER) || jwt.indexOf('.') != JWT_HEADER_SIZE)
+    if (len <= JWT_HEADER_SIZE || memcmp(jwt, JWT_HEADER, JWT_HEADER_SIZE) != 0 || jwt[JWT_HEADER_SIZE] != '.')
     {
         return;
     }
 
-    // check there is a signature delimieter
-    int signatureDelimiterIndex = jwt.lastIndexOf('.');
-    if (signatureDelimiterIndex == JWT_HEADER_SIZE)
+    // check there is a signature delimiter after the payload
+    const char *signatureDelimiter = jwt + len - 1;
+    while (*signatureDelimiter != '.')
+    {
+        signatureDelimiter--;
+    }
+    if (signatureDelimiter == jwt + JWT_HEADER_SIZE)
     {
         return;
     }
 
-    // check the signature is valid
-    String signature = jwt.substring(signatureDelimiterIndex + 1);
-    jwt = jwt.substring(0, signatureDelimiterIndex);
-    if (sign(jwt) != signature)
+    // check the signature is valid, comparing in constant time
+    size_t signedLength = signatureDelimiter - jwt;
+    const char *signature = signatureDelimiter + 1;
+    if (len - signedLength - 1 != JWT_SIGNATURE_SIZE)
+    {
+        return;
+    }
+    char expected[JWT_SIGNATURE_SIZE];
+    sign(jwt, signedLength, expected);
+    uint8_t difference = 0;
+    for (size_t i = 0; i < JWT_SIGNATURE_SIZE; i++)
+    {
+        difference |= expected[i] ^ signature[i];
+    }
+    if (difference != 0)
     {
         return;
     }
 
     // decode payload
-    jwt = jwt.substring(JWT_HEADER_SIZE + 1);
-    jwt = decode(jwt);
+    const char *payload = jwt + JWT_HEADER_SIZE + 1;
+    size_t payloadLength = signedLength - JWT_HEADER_SIZE - 1;
+    uint8_t stackBuffer[JWT_PAYLOAD_BUFFER_SIZE];
+    uint8_t *buffer = payloadLength * 3 / 4 <= sizeof(stackBuffer) ? stackBuffer : (uint8_t *)malloc(payloadLength * 3 / 4);
+    if (buffer == nullptr)
+    {
+        return;
+    }
+    int decodedLength = decode(payload, payloadLength, buffer);
 
     // parse payload, clearing json document after failure
-    DeserializationError error = deserializeJson(jsonDocument, jwt);
+    DeserializationError error = decodedLength < 0 ? DeserializationError::InvalidInput
+                                                   : deserializeJson(jsonDocument, (const char *)buffer, decodedLength);
     if (error != DeserializationError::Ok || !jsonDocument.is<JsonObject>())
     {
         jsonDocument.clear();
     }
-}
 
-String ArduinoJsonJWT::encode(const char *cstr, int inputLen)
-{
-    // prepare encoder
-    base64_encodestate _state;
-    base64_init_encodestate(&_state);
-    size_t encodedLength = base64_encode_expected_len(inputLen) + 1;
-    // prepare buffer of correct length, returning an empty string on failure
-    char *buffer = (char *)malloc(encodedLength * sizeof(char));
-    if (buffer == nullptr)
+    if (buffer != stackBuffer)
     {
-        return "";
+        free(buffer);
     }
+}
 
-    // encode to buffer
-    int len = base64_encode_block(cstr, inputLen, &buffer[0], &_state);
-    len += base64_encode_blockend(&buffer[len], &_state);
-    buffer[len] = 0;
-
-    // convert to arduino string, freeing buffer
-    String value = String(buffer);
-    free(buffer);
-    buffer = nullptr;
+size_t ArduinoJsonJWT::encodedLength(size_t len)
+{
+    // base64url without padding
+    return len / 3 * 4 + (len % 3 ? len % 3 + 1 : 0);
+}
 
-    // remove padding and convert to URL safe form
-    while (value.length() > 0 && value.charAt(value.length() - 1) == '=')
+size_t ArduinoJsonJWT::encode(const uint8_t *data, size_t len, char *out)
+{
+    char *p = out;
+    size_t i = 0;
+    for (; i + 3 <= len; i += 3)
     {
-        value.remove(value.length() - 1);
+        uint32_t bits = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        *p++ = BASE64URL_ALPHABET[(bits >> 18) & 0x3F];
+        *p++ = BASE64URL_ALPHABET[(bits >> 12) & 0x3F];
+        *p++ = BASE64URL_ALPHABET[(bits >> 6) & 0x3F];
+        *p++ = BASE64URL_ALPHABET[bits & 0x3F];
     }
-    value.replace('+', '-');
-    value.replace('/', '_');
-
-    // return as string
-    return value;
+    if (len - i == 1)
+    {
+        *p++ = BASE64URL_ALPHABET[data[i] >> 2];
+        *p++ = BASE64URL_ALPHABET[(data[i] & 0x03) << 4];
+    }
+    else if (len - i == 2)
+    {
+        *p++ = BASE64URL_ALPHABET[data[i] >> 2];
+        *p++ = BASE64URL_ALPHABET[((data[i] & 0x03) << 4) | (data[i + 1] >> 4)];
+        *p++ = BASE64URL_ALPHABET[(data[i + 1] & 0x0F) << 2];
+    }
+    return p - out;
 }
 
-String ArduinoJsonJWT::decode(String value)
+int ArduinoJsonJWT::decode(const char *data, size_t len, uint8_t *out)
 {
-    // convert to standard base64
-    value.replace('-', '+');
-    value.replace('_', '/');
-
-    // prepare buffer of correct length
-    char buffer[base64_decode_expected_len(value.length()) + 1];
+    // a single character left over can't be valid
+    if (len % 4 == 1)
+    {
+        return -1;
+    }
 
-    // decode
-    int len = base64_decode_chars(value.c_str(), value.length(), &buffer[0]);
-    buffer[len] = 0;
+    uint8_t *p = out;
+    uint32_t bits = 0;
+    int count = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        char c = data[i];
+        int value = c >= 'A' && c <= 'Z'   ? c - 'A'
+                    : c >= 'a' && c <= 'z' ? c - 'a' + 26
+                    : c >= '0' && c <= '9' ? c - '0' + 52
+                    : c == '-'             ? 62
+                    : c == '_'             ? 63
+                                           : -1;
+        if (value < 0)
+        {
+            return -1;
+        }
 
-    // return as string
-    return String(buffer);
+        bits = (bits << 6) | value;
+        if (++count == 4)
+        {
+            *p++ = bits >> 16;
+            *p++ = bits >> 8;
+            *p++ = bits;
+            bits = 0;
+            count = 0;
+        }
+    }
+    if (count == 3)
+    {
+        *p++ = bits >> 10;
+        *p++ = bits >> 2;
+    }
+    else if (count == 2)
+    {
+        *p++ = bits >> 4;
+    }
+    return p - out;
 }
@@ -17,31 +17,53 @@
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
-#include <libb64/cdecode.h>
-#include <libb64/cencode.h>
-#include <mbedtls/md.h>
+#include <mbedtls/sha256.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
+// payloads up to this size are decoded on the stack, larger ones on the heap
+#ifndef JWT_PAYLOAD_BUFFER_SIZE
+#define JWT_PAYLOAD_BUFFER_SIZE 192
+#endif
+
+/*
+ * HS256 JSON Web Tokens. Parsing works on spans into the token without copying
+ * it, building writes the token into a single buffer. Tokens can be built and
+ * parsed from several tasks while the secret is changed, each signature is made
+ * with a copy of the key states.
+ */
 class ArduinoJsonJWT
 {
 private:
     String _secret;
 
-    const String JWT_HEADER = "eyJhbGciOiJIUzI1NiIsInR5cCI6IkpXVCJ9";
-    const int JWT_HEADER_SIZE = JWT_HEADER.length();
+    // SHA-256 state after the padded key blocks of HMAC (RFC 2104), computed once per secret
+    mbedtls_sha256_context _inner;
+    mbedtls_sha256_context _outer;
+
+    // guards the secret and the key states
+    SemaphoreHandle_t _keyLock;
+
+    static constexpr const char *JWT_HEADER = "eyJhbGciOiJIUzI1NiIsInR5cCI6IkpXVCJ9";
+    static constexpr size_t JWT_HEADER_SIZE = 36;
+    static constexpr size_t JWT_SIGNATURE_SIZE = 43; // 32 byte HMAC-SHA256, base64url without padding
 
-    String sign(String &value);
+    void sign(const char *data, size_t len, char *signature);
 
-    static String encode(const char *cstr, int len);
-    static String decode(String value);
+    static size_t encodedLength(size_t len);
+    static size_t encode(const uint8_t *data, size_t len, char *out);
+    static int decode(const char *data, size_t len, uint8_t *out);
 
 public:
     ArduinoJsonJWT(String secret);
+    ~ArduinoJsonJWT();
 
     void setSecret(String secret);
     String getSecret();
 
     String buildJWT(JsonObject &payload);
-    void parseJWT(String jwt, JsonDocument &jsonDocument);
+    void parseJWT(const String &jwt, JsonDocument &jsonDocument);
+    void parseJWT(const char *jwt, size_t len, JsonDocument &jsonDocument);
 };
 
 #endif
@@ -26,6 +26,10 @@ void AuthenticationService::begin()
     // Signs in a user if the username and password match. Provides a JWT to be used in the Authorization header in subsequent requests
     _server->on(SIGN_IN_PATH, HTTP_POST, [this](PsychicRequest *request, JsonVariant &json)
                 {
+        // password checks have their own, much lower limit
+        if (!_securityManager->allowRequest(request, RATE_LIMIT_SIGN_IN)) {
+            return request->reply(429);
+        }
         if (json.is<JsonObject>()) {
             String username = json["username"];
             String password = json["password"];
@@ -33,7 +37,7 @@ void AuthenticationService::begin()
             if (authentication.authenticated) {
                 PsychicJsonResponse response = PsychicJsonResponse(request, false);
                 JsonObject root = response.getRoot();
-                root["access_token"] = _securityManager->generateJWT(authentication.user);
+                root["access_token"] = _securityManager->generateJWT(authentication.user.get());
                 return response.send();
             }
         }
@@ -44,6 +48,9 @@ void AuthenticationService::begin()
     // Verifies that the request supplied a valid JWT
     _server->on(VERIFY_AUTHORIZATION_PATH, HTTP_GET, [this](PsychicRequest *request)
                 {
+        if (!_securityManager->allowRequest(request)) {
+            return request->reply(429);
+        }
         Authentication authentication = _securityManager->authenticateRequest(request);
         return request->reply(authentication.authenticated ? 200 : 401); });
 
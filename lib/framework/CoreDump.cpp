@@ -60,14 +60,37 @@ esp_err_t CoreDump::coreDump(PsychicRequest *request)
     }*/
 
     ESP_LOGI(SVK_TAG, "Coredump is %u bytes", coredump_size);
-    httpd_resp_set_status(request->request(), "200 OK");
     PsychicResponse response(request);
     response.setCode(200);
     response.setContentType("application/octet-stream");
+
+    // the image ends with its checksum, which makes a cheap strong validator for If-Range
+    uint8_t checksum[8];
+    size_t checksum_len = MIN(sizeof(checksum), coredump_size);
+    if (esp_flash_read(esp_flash_default_chip, checksum, coredump_addr + coredump_size - checksum_len, checksum_len) == ESP_OK)
+    {
+        char etag[2 * sizeof(checksum) + 3] = "\"";
+        for (size_t i = 0; i < checksum_len; i++)
+            sprintf(etag + 1 + 2 * i, "%02x", checksum[i]);
+        strcat(etag, "\"");
+        response.addHeader("ETag", etag);
+    }
+
+    // resume an interrupted download where it stopped
+    PsychicRange range = request->range(coredump_size, response.getHeader("ETag"));
+    response.setRange(range, coredump_size);
+    if (range.status == RANGE_UNSATISFIABLE)
+    {
+        free(chunk);
+        free(b64);
+        return response.send();
+    }
+
     response.sendHeaders();
-    for (size_t offset = 0; offset < coredump_size; offset += chunk_len)
+    size_t const end = range.start + range.length;
+    for (size_t offset = range.start; offset < end; offset += chunk_len)
     {
-        uint const read_len = MIN(chunk_len, coredump_size - offset);
+        uint const read_len = MIN(chunk_len, end - offset);
         if (esp_flash_read(esp_flash_default_chip, chunk, coredump_addr + offset, read_len))
         {
             ESP_LOGE(SVK_TAG, "Coredump read failed");
@@ -107,6 +107,247 @@ void update_finished()
     vTaskDelay(250 / portTICK_PERIOD_MS);
 }
 
+/**
+ * Hands the HTTP body to the firmware writer, HTTPClient takes care of chunked transfer encoding.
+ */
+class FirmwareWriterStream : public Stream
+{
+public:
+    FirmwareWriterStream(FirmwareWriter *writer) : _writer(writer), _totalBytes(-1), _skip(0) {}
+
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        // a server without Range support sends what we already have again
+        size_t skip = min(size, _skip);
+        _skip -= skip;
+
+        if (size > skip && !_writer->write(buffer + skip, size - skip))
+        {
+            return 0;
+        }
+        if (_totalBytes > 0)
+        {
+            update_progress(received(), _totalBytes);
+        }
+        return size;
+    }
+    size_t write(uint8_t data) override { return write(&data, 1); }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+
+    void setTotal(int totalBytes) { _totalBytes = totalBytes; }
+    void skip(size_t bytes) { _skip = bytes; }
+    int received() { return _writer->received(); }
+
+private:
+    FirmwareWriter *_writer;
+    int _totalBytes;
+    size_t _skip;
+};
+
+/**
+ * What If-Range can use to tell whether the file changed, weak ETags can't be used
+ */
+static String validatorOf(HTTPClient &http)
+{
+    String validator = http.header("ETag");
+    if (validator.length() == 0 || validator.startsWith("W/"))
+    {
+        validator = http.header("Last-Modified");
+    }
+    return validator;
+}
+
+/**
+ * Downloads the firmware into the next OTA partition. Raw images, gzip compressed images (.bin.gz) and
+ * delta patches (.patch) all go through the firmware writer, which keeps its state when the connection
+ * drops. The download then resumes with a Range request after a backoff, If-Range makes sure the file
+ * did not change on the server in between. Filesystem images (littlefs.bin) go to the filesystem
+ * partition with command U_SPIFFS, the settings in /config are kept.
+ */
+String firmwareDownload(WiFiClientSecure &client, const String &url, FirmwareFormat format, int command)
+{
+    const char *headerKeys[] = {"Content-Range", "ETag", "Last-Modified", "x-MD5"};
+
+    FirmwareWriter writer;
+    FirmwareWriterStream stream(&writer);
+    FilesystemUpdate filesystemUpdate;
+    String validator;
+    String error;
+    int totalBytes = -1;
+    bool started = false;
+    bool complete = false;
+
+    for (int attempt = 0; attempt <= OTA_DOWNLOAD_RETRIES; attempt++)
+    {
+        if (attempt > 0)
+        {
+            uint32_t backoff = OTA_DOWNLOAD_BACKOFF_MS << min(attempt - 1, 4);
+            ESP_LOGW(SVK_TAG, "Download interrupted at %d bytes: %s - resuming in %u ms", stream.received(), error.c_str(), backoff);
+#ifdef SERIAL_INFO
+            Serial.printf("Download interrupted at %d bytes: %s - resuming in %u ms\n", stream.received(), error.c_str(), backoff);
+#endif
+            vTaskDelay(backoff / portTICK_PERIOD_MS);
+        }
+
+        HTTPClient http;
+        http.setFollowRedirects(HTTPC_FORCE_FOLLOW_REDIRECTS);
+        http.setTimeout(12000);
+        http.setReuse(false);
+
+        if (!http.begin(client, url))
+        {
+            error = "Invalid download URL";
+            break;
+        }
+        http.collectHeaders(headerKeys, sizeof(headerKeys) / sizeof(headerKeys[0]));
+
+        int offset = stream.received();
+        if (started && offset > 0)
+        {
+            http.addHeader("Range", "bytes=" + String(offset) + "-");
+            if (validator.length() > 0)
+            {
+                http.addHeader("If-Range", validator);
+            }
+        }
+
+        int code = http.GET();
+        if (code < 0 || code >= 500)
+        {
+            // network trouble or a server hiccup, worth another try
+            error = code < 0 ? HTTPClient::errorToString(code) : "HTTP status " + String(code);
+            http.end();
+            continue;
+        }
+
+        if (!started)
+        {
+            if (code != HTTP_CODE_OK)
+            {
+                error = "Download failed with HTTP status " + String(code);
+                http.end();
+                break;
+            }
+
+            totalBytes = http.getSize();
+            stream.setTotal(totalBytes);
+
+            validator = validatorOf(http);
+
+            // the filesystem is unmounted while its partition is overwritten
+            if (command == U_SPIFFS && !filesystemUpdate.begin())
+            {
+                error = "Not enough memory to back up the settings";
+                http.end();
+                break;
+            }
+
+            // compressed images and patches don't tell the size of the firmware
+            if (!Update.begin(format == FIRMWARE_RAW && totalBytes > 0 ? totalBytes : UPDATE_SIZE_UNKNOWN, command))
+            {
+                error = Update.errorString();
+                filesystemUpdate.end();
+                http.end();
+                break;
+            }
+
+            String md5 = http.header("x-MD5");
+            if (md5.length() == 32)
+            {
+                Update.setMD5(md5.c_str());
+            }
+
+            if (!writer.begin(format, command))
+            {
+                Update.abort();
+                filesystemUpdate.end();
+                error = "Not enough memory for the firmware download";
+                http.end();
+                break;
+            }
+
+            started = true;
+            update_started();
+        }
+        else if (code == HTTP_CODE_PARTIAL_CONTENT)
+        {
+            // Content-Range: bytes <first>-<last>/<total>
+            String range = http.header("Content-Range");
+            if (!range.startsWith("bytes ") || range.substring(6).toInt() != offset)
+            {
+                error = "Server sent the wrong range";
+                http.end();
+                break;
+            }
+
+            // chunked responses only tell the size now
+            if (totalBytes <= 0)
+            {
+                totalBytes = range.substring(range.indexOf('/') + 1).toInt();
+                stream.setTotal(totalBytes);
+            }
+        }
+        else if (code == HTTP_CODE_OK && (offset == 0 || validator.length() == 0 || validatorOf(http) == validator))
+        {
+            // a server without Range support sends the same file again. Without a validator a full
+            // response is only checked by the image verification at the end.
+            stream.skip(offset);
+        }
+        else
+        {
+            error = code == HTTP_CODE_OK ? "Firmware changed on the server during the download"
+                                         : "Download failed with HTTP status " + String(code);
+            http.end();
+            break;
+        }
+
+        int result = http.writeToStream(&stream);
+        http.end();
+
+        if (writer.hasFailed())
+        {
+            error = writer.errorString() ? writer.errorString() : "Writing the firmware failed";
+            break;
+        }
+
+        if (totalBytes > 0 ? stream.received() >= totalBytes : result >= 0)
+        {
+            complete = true;
+            break;
+        }
+
+        error = result < 0 ? HTTPClient::errorToString(result) : "Connection closed";
+    }
+
+    if (!complete)
+    {
+        if (started)
+        {
+            writer.abort();
+            Update.abort();
+            filesystemUpdate.end(false);
+        }
+        return error;
+    }
+
+    bool success = writer.end();
+    if (!success || !Update.end(true))
+    {
+        error = !success && writer.errorString() ? String(writer.errorString()) : String(Update.errorString());
+        Update.abort();
+        filesystemUpdate.end(false);
+        return error;
+    }
+
+    // mount the new filesystem and put the settings back
+    filesystemUpdate.end();
+
+    update_finished();
+    return String();
+}
+
 void updateTask(void *param)
 {
     String url = *((String *)param);
@@ -129,53 +370,30 @@ void updateTask(void *param)
 
     client.setTimeout(12000);
 
-    httpUpdate.setFollowRedirects(HTTPC_FORCE_FOLLOW_REDIRECTS);
-    httpUpdate.rebootOnUpdate(true);
+    // gzip compressed images, delta patches and filesystem images are told apart by their name
+    String path = url.substring(0, url.indexOf('?') >= 0 ? url.indexOf('?') : url.length());
+    FirmwareFormat format = path.endsWith(".patch") ? FIRMWARE_DELTA : path.endsWith(".bin.gz") ? FIRMWARE_GZIP : FIRMWARE_RAW;
+    int command = FilesystemUpdate::isImage(path.c_str()) ? U_SPIFFS : U_FLASH;
 
-    String output;
-    httpUpdate.onStart(update_started);
-    httpUpdate.onProgress(update_progress);
-    httpUpdate.onEnd(update_finished);
-
-    t_httpUpdate_return ret = httpUpdate.update(client, url.c_str());
-    JsonObject jsonObject;
+    String error = firmwareDownload(client, url, format, command);
+    if (error.length() == 0)
+    {
+        FSPersistenceBase::shutdown();
+        ESP.restart();
+    }
 
     // Reduce task priority to allow other tasks to run
     vTaskPrioritySet(NULL, tskIDLE_PRIORITY + 1);
 
-    bool _emitEvent = false;
-
-    switch (ret)
-    {
-    case HTTP_UPDATE_FAILED:
-
-        doc["status"] = "error";
-        doc["error"] = httpUpdate.getLastErrorString().c_str();
-        _emitEvent = true;
-
-        ESP_LOGE(SVK_TAG, "HTTP Update failed with error (%d): %s", httpUpdate.getLastError(), httpUpdate.getLastErrorString().c_str());
-#ifdef SERIAL_INFO
-        Serial.printf("HTTP Update failed with error (%d): %s\n", httpUpdate.getLastError(), httpUpdate.getLastErrorString().c_str());
-#endif
-        break;
-    case HTTP_UPDATE_NO_UPDATES:
-
-        doc["status"] = "error";
-        doc["error"] = "Update failed, has same firmware version";
-        _emitEvent = true;
+    doc["status"] = "error";
+    doc["error"] = error;
+    JsonObject jsonObject = doc.as<JsonObject>();
+    _socket->emitEvent(EVENT_OTA_UPDATE, jsonObject);
 
-        ESP_LOGE(SVK_TAG, "HTTP Update failed, has same firmware version");
+    ESP_LOGE(SVK_TAG, "HTTP Update failed: %s", error.c_str());
 #ifdef SERIAL_INFO
-        Serial.println("HTTP Update failed, has same firmware version");
+    Serial.printf("HTTP Update failed: %s\n", error.c_str());
 #endif
-        break;
-    }
-
-    if (_emitEvent)
-    {
-        jsonObject = doc.as<JsonObject>();
-        _socket->emitEvent(EVENT_OTA_UPDATE, jsonObject);
-    }
 
     // delay to allow the event to be sent out
     vTaskDelay(100 / portTICK_PERIOD_MS);
@@ -22,13 +22,25 @@
 #include <PsychicHttp.h>
 #include <SecurityManager.h>
 #include <FirmwareUpdateEvents.h>
+#include <FirmwareWriter.h>
+#include <FilesystemUpdate.h>
+#include <FSPersistence.h>
 
 #include <WiFiClientSecure.h>
-#include <HTTPUpdate.h>
+#include <HTTPClient.h>
 
 #define GITHUB_FIRMWARE_PATH "/rest/downloadUpdate"
 #define OTA_TASK_STACK_SIZE 9216
 
+// attempts to resume an interrupted download, the backoff doubles up to 16 times the initial one
+#ifndef OTA_DOWNLOAD_RETRIES
+#define OTA_DOWNLOAD_RETRIES 5
+#endif
+
+#ifndef OTA_DOWNLOAD_BACKOFF_MS
+#define OTA_DOWNLOAD_BACKOFF_MS 1000
+#endif
+
 class DownloadFirmwareService
 {
 public:
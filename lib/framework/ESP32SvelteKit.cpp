@@ -75,38 +75,46 @@ void ESP32SvelteKit::begin()
 
     _wifiSettingsService.initWiFi();
 
-    // SvelteKit uses a lot of handlers, so we need to increase the max_uri_handlers
-    // WWWData has 77 Endpoints, Framework has 27, and Lighstate Demo has 4
+    // Routes are resolved by PsychicHttp's own router, httpd only needs a slot
+    // for one catch-all per HTTP method in use plus one per WebSocket endpoint
     _server->config.max_uri_handlers = _numberEndpoints;
     _server->listen(80);
 
 #ifdef EMBED_WWW
     // Serve static resources from PROGMEM
-    ESP_LOGV(SVK_TAG, "Registering routes from PROGMEM static resources");
-    WWWData::registerRoutes(
-        [&](const String &uri, const String &contentType, const uint8_t *content, size_t len)
+    // A single handler looks the path up in the generated perfect hash table,
+    // everything else gets "/index.html" so the SvelteKit router can take over
+    ESP_LOGV(SVK_TAG, "Serving %u static resources from PROGMEM", (unsigned int)WWWData::assetCount);
+    _server->onNotFound([](PsychicRequest *request)
+                        {
+        const char *uri = request->uri().c_str();
+        bool brotli = request->acceptsEncoding("br");
+        const WWWAsset *asset = WWWData::find(uri, strcspn(uri, "?"), brotli);
+        if (asset == nullptr)
+        {
+            asset = WWWData::find("/index.html", strlen("/index.html"), brotli);
+        }
+
+        // Only the bundles below /_app/immutable/ may be cached forever. Everything else,
+        // index.html in particular, must be revalidated so a firmware update shows up.
+        PsychicResponse response(request);
+        response.addHeader("Cache-Control", strncmp(asset->path, "/_app/immutable/", 16) == 0 ? "public, immutable, max-age=31536000" : "no-cache");
+        response.addHeader("ETag", asset->etag);
+        response.addHeader("Vary", "Accept-Encoding");
+
+        // The ETag is a hash of the file content, so a match means the browser's copy is current
+        String ifNoneMatch = request->header("If-None-Match");
+        if (ifNoneMatch == "*" || ifNoneMatch.indexOf(asset->etag) >= 0)
         {
-            PsychicHttpRequestCallback requestHandler = [contentType, content, len](PsychicRequest *request)
-            {
-                PsychicResponse response(request);
-                response.setCode(200);
-                response.setContentType(contentType.c_str());
-                response.addHeader("Content-Encoding", "gzip");
-                response.addHeader("Cache-Control", "public, immutable, max-age=31536000");
-                response.setContent(content, len);
-                return response.send();
-            };
-            PsychicWebHandler *handler = new PsychicWebHandler();
-            handler->onRequest(requestHandler);
-            _server->on(uri.c_str(), HTTP_GET, handler);
-
-            // Set default end-point for all non matching requests
-            // this is easier than using webServer.onNotFound()
-            if (uri.equals("/index.html"))
-            {
-                _server->defaultEndpoint->setHandler(handler);
-            }
-        });
+            response.setCode(304);
+            return response.send();
+        }
+
+        response.setCode(200);
+        response.setContentType(asset->mime);
+        response.addHeader("Content-Encoding", asset->encoding);
+        response.setContent(asset->data, asset->len);
+        return response.send(); });
 #else
     // Serve static resources from /www/
     ESP_LOGV(SVK_TAG, "Registering routes from FS /www/ static resources");
@@ -125,7 +133,21 @@ void ESP32SvelteKit::begin()
 
     // Serve static resources from /config/ if set by platformio.ini
 #if SERVE_CONFIG_FILES
+#if FT_ENABLED(SETTINGS_USE_JSON) && !FT_ENABLED(SETTINGS_USE_NVS)
     _server->serveStatic("/config/", ESPFS, "/config/");
+#else
+    // the settings are stored as MessagePack or in NVS, they are exported as JSON at /config/filename.json
+    _server->on("/config/*", HTTP_GET, [](PsychicRequest *request)
+                {
+        String path = request->uri().substring(0, request->uri().indexOf('?') >= 0 ? request->uri().indexOf('?') : request->uri().length());
+        JsonDocument jsonDocument;
+        if (path.indexOf("..") >= 0 || !FSPersistenceBase::exportJSON(&ESPFS, path.c_str(), jsonDocument)) {
+            return request->reply(404);
+        }
+        PsychicJsonResponse response = PsychicJsonResponse(request, false);
+        response.getRoot().set(jsonDocument.as<JsonVariantConst>());
+        return response.send(); });
+#endif
 #endif
 
 #if defined(ENABLE_CORS)
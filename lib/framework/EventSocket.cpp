@@ -47,11 +47,18 @@ void EventSocket::onWSClose(PsychicWebSocketClient *client)
         event_subscriptions.second.remove(client->socket());
     }
     xSemaphoreGive(clientSubscriptionsMutex);
+    _securityManager->releaseSocket(client->socket());
     ESP_LOGI(SVK_TAG, "ws[%s][%u] disconnect", client->remoteIP().toString().c_str(), client->socket());
 }
 
 esp_err_t EventSocket::onFrame(PsychicWebSocketRequest *request, httpd_ws_frame *frame)
 {
+    // drop frames of a flooding client before anything is parsed
+    if (!_securityManager->allowFrame(request->client()->socket()))
+    {
+        return ESP_OK;
+    }
+
     ESP_LOGV(SVK_TAG, "ws[%s][%u] opcode[%d]", request->client()->remoteIP().toString().c_str(),
              request->client()->socket(), frame->type);
 
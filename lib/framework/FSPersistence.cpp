@@ -0,0 +1,577 @@
+/**
+ *   ESP32 SvelteKit
+ *
+ *   A simple, secure and extensible framework for IoT projects for ESP32 platforms
+ *   with responsive Sveltekit front-end built with TailwindCSS and DaisyUI.
+ *   https://github.com/theelims/ESP32-sveltekit
+ *
+ *   Copyright (C) 2018 - 2023 rjwats
+ *   Copyright (C) 2023 - 2025 theelims
+ *
+ *   All Rights Reserved. This software may be modified and distributed under
+ *   the terms of the LGPL v3 license. See the LICENSE file for details.
+ **/
+
+#include <FSPersistence.h>
+#include <PsychicHttp.h>
+#include <SecurityManager.h>
+#include <esp_rom_crc.h>
+
+std::list<FSPersistenceBase *> FSPersistenceBase::_instances;
+SemaphoreHandle_t FSPersistenceBase::_lock = NULL;
+SemaphoreHandle_t FSPersistenceBase::_writing = NULL;
+TaskHandle_t FSPersistenceBase::_task = NULL;
+bool FSPersistenceBase::_stopped = false;
+bool FSPersistenceBase::_paused = false;
+uint32_t FSPersistenceBase::_writeCount = 0;
+
+FSPersistenceBase::FSPersistenceBase(const char *filePath, uint32_t writeDelay, uint32_t maxWriteDelay) : _filePath(filePath),
+                                                                                                            _path(_storagePath(filePath, !FT_ENABLED(SETTINGS_USE_JSON))),
+                                                                                                            _writeDelay(writeDelay),
+                                                                                                            _maxWriteDelay(max(writeDelay, maxWriteDelay)),
+                                                                                                            _dirty(false),
+                                                                                                            _firstChange(0),
+                                                                                                            _lastChange(0),
+                                                                                                            _changes(0),
+                                                                                                            _registered(false)
+{
+    _sectionKey(filePath, _key);
+    _init();
+}
+
+FSPersistenceBase::~FSPersistenceBase()
+{
+    xSemaphoreTake(_writing, portMAX_DELAY);
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _instances.remove(this);
+    xSemaphoreGive(_lock);
+    xSemaphoreGive(_writing);
+}
+
+void FSPersistenceBase::_init()
+{
+    if (_lock == NULL)
+    {
+        _lock = xSemaphoreCreateMutex();
+        _writing = xSemaphoreCreateMutex();
+    }
+}
+
+void FSPersistenceBase::changed()
+{
+    if (_writeDelay == 0)
+    {
+        xSemaphoreTake(_writing, portMAX_DELAY);
+        bool write = !_stopped && !_paused;
+        if (write)
+        {
+            _changes++;
+            _write();
+        }
+        xSemaphoreGive(_writing);
+        if (write || _stopped)
+        {
+            return;
+        }
+        // paused, marked dirty below for resume()
+    }
+
+    uint32_t now = millis();
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    if (_stopped)
+    {
+        xSemaphoreGive(_lock);
+        return;
+    }
+    if (!_dirty)
+    {
+        _dirty = true;
+        _firstChange = now;
+    }
+    _lastChange = now;
+    _changes++;
+
+    // registered on the first change, the list may not be constructed yet when the global services are
+    if (!_registered)
+    {
+        _instances.push_back(this);
+        _registered = true;
+    }
+
+    // written by resume()
+    if (_paused)
+    {
+        xSemaphoreGive(_lock);
+        return;
+    }
+
+    if (_task == NULL &&
+        xTaskCreatePinnedToCore(_flushTask, "FSPersistence", FS_WRITE_STACK_SIZE, NULL, FS_WRITE_PRIORITY, &_task, tskNO_AFFINITY) != pdPASS)
+    {
+        // without the task there is no write-behind, write it right away
+        ESP_LOGE(SVK_TAG, "Couldn't create settings writer task");
+        _task = NULL;
+        _dirty = false;
+        xSemaphoreGive(_lock);
+        xSemaphoreTake(_writing, portMAX_DELAY);
+        _write();
+        xSemaphoreGive(_writing);
+        return;
+    }
+    xSemaphoreGive(_lock);
+
+    // the deadlines changed, let the task recalculate them
+    xTaskNotifyGive(_task);
+}
+
+FSPersistenceBase *FSPersistenceBase::_takeDue(uint32_t now, uint32_t *wait)
+{
+    for (FSPersistenceBase *instance : _instances)
+    {
+        if (!instance->_dirty)
+        {
+            continue;
+        }
+
+        uint32_t quiet = now - instance->_lastChange;
+        uint32_t pending = now - instance->_firstChange;
+        if (wait == NULL || quiet >= instance->_writeDelay || pending >= instance->_maxWriteDelay)
+        {
+            instance->_dirty = false;
+            return instance;
+        }
+        *wait = min(*wait, min(instance->_writeDelay - quiet, instance->_maxWriteDelay - pending));
+    }
+    return NULL;
+}
+
+void FSPersistenceBase::_write()
+{
+    uint32_t started = millis();
+    bool success = writeToFS();
+    _writeCount++;
+
+    ESP_LOGD(SVK_TAG, "%s %s after %u changes in %u ms", success ? "Wrote" : "Failed to write", _filePath, _changes, millis() - started);
+    _changes = 0;
+}
+
+void FSPersistenceBase::_flushTask(void *parameter)
+{
+    for (;;)
+    {
+        // holding _writing while picking the next instance, a flushAll() in between leaves nothing to write twice
+        uint32_t wait = UINT32_MAX;
+        xSemaphoreTake(_writing, portMAX_DELAY);
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        FSPersistenceBase *instance = _stopped || _paused ? NULL : _takeDue(millis(), &wait);
+        xSemaphoreGive(_lock);
+
+        if (instance != NULL)
+        {
+            instance->_write();
+            xSemaphoreGive(_writing);
+            continue;
+        }
+        xSemaphoreGive(_writing);
+
+        ulTaskNotifyTake(pdTRUE, wait == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(wait) + 1);
+    }
+}
+
+void FSPersistenceBase::flushAll()
+{
+    xSemaphoreTake(_writing, portMAX_DELAY);
+    for (;;)
+    {
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        FSPersistenceBase *instance = _stopped || _paused ? NULL : _takeDue(millis(), NULL);
+        xSemaphoreGive(_lock);
+
+        if (instance == NULL)
+        {
+            break;
+        }
+        instance->_write();
+    }
+    xSemaphoreGive(_writing);
+}
+
+void FSPersistenceBase::shutdown(bool flush)
+{
+    if (flush)
+    {
+        flushAll();
+    }
+
+    // waits for a write in progress, nothing is written afterwards
+    xSemaphoreTake(_writing, portMAX_DELAY);
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _stopped = true;
+    for (FSPersistenceBase *instance : _instances)
+    {
+        instance->_dirty = false;
+    }
+    xSemaphoreGive(_lock);
+    xSemaphoreGive(_writing);
+
+    ESP_LOGI(SVK_TAG, "Settings %s, %u files written since boot", flush ? "flushed" : "discarded", _writeCount);
+}
+
+void FSPersistenceBase::pause()
+{
+    flushAll();
+
+    // waits for a write in progress, changes only mark the settings dirty from now on
+    xSemaphoreTake(_writing, portMAX_DELAY);
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _paused = true;
+    xSemaphoreGive(_lock);
+    xSemaphoreGive(_writing);
+}
+
+void FSPersistenceBase::resume()
+{
+    xSemaphoreTake(_writing, portMAX_DELAY);
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _paused = false;
+    xSemaphoreGive(_lock);
+    xSemaphoreGive(_writing);
+
+    // whatever changed in the meantime is newer than the files
+    flushAll();
+}
+
+bool FSPersistenceBase::replaceFile(FS *fs, const String &path, const uint8_t *data, size_t len)
+{
+    String temporary = path + FS_TEMPORARY_SUFFIX;
+
+    File file = fs->open(temporary, "w");
+    if (!file)
+    {
+        return false;
+    }
+    bool written = file.write(data, len) == len;
+    file.flush();
+    file.close();
+
+    // the size as the filesystem sees it, after the file is closed
+    file = written ? fs->open(temporary, "r") : File();
+    written = file && file.size() == len;
+    file.close();
+
+    if (!written)
+    {
+        fs->remove(temporary);
+        return false;
+    }
+    bool renamed = _rename(fs, temporary, path);
+
+    // static file handlers may have indexed the old file
+    PsychicStaticFileHandler::invalidateAll();
+    return renamed;
+}
+
+bool FSPersistenceBase::_rename(FS *fs, const String &from, const String &to)
+{
+    if (fs->rename(from, to))
+    {
+        return true;
+    }
+    // in case the filesystem doesn't replace an existing file
+    fs->remove(to);
+    return fs->rename(from, to);
+}
+
+String FSPersistenceBase::_storagePath(const char *filePath, bool msgPack)
+{
+    String path(filePath);
+    if (!msgPack)
+    {
+        return path;
+    }
+    if (path.endsWith(FS_JSON_EXTENSION))
+    {
+        path.remove(path.length() - strlen(FS_JSON_EXTENSION));
+    }
+    return path + FS_MSGPACK_EXTENSION;
+}
+
+bool FSPersistenceBase::writeFile(FS *fs, const uint8_t *data, size_t len)
+{
+#if FT_ENABLED(SETTINGS_USE_NVS)
+    return _writeSection(data, len);
+#else
+    String temporary = _path + FS_TEMPORARY_SUFFIX;
+    String backup = _path + FS_BACKUP_SUFFIX;
+
+    char trailer[FS_CHECKSUM_SIZE + 1];
+    snprintf(trailer, sizeof(trailer), FS_CHECKSUM_PREFIX "%08x\n", (unsigned int)esp_rom_crc32_le(0, data, len));
+
+    File file = fs->open(temporary, "w");
+    if (!file)
+    {
+        return false;
+    }
+    bool written = file.write(data, len) == len && file.write((const uint8_t *)trailer, FS_CHECKSUM_SIZE) == FS_CHECKSUM_SIZE;
+    // esp_littlefs commits the file when it is closed, the content is in flash before the file is renamed
+    file.close();
+
+    if (!written)
+    {
+        fs->remove(temporary);
+        return false;
+    }
+
+    // a reset in between leaves the temporary file and the backup, both intact
+    bool renamed = (!fs->exists(_path) || _rename(fs, _path, backup)) && _rename(fs, temporary, _path);
+
+    // /config is served as it is with SERVE_CONFIG_FILES, the index must not keep the old size and time
+    PsychicStaticFileHandler::invalidateAll();
+    return renamed;
+#endif
+}
+
+bool FSPersistenceBase::_readCopy(FS *fs, const String &path, bool msgPack, ReadHandler apply)
+{
+    // checked first, opening a missing file for reading logs an error
+    File file = fs->exists(path) ? fs->open(path, "r") : File();
+    if (!file)
+    {
+        return false;
+    }
+
+    size_t size = file.size();
+    std::unique_ptr<uint8_t[]> content(new (std::nothrow) uint8_t[size]);
+    bool complete = size > 0 && content && file.read(content.get(), size) == size;
+    file.close();
+    if (!complete)
+    {
+        return false;
+    }
+
+    if (size >= FS_CHECKSUM_SIZE && memcmp(content.get() + size - FS_CHECKSUM_SIZE, FS_CHECKSUM_PREFIX, FS_CHECKSUM_PREFIX_SIZE) == 0)
+    {
+        size -= FS_CHECKSUM_SIZE;
+        char checksum[9];
+        memcpy(checksum, content.get() + size + FS_CHECKSUM_PREFIX_SIZE, 8);
+        checksum[8] = 0;
+        if (strtoul(checksum, NULL, 16) != esp_rom_crc32_le(0, content.get(), size))
+        {
+            ESP_LOGW(SVK_TAG, "Checksum mismatch in %s", path.c_str());
+            return false;
+        }
+    }
+    else if (msgPack)
+    {
+        // binary files were always written with a checksum
+        ESP_LOGW(SVK_TAG, "Checksum missing in %s", path.c_str());
+        return false;
+    }
+
+    if (!apply(content.get(), size, msgPack))
+    {
+        ESP_LOGW(SVK_TAG, "Invalid settings in %s", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+void FSPersistenceBase::_removeFiles(FS *fs, const String &path)
+{
+    const char *suffixes[] = {"", FS_TEMPORARY_SUFFIX, FS_BACKUP_SUFFIX};
+    for (const char *suffix : suffixes)
+    {
+        String file = path + suffix;
+        if (fs->exists(file))
+        {
+            fs->remove(file);
+        }
+    }
+    PsychicStaticFileHandler::invalidateAll();
+}
+
+void FSPersistenceBase::_sectionKey(const char *filePath, char *key)
+{
+    // the file name without directory and extension, e.g. wifiSettings
+    const char *name = strrchr(filePath, '/');
+    name = name ? name + 1 : filePath;
+    const char *extension = strchr(name, '.');
+    size_t len = extension ? extension - name : strlen(name);
+
+    if (len < NVS_KEY_NAME_MAX_SIZE)
+    {
+        memcpy(key, name, len);
+        key[len] = 0;
+    }
+    else
+    {
+        // too long for a NVS key, shortened and made unique with the CRC of the path
+        snprintf(key, NVS_KEY_NAME_MAX_SIZE, "%.6s~%08x", name, (unsigned int)esp_rom_crc32_le(0, (const uint8_t *)filePath, strlen(filePath)));
+    }
+}
+
+bool FSPersistenceBase::_writeSection(const uint8_t *data, size_t len)
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(FS_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK)
+    {
+        // NVS replaces the blob atomically and checks its CRC itself
+        err = nvs_set_blob(handle, _key, data, len);
+        if (err == ESP_OK)
+        {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(SVK_TAG, "Failed to store %s in NVS: %s", _key, esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
+
+bool FSPersistenceBase::_readSection(const char *key, ReadHandler apply)
+{
+    nvs_handle_t handle;
+    if (nvs_open(FS_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK)
+    {
+        return false;
+    }
+
+    size_t size = 0;
+    std::unique_ptr<uint8_t[]> content;
+    if (nvs_get_blob(handle, key, NULL, &size) == ESP_OK && size > 0)
+    {
+        content.reset(new (std::nothrow) uint8_t[size]);
+        if (content && nvs_get_blob(handle, key, content.get(), &size) != ESP_OK)
+        {
+            content.reset();
+        }
+    }
+    nvs_close(handle);
+    if (!content)
+    {
+        return false;
+    }
+
+    // stored in the configured format, or the other one if SETTINGS_USE_JSON changed since
+    bool msgPack = !FT_ENABLED(SETTINGS_USE_JSON);
+    return apply(content.get(), size, msgPack) || apply(content.get(), size, !msgPack);
+}
+
+bool FSPersistenceBase::readFile(FS *fs, ReadHandler apply)
+{
+    const char *suffixes[] = {"", FS_TEMPORARY_SUFFIX, FS_BACKUP_SUFFIX};
+    bool msgPack = !FT_ENABLED(SETTINGS_USE_JSON);
+    uint32_t started = micros();
+
+    // the configured format first, settings stored in the other format are migrated
+    String paths[] = {_path, _storagePath(_filePath, !msgPack)};
+
+#if FT_ENABLED(SETTINGS_USE_NVS)
+    if (_readSection(_key, apply))
+    {
+        ESP_LOGD(SVK_TAG, "Read %s from NVS in %u us", _key, (unsigned int)(micros() - started));
+
+        // migrated files are kept for a downgrade until NVS was read back on a later boot
+        for (const String &path : paths)
+        {
+            if (fs->exists(path))
+            {
+                ESP_LOGI(SVK_TAG, "Removing %s, the settings are in NVS", path.c_str());
+                _removeFiles(fs, path);
+            }
+        }
+        return true;
+    }
+#endif
+
+    for (int format = 0; format < 2; format++)
+    {
+        for (const char *suffix : suffixes)
+        {
+            String path = paths[format] + suffix;
+            if (!_readCopy(fs, path, format == 0 ? msgPack : !msgPack, apply))
+            {
+                continue;
+            }
+
+            ESP_LOGD(SVK_TAG, "Read %s in %u us", path.c_str(), (unsigned int)(micros() - started));
+
+            // the old file stays for a downgrade, it is removed once the new copy was read on a later boot
+            if (FT_ENABLED(SETTINGS_USE_NVS))
+            {
+                ESP_LOGI(SVK_TAG, "Migrating %s to NVS", path.c_str());
+                writeToFS();
+            }
+            else if (format == 1)
+            {
+                ESP_LOGI(SVK_TAG, "Migrating %s to %s", path.c_str(), _path.c_str());
+                writeToFS();
+            }
+            else if (!suffix[0] && fs->exists(paths[1]))
+            {
+                ESP_LOGI(SVK_TAG, "Removing %s, the settings are in %s", paths[1].c_str(), _path.c_str());
+                _removeFiles(fs, paths[1]);
+            }
+            else if (suffix[0])
+            {
+                // the damaged file must not replace the good backup
+                ESP_LOGW(SVK_TAG, "Recovered %s from %s", _path.c_str(), path.c_str());
+                fs->remove(_path);
+                writeToFS();
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool FSPersistenceBase::exportJSON(FS *fs, const char *filePath, JsonDocument &jsonDocument)
+{
+    const char *suffixes[] = {"", FS_TEMPORARY_SUFFIX, FS_BACKUP_SUFFIX};
+    ReadHandler parse = [&](const uint8_t *data, size_t len, bool msgPack)
+    {
+        DeserializationError error = msgPack ? deserializeMsgPack(jsonDocument, data, len) : deserializeJson(jsonDocument, data, len);
+        return error == DeserializationError::Ok && jsonDocument.is<JsonObject>();
+    };
+
+#if FT_ENABLED(SETTINGS_USE_NVS)
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    _sectionKey(filePath, key);
+    if (_readSection(key, parse))
+    {
+        return true;
+    }
+#endif
+
+    for (bool msgPack : {true, false})
+    {
+        String path = _storagePath(filePath, msgPack);
+        for (const char *suffix : suffixes)
+        {
+            if (_readCopy(fs, path + suffix, msgPack, parse))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void FSPersistenceBase::eraseStore()
+{
+#if FT_ENABLED(SETTINGS_USE_NVS)
+    nvs_handle_t handle;
+    if (nvs_open(FS_NVS_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK)
+    {
+        nvs_erase_all(handle);
+        nvs_commit(handle);
+        nvs_close(handle);
+    }
+#endif
+}
@@ -15,43 +15,222 @@
  *   the terms of the LGPL v3 license. See the LICENSE file for details.
  **/
 
+#include <Features.h>
 #include <StatefulService.h>
 #include <FS.h>
 
+#include <freertos/task.h>
+#include <functional>
+#include <memory>
+#include <new>
+#include <nvs.h>
+
+// quiet period after the last change before the settings are written, 0 writes synchronously on every change
+#ifndef FS_WRITE_DELAY_MS
+#define FS_WRITE_DELAY_MS 500
+#endif
+
+// settings changing continuously are written at least this often
+#ifndef FS_WRITE_MAX_DELAY_MS
+#define FS_WRITE_MAX_DELAY_MS 5000
+#endif
+
+#ifndef FS_WRITE_STACK_SIZE
+#define FS_WRITE_STACK_SIZE 4096
+#endif
+
+#ifndef FS_WRITE_PRIORITY
+#define FS_WRITE_PRIORITY (tskIDLE_PRIORITY + 1)
+#endif
+
+// binary settings replace the .json extension of the file path, the other format is migrated when read
+#define FS_JSON_EXTENSION ".json"
+#define FS_MSGPACK_EXTENSION ".msgpack"
+
+// namespace holding all settings with SETTINGS_USE_NVS, one blob per file path
+#ifndef FS_NVS_NAMESPACE
+#define FS_NVS_NAMESPACE "settings"
+#endif
+
+// settings are written to the temporary file first, the previous version is kept as backup
+#define FS_TEMPORARY_SUFFIX ".tmp"
+#define FS_BACKUP_SUFFIX ".bak"
+
+// appended to every settings file: the prefix, the CRC32 of the content as 8 hex digits and a newline
+#define FS_CHECKSUM_PREFIX "\n#crc32="
+#define FS_CHECKSUM_PREFIX_SIZE 8
+#define FS_CHECKSUM_SIZE 17
+
+/**
+ * @brief Write-behind for FSPersistence
+ *
+ * A change only marks the settings dirty, a background task writes them once
+ * they did not change for the write delay, or after the max write delay at the
+ * latest. A burst of updates, e.g. from a slider, ends up as a single write and
+ * the caller doesn't wait for the flash. Pending writes must be flushed before
+ * the device restarts or goes to sleep, see flushAll() and shutdown(). While
+ * the filesystem is unmounted pause() holds them back.
+ */
+class FSPersistenceBase
+{
+public:
+    virtual ~FSPersistenceBase();
+
+    virtual bool writeToFS() = 0;
+
+    /**
+     * @brief Write all pending settings now, returns once they are in flash
+     */
+    static void flushAll();
+
+    /**
+     * @brief Write or drop all pending settings and stop writing, the last call before a restart,
+     * deep sleep or factory reset
+     * @param flush false to drop pending settings, e.g. when the files are deleted
+     */
+    static void shutdown(bool flush = true);
+
+    /**
+     * @brief Write all pending settings and hold back further writes, e.g. while the filesystem is unmounted
+     */
+    static void pause();
+
+    /**
+     * @brief Write what changed since pause() and go on as usual
+     */
+    static void resume();
+
+    /**
+     * @brief Write a file as it is through a temporary file, which is renamed to it once its size is checked
+     * @return false if the file could not be written completely, the previous file is kept then
+     */
+    static bool replaceFile(FS *fs, const String &path, const uint8_t *data, size_t len);
+
+    /**
+     * @brief Load a settings file in whichever format it is stored, for debugging
+     * @param filePath the path as given to FSPersistence, e.g. /config/wifiSettings.json
+     * @return false if there is no intact copy
+     */
+    static bool exportJSON(FS *fs, const char *filePath, JsonDocument &jsonDocument);
+
+    /**
+     * @brief Erase all settings stored in NVS, the files are deleted by the factory reset
+     */
+    static void eraseStore();
+
+    /**
+     * @brief Number of settings files written since boot
+     */
+    static uint32_t writeCount() { return _writeCount; }
+
+protected:
+    typedef std::function<bool(const uint8_t *data, size_t len, bool msgPack)> ReadHandler;
+
+    FSPersistenceBase(const char *filePath, uint32_t writeDelay, uint32_t maxWriteDelay);
+
+    /**
+     * @brief Called by the update handler, writes now or schedules a write
+     */
+    void changed();
+
+    /**
+     * @brief Replace the file atomically
+     *
+     * The data is written with a CRC trailer to a temporary file, which is committed
+     * by closing it and renamed to the file. The previous version is kept as backup. With
+     * SETTINGS_USE_NVS the data goes to a blob in NVS instead.
+     */
+    bool writeFile(FS *fs, const uint8_t *data, size_t len);
+
+    /**
+     * @brief Pass the newest intact copy of the file to apply
+     *
+     * Tried in turn are the file, a temporary file which was completely written
+     * before a reset and the backup. Copies with a CRC mismatch are skipped without
+     * being parsed, JSON files without trailer from older versions are passed as
+     * they are. A damaged file is repaired by writing the recovered settings back.
+     * Without any copy the same is done for the file in the other format, which is
+     * then migrated to the configured one. With SETTINGS_USE_NVS the blob in NVS is
+     * read first, settings still in a file are migrated to NVS. Migrated files are
+     * only removed once the new copy is read on a later boot, so a downgrade right
+     * after the update still finds them.
+     * @param apply Parses the data as MessagePack or JSON and updates the state, returns false if it is invalid
+     * @return false if there is no intact copy
+     */
+    bool readFile(FS *fs, ReadHandler apply);
+
+    const char *_filePath;
+    String _path;                     // _filePath with the extension of the configured format
+    char _key[NVS_KEY_NAME_MAX_SIZE]; // NVS key derived from the file name
+
+private:
+    uint32_t _writeDelay;
+    uint32_t _maxWriteDelay;
+    bool _dirty;
+    uint32_t _firstChange;
+    uint32_t _lastChange;
+    uint32_t _changes;
+    bool _registered;
+
+    // the list of instances and their dirty flags are guarded by _lock, the writes by _writing
+    static std::list<FSPersistenceBase *> _instances;
+    static SemaphoreHandle_t _lock;
+    static SemaphoreHandle_t _writing;
+    static TaskHandle_t _task;
+    static bool _stopped;
+    static bool _paused;
+    static uint32_t _writeCount;
+
+    static void _init();
+    static bool _rename(FS *fs, const String &from, const String &to);
+    static String _storagePath(const char *filePath, bool msgPack);
+    static bool _readCopy(FS *fs, const String &path, bool msgPack, ReadHandler apply);
+    static void _removeFiles(FS *fs, const String &path);
+    static void _sectionKey(const char *filePath, char *key);
+    static bool _readSection(const char *key, ReadHandler apply);
+    bool _writeSection(const uint8_t *data, size_t len);
+    static FSPersistenceBase *_takeDue(uint32_t now, uint32_t *wait);
+    void _write();
+    static void _flushTask(void *parameter);
+};
+
 template <class T>
-class FSPersistence
+class FSPersistence : public FSPersistenceBase
 {
 public:
     FSPersistence(JsonStateReader<T> stateReader,
                   JsonStateUpdater<T> stateUpdater,
                   StatefulService<T> *statefulService,
                   FS *fs,
-                  const char *filePath) : _stateReader(stateReader),
-                                          _stateUpdater(stateUpdater),
-                                          _statefulService(statefulService),
-                                          _fs(fs),
-                                          _filePath(filePath),
-                                          _updateHandlerId(0)
+                  const char *filePath,
+                  uint32_t writeDelay = FS_WRITE_DELAY_MS,
+                  uint32_t maxWriteDelay = FS_WRITE_MAX_DELAY_MS) : FSPersistenceBase(filePath, writeDelay, maxWriteDelay),
+                                                                    _stateReader(stateReader),
+                                                                    _stateUpdater(stateUpdater),
+                                                                    _statefulService(statefulService),
+                                                                    _fs(fs),
+                                                                    _updateHandlerId(0)
     {
         enableUpdateHandler();
     }
 
     void readFromFS()
     {
-        File settingsFile = _fs->open(_filePath, "r");
-
-        if (settingsFile)
-        {
+        bool success = readFile(_fs, [&](const uint8_t *data, size_t len, bool msgPack)
+                                {
             JsonDocument jsonDocument;
-            DeserializationError error = deserializeJson(jsonDocument, settingsFile);
-            if (error == DeserializationError::Ok && jsonDocument.is<JsonObject>())
+            DeserializationError error = msgPack ? deserializeMsgPack(jsonDocument, data, len) : deserializeJson(jsonDocument, data, len);
+            if (error != DeserializationError::Ok || !jsonDocument.is<JsonObject>())
             {
-                JsonObject jsonObject = jsonDocument.as<JsonObject>();
-                _statefulService->updateWithoutPropagation(jsonObject, _stateUpdater, _filePath);
-                settingsFile.close();
-                return;
+                return false;
             }
-            settingsFile.close();
+            JsonObject jsonObject = jsonDocument.as<JsonObject>();
+            _statefulService->updateWithoutPropagation(jsonObject, _stateUpdater, _filePath);
+            return true; });
+
+        if (success)
+        {
+            return;
         }
 
         // If we reach here we have not been successful in loading the config and hard-coded defaults are now applied.
@@ -61,28 +240,40 @@ public:
         writeToFS();
     }
 
-    bool writeToFS()
+    bool writeToFS() override
     {
         // create and populate a new json object
         JsonDocument jsonDocument;
         JsonObject jsonObject = jsonDocument.to<JsonObject>();
         _statefulService->read(jsonObject, _stateReader);
 
+#if !FT_ENABLED(SETTINGS_USE_NVS)
         // make directories if required
         mkdirs();
+#endif
 
-        // serialize it to filesystem
-        File settingsFile = _fs->open(_filePath, "w");
-
-        // failed to open file, return false
-        if (!settingsFile)
+        // serialize it to memory first, the checksum is written after it
+#if FT_ENABLED(SETTINGS_USE_JSON)
+        size_t len = measureJson(jsonDocument);
+#else
+        size_t len = measureMsgPack(jsonDocument);
+#endif
+        std::unique_ptr<char[]> buffer(new (std::nothrow) char[len + 1]);
+        if (!buffer)
         {
             return false;
         }
+#if FT_ENABLED(SETTINGS_USE_JSON)
+        serializeJson(jsonDocument, buffer.get(), len + 1);
+#else
+        serializeMsgPack(jsonDocument, buffer.get(), len);
+#endif
 
-        // serialize the data to the file
-        serializeJson(jsonDocument, settingsFile);
-        settingsFile.close();
+        // failed to write the file, return false
+        if (!writeFile(_fs, (const uint8_t *)buffer.get(), len))
+        {
+            return false;
+        }
         return true;
     }
 
@@ -100,7 +291,7 @@ public:
         if (!_updateHandlerId)
         {
             _updateHandlerId = _statefulService->addUpdateHandler([&](const String &originId)
-                                                                  { writeToFS(); });
+                                                                  { changed(); });
         }
     }
 
@@ -109,7 +300,6 @@ private:
     JsonStateUpdater<T> _stateUpdater;
     StatefulService<T> *_statefulService;
     FS *_fs;
-    const char *_filePath;
     update_handler_id_t _updateHandlerId;
 
     // We assume we have a _filePath with format "/directory1/directory2/filename"
@@ -46,6 +46,10 @@ esp_err_t FactoryResetService::handleRequest(PsychicRequest *request)
  */
 void FactoryResetService::factoryReset()
 {
+    // drop pending settings, they would recreate the files
+    FSPersistenceBase::shutdown(false);
+    FSPersistenceBase::eraseStore();
+
     File root = fs->open(FS_CONFIG_DIRECTORY);
     File file;
     while (file = root.openNextFile())
@@ -62,6 +62,16 @@
 #define EVENT_USE_JSON 0
 #endif
 
+// Use JSON for the settings files. Default, use MessagePack for the settings files
+#ifndef SETTINGS_USE_JSON
+#define SETTINGS_USE_JSON 0
+#endif
+
+// Store all settings in one NVS namespace instead of a file each, off by default
+#ifndef SETTINGS_USE_NVS
+#define SETTINGS_USE_NVS 0
+#endif
+
 // Endpoint for Core Dump, off by default
 #ifndef FT_COREDUMP
 #define FT_COREDUMP 0
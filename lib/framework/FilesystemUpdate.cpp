@@ -0,0 +1,112 @@
+/**
+ *   ESP32 SvelteKit
+ *
+ *   A simple, secure and extensible framework for IoT projects for ESP32 platforms
+ *   with responsive Sveltekit front-end built with TailwindCSS and DaisyUI.
+ *   https://github.com/theelims/ESP32-sveltekit
+ *
+ *   Copyright (C) 2023 - 2025 theelims
+ *
+ *   All Rights Reserved. This software may be modified and distributed under
+ *   the terms of the LGPL v3 license. See the LICENSE file for details.
+ **/
+
+#include <FilesystemUpdate.h>
+#include <FSPersistence.h>
+#include <PsychicHttp.h>
+#include <strings.h>
+#include <new>
+
+bool FilesystemUpdate::begin()
+{
+    end();
+    _config.clear();
+
+    // pending settings go into the backup, later changes wait until the filesystem is back
+    FSPersistenceBase::pause();
+
+    // settings are stored flat within the config directory
+    File root = ESPFS.open(FS_CONFIG_DIRECTORY);
+    File file;
+    while (root && (file = root.openNextFile()))
+    {
+        ConfigFile backup;
+        backup.path = file.path();
+        backup.size = file.size();
+        backup.content.reset(new (std::nothrow) uint8_t[backup.size + 1]);
+        if (!backup.content)
+        {
+            ESP_LOGE(SVK_TAG, "Not enough memory to back up %s", file.path());
+            file.close();
+            root.close();
+            _config.clear();
+            FSPersistenceBase::resume();
+            return false;
+        }
+        file.read(backup.content.get(), backup.size);
+        file.close();
+        _config.push_back(std::move(backup));
+    }
+    root.close();
+
+    ESP_LOGI(SVK_TAG, "Backed up %u settings files, unmounting filesystem", (unsigned)_config.size());
+    ESPFS.end();
+    _running = true;
+    return true;
+}
+
+void FilesystemUpdate::end(bool intact)
+{
+    if (!_running)
+    {
+        return;
+    }
+    _running = false;
+
+    // a partial image may still mount, but with half of /www missing
+    if (!intact)
+    {
+        ESP_LOGW(SVK_TAG, "Filesystem image incomplete, formatting");
+        ESPFS.format();
+    }
+    if (!ESPFS.begin(false))
+    {
+        ESP_LOGW(SVK_TAG, "New filesystem does not mount, formatting");
+        ESPFS.begin(true);
+    }
+    ESPFS.mkdir(FS_CONFIG_DIRECTORY);
+
+    for (ConfigFile &backup : _config)
+    {
+        if (!FSPersistenceBase::replaceFile(&ESPFS, backup.path, backup.content.get(), backup.size))
+        {
+            ESP_LOGE(SVK_TAG, "Could not restore %s", backup.path.c_str());
+        }
+    }
+    ESP_LOGI(SVK_TAG, "Restored %u settings files", (unsigned)_config.size());
+    _config.clear();
+
+    // settings changed during the update go on top
+    FSPersistenceBase::resume();
+
+    // whatever the cache knew about /www is gone
+    PsychicStaticFileHandler::invalidateAll();
+}
+
+bool FilesystemUpdate::isImage(const char *name)
+{
+    // ignore a query string in URLs
+    const char *query = strchr(name, '?');
+    size_t len = query ? query - name : strlen(name);
+
+    static const char *suffixes[] = {"littlefs.bin", "littlefs.bin.gz"};
+    for (const char *suffix : suffixes)
+    {
+        size_t suffixLen = strlen(suffix);
+        if (len >= suffixLen && strncasecmp(name + len - suffixLen, suffix, suffixLen) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
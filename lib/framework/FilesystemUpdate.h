@@ -0,0 +1,71 @@
+#ifndef FilesystemUpdate_h
+#define FilesystemUpdate_h
+
+/**
+ *   ESP32 SvelteKit
+ *
+ *   A simple, secure and extensible framework for IoT projects for ESP32 platforms
+ *   with responsive Sveltekit front-end built with TailwindCSS and DaisyUI.
+ *   https://github.com/theelims/ESP32-sveltekit
+ *
+ *   Copyright (C) 2023 - 2025 theelims
+ *
+ *   All Rights Reserved. This software may be modified and distributed under
+ *   the terms of the LGPL v3 license. See the LICENSE file for details.
+ **/
+
+#include <Arduino.h>
+#include <ESPFS.h>
+#include <FactoryResetService.h>
+
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Keeps the settings in /config across a filesystem image update
+ *
+ * begin() copies the files in FS_CONFIG_DIRECTORY to RAM and unmounts the
+ * filesystem, so the partition can be overwritten with Update.begin(size, U_SPIFFS).
+ * end() mounts the new filesystem and writes the settings back. After a failed
+ * update, or if the new image does not mount, the partition is formatted so the
+ * settings survive nevertheless. Settings changed during the update are held back
+ * by FSPersistence and written after the restore.
+ */
+class FilesystemUpdate
+{
+public:
+    FilesystemUpdate() : _running(false) {}
+    ~FilesystemUpdate() { end(); }
+
+    /**
+     * @brief Back up the settings and unmount the filesystem
+     * @return false if there is not enough memory for the backup
+     */
+    bool begin();
+
+    /**
+     * @brief Mount the filesystem again and restore the settings, does nothing if not running
+     * @param intact false if the image was only partially written, the partition is formatted then
+     */
+    void end(bool intact = true);
+
+    bool isRunning() { return _running; }
+
+    /**
+     * @brief Whether a file name or URL is a filesystem image, e.g. littlefs.bin or littlefs.bin.gz
+     */
+    static bool isImage(const char *name);
+
+private:
+    struct ConfigFile
+    {
+        String path;
+        std::unique_ptr<uint8_t[]> content;
+        size_t size;
+    };
+
+    std::vector<ConfigFile> _config;
+    bool _running;
+};
+
+#endif // end FilesystemUpdate_h
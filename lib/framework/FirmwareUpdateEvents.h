@@ -28,6 +28,8 @@
  *   "progress": number,      // Progress percentage (0-100)
  *   "bytes_written": number, // Optional: Bytes written so far
  *   "total_bytes": number,   // Optional: Total bytes to write
+ *   "network_rate": number,  // Optional: Upload only, bytes per second received from the network
+ *   "flash_rate": number,    // Optional: Upload only, bytes per second written to flash
  *   "error": string          // Optional: Error message if status is "error"
  * }
  * 
@@ -45,6 +47,7 @@
  * 
  * Progress:
  * {"status":"progress","progress":45,"bytes_written":102400,"total_bytes":227328}
+ * {"status":"progress","progress":45,"bytes_written":102400,"total_bytes":227328,"network_rate":412000,"flash_rate":156000}
  * 
  * Finished:
  * {"status":"finished","progress":100}
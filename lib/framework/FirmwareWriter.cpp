@@ -0,0 +1,600 @@
+/**
+ *   ESP32 SvelteKit
+ *
+ *   A simple, secure and extensible framework for IoT projects for ESP32 platforms
+ *   with responsive Sveltekit front-end built with TailwindCSS and DaisyUI.
+ *   https://github.com/theelims/ESP32-sveltekit
+ *
+ *   Copyright (C) 2018 - 2023 rjwats
+ *   Copyright (C) 2023 - 2025 theelims
+ *
+ *   All Rights Reserved. This software may be modified and distributed under
+ *   the terms of the LGPL v3 license. See the LICENSE file for details.
+ **/
+
+#include <FirmwareWriter.h>
+#include <SecurityManager.h>
+#include <esp_rom_crc.h>
+#include <esp_ota_ops.h>
+
+// gzip header flags, RFC 1952
+#define GZIP_FHCRC 0x02
+#define GZIP_FEXTRA 0x04
+#define GZIP_FNAME 0x08
+#define GZIP_FCOMMENT 0x10
+
+#define BSDIFF_MAGIC "ENDSLEY/BSDIFF43"
+
+// bsdiff offsets are sign and magnitude, little endian
+static int64_t offtin(const uint8_t *buf)
+{
+    int64_t value = buf[7] & 0x7F;
+    for (int i = 6; i >= 0; i--)
+    {
+        value = (value << 8) | buf[i];
+    }
+    return (buf[7] & 0x80) ? -value : value;
+}
+
+FirmwareWriter::FirmwareWriter() : _buffers{NULL, NULL},
+                                   _free(NULL),
+                                   _full(NULL),
+                                   _done(NULL),
+                                   _task(NULL),
+                                   _current(NULL),
+                                   _fill(0),
+                                   _failed(false),
+                                   _aborting(false),
+                                   _error(NULL),
+                                   _format(FIRMWARE_RAW),
+                                   _command(U_FLASH),
+                                   _gzipState(GZIP_HEADER),
+                                   _inflator(NULL),
+                                   _window(NULL),
+                                   _windowPos(0),
+                                   _trailerLen(0),
+                                   _crc(0),
+                                   _inflated(0),
+                                   _headerLen(0),
+                                   _patchState(PATCH_HEADER),
+                                   _oldPartition(NULL),
+                                   _oldBuffer(NULL),
+                                   _controlLen(0),
+                                   _diffLen(0),
+                                   _extraLen(0),
+                                   _seek(0),
+                                   _oldPos(0),
+                                   _newPos(0),
+                                   _newSize(0),
+                                   _started(0),
+                                   _waited(0),
+                                   _received(0),
+                                   _flashTime(0),
+                                   _written(0),
+                                   _consumed(0)
+{
+}
+
+FirmwareWriter::~FirmwareWriter()
+{
+    abort();
+}
+
+bool FirmwareWriter::begin(FirmwareFormat format, int command)
+{
+    // a previous upload that was never finished
+    abort();
+
+    // patches are made against the running firmware
+    if (format == FIRMWARE_DELTA && command != U_FLASH)
+    {
+        ESP_LOGE(SVK_TAG, "Delta patches are only supported for firmware");
+        return false;
+    }
+
+    _buffers[0] = (uint8_t *)malloc(OTA_WRITER_BUFFER_SIZE);
+    _buffers[1] = (uint8_t *)malloc(OTA_WRITER_BUFFER_SIZE);
+    _free = xQueueCreate(2, sizeof(uint8_t *));
+    _full = xQueueCreate(2, sizeof(Chunk));
+    _done = xSemaphoreCreateBinary();
+
+    _format = format;
+    _command = command;
+    if (_format != FIRMWARE_RAW)
+    {
+        _inflator = (tinfl_decompressor *)malloc(sizeof(tinfl_decompressor));
+        _window = (uint8_t *)malloc(TINFL_LZ_DICT_SIZE);
+    }
+    if (_format == FIRMWARE_DELTA)
+    {
+        _oldPartition = esp_ota_get_running_partition();
+        _oldBuffer = (uint8_t *)malloc(OTA_PATCH_BUFFER_SIZE);
+    }
+
+    if (!_buffers[0] || !_buffers[1] || !_free || !_full || !_done ||
+        (_format != FIRMWARE_RAW && (!_inflator || !_window)) ||
+        (_format == FIRMWARE_DELTA && (!_oldPartition || !_oldBuffer)))
+    {
+        ESP_LOGE(SVK_TAG, "Not enough memory for the firmware writer");
+        _release();
+        return false;
+    }
+
+    xQueueSend(_free, &_buffers[0], 0);
+    xQueueSend(_free, &_buffers[1], 0);
+
+    _current = NULL;
+    _fill = 0;
+    _failed = false;
+    _aborting = false;
+    _error = NULL;
+    _started = millis();
+    _waited = 0;
+    _received = 0;
+    _flashTime = 0;
+    _written = 0;
+    _consumed = 0;
+
+    _gzipState = GZIP_HEADER;
+    _windowPos = 0;
+    _trailerLen = 0;
+    _crc = 0;
+    _inflated = 0;
+    _headerLen = 0;
+    if (_format != FIRMWARE_RAW)
+    {
+        tinfl_init(_inflator);
+    }
+
+    _patchState = PATCH_HEADER;
+    _controlLen = 0;
+    _oldPos = 0;
+    _newPos = 0;
+    _newSize = 0;
+
+    if (xTaskCreatePinnedToCore(_writerTask, "FirmwareWriter", OTA_WRITER_STACK_SIZE, this, OTA_WRITER_PRIORITY, &_task, tskNO_AFFINITY) != pdPASS)
+    {
+        ESP_LOGE(SVK_TAG, "Couldn't create firmware writer task");
+        _task = NULL;
+        _release();
+        return false;
+    }
+
+    return true;
+}
+
+bool FirmwareWriter::write(const uint8_t *data, size_t len)
+{
+    if (_task == NULL || _failed)
+    {
+        return false;
+    }
+
+    _received += len;
+
+    while (len > 0)
+    {
+        if (_current == NULL)
+        {
+            // blocks while the flash is still busy with both buffers
+            uint32_t waitStart = millis();
+            xQueueReceive(_free, &_current, portMAX_DELAY);
+            _waited += millis() - waitStart;
+            _fill = 0;
+
+            if (_failed)
+            {
+                return false;
+            }
+        }
+
+        size_t copy = min(len, (size_t)OTA_WRITER_BUFFER_SIZE - _fill);
+        memcpy(_current + _fill, data, copy);
+        _fill += copy;
+        data += copy;
+        len -= copy;
+
+        if (_fill == OTA_WRITER_BUFFER_SIZE)
+        {
+            _queue(_current, _fill);
+            _current = NULL;
+        }
+    }
+
+    return true;
+}
+
+bool FirmwareWriter::end()
+{
+    if (_task == NULL)
+    {
+        return false;
+    }
+
+    if (_current != NULL && _fill > 0)
+    {
+        _queue(_current, _fill);
+        _current = NULL;
+    }
+
+    _stop();
+
+    if (_format != FIRMWARE_RAW && !_failed && _gzipState != GZIP_DONE)
+    {
+        _fail("Compressed firmware is incomplete");
+    }
+    if (_format == FIRMWARE_DELTA && !_failed && _patchState != PATCH_DONE)
+    {
+        _fail("Delta patch is incomplete");
+    }
+
+    bool success = !_failed;
+    ESP_LOGI(SVK_TAG, "Firmware written: %u bytes, network %u B/s, flash %u B/s", (unsigned)_written, networkRate(), flashRate());
+
+    _release();
+    return success;
+}
+
+void FirmwareWriter::abort()
+{
+    if (_task != NULL)
+    {
+        _aborting = true;
+        _stop();
+    }
+
+    _release();
+}
+
+uint32_t FirmwareWriter::networkRate()
+{
+    uint32_t elapsed = millis() - _started - _waited;
+    return elapsed ? (uint64_t)_received * 1000 / elapsed : 0;
+}
+
+uint32_t FirmwareWriter::flashRate()
+{
+    uint32_t elapsed = _flashTime;
+    return elapsed ? (uint64_t)_written * 1000 / elapsed : 0;
+}
+
+bool FirmwareWriter::_queue(uint8_t *data, size_t len)
+{
+    Chunk chunk = {data, len};
+    return xQueueSend(_full, &chunk, portMAX_DELAY) == pdTRUE;
+}
+
+void FirmwareWriter::_fail(const char *error)
+{
+    if (!_failed)
+    {
+        ESP_LOGE(SVK_TAG, "Firmware write failed: %s", error);
+        _error = error;
+        _failed = true;
+    }
+}
+
+bool FirmwareWriter::validImage(const uint8_t *data, size_t len)
+{
+    // magic byte at offset 0, chip ID at offset 12
+    return len > 12 && data[0] == ESP_MAGIC_BYTE && data[12] == ESP_CHIP_ID;
+}
+
+void FirmwareWriter::_flash(const uint8_t *data, size_t len)
+{
+    if (_command == U_FLASH)
+    {
+        // magic byte and chip type of the image, before its first byte is flashed. Compressed images
+        // and patches can only be checked here, once they are inflated and patched.
+        if (_headerLen < sizeof(_header))
+        {
+            size_t copy = min(len, sizeof(_header) - _headerLen);
+            memcpy(_header + _headerLen, data, copy);
+            _headerLen += copy;
+
+            if (_headerLen == sizeof(_header) && !validImage(_header, _headerLen))
+            {
+                _fail("Wrong firmware for this device");
+                return;
+            }
+        }
+    }
+
+    uint32_t writeStart = millis();
+    if (Update.write((uint8_t *)data, len) != len)
+    {
+        _fail(Update.errorString());
+    }
+    _flashTime += millis() - writeStart;
+    _written += len;
+}
+
+size_t FirmwareWriter::_gzipHeader(const uint8_t *data, size_t len)
+{
+    // the whole header has to be in the first buffer, which is plenty
+    if (len < 10 || data[0] != 0x1f || data[1] != 0x8b || data[2] != 8)
+    {
+        return 0;
+    }
+
+    uint8_t flags = data[3];
+    size_t pos = 10;
+
+    if (flags & GZIP_FEXTRA)
+    {
+        if (pos + 2 > len)
+        {
+            return 0;
+        }
+        pos += 2 + (data[pos] | (data[pos + 1] << 8));
+    }
+    if (flags & GZIP_FNAME)
+    {
+        while (pos < len && data[pos])
+            pos++;
+        pos++;
+    }
+    if (flags & GZIP_FCOMMENT)
+    {
+        while (pos < len && data[pos])
+            pos++;
+        pos++;
+    }
+    if (flags & GZIP_FHCRC)
+    {
+        pos += 2;
+    }
+
+    return pos <= len ? pos : 0;
+}
+
+void FirmwareWriter::_inflate(const uint8_t *data, size_t len)
+{
+    size_t pos = 0;
+
+    if (_gzipState == GZIP_HEADER)
+    {
+        pos = _gzipHeader(data, len);
+        if (pos == 0)
+        {
+            _fail("Not a gzip compressed firmware");
+            return;
+        }
+        _gzipState = GZIP_DATA;
+    }
+
+    while (_gzipState == GZIP_DATA && !_failed)
+    {
+        size_t in = len - pos;
+        size_t out = TINFL_LZ_DICT_SIZE - _windowPos;
+        tinfl_status status = tinfl_decompress(_inflator, data + pos, &in, _window, _window + _windowPos, &out, TINFL_FLAG_HAS_MORE_INPUT);
+        pos += in;
+
+        if (out > 0)
+        {
+            _output(_window + _windowPos, out);
+            _windowPos = (_windowPos + out) & (TINFL_LZ_DICT_SIZE - 1);
+        }
+
+        if (status == TINFL_STATUS_DONE)
+        {
+            _gzipState = GZIP_TRAILER;
+        }
+        else if (status < 0)
+        {
+            _fail("Compressed firmware is corrupt");
+        }
+        else if (status == TINFL_STATUS_NEEDS_MORE_INPUT && pos == len)
+        {
+            return;
+        }
+        else if (in == 0 && out == 0)
+        {
+            _fail("Compressed firmware is corrupt");
+        }
+    }
+
+    // CRC32 and size of the inflated data, both little endian
+    while (_gzipState == GZIP_TRAILER && pos < len)
+    {
+        _trailer[_trailerLen++] = data[pos++];
+        if (_trailerLen == sizeof(_trailer))
+        {
+            uint32_t crc = _trailer[0] | (_trailer[1] << 8) | (_trailer[2] << 16) | ((uint32_t)_trailer[3] << 24);
+            uint32_t size = _trailer[4] | (_trailer[5] << 8) | (_trailer[6] << 16) | ((uint32_t)_trailer[7] << 24);
+            if (crc != _crc || size != (uint32_t)_inflated)
+            {
+                _fail("Compressed firmware checksum mismatch");
+                return;
+            }
+            _gzipState = GZIP_DONE;
+        }
+    }
+}
+
+void FirmwareWriter::_stop()
+{
+    // an empty chunk tells the writer to finish what is queued and quit
+    _queue(NULL, 0);
+    xSemaphoreTake(_done, portMAX_DELAY);
+    _task = NULL;
+}
+
+void FirmwareWriter::_release()
+{
+    if (_free)
+        vQueueDelete(_free);
+    if (_full)
+        vQueueDelete(_full);
+    if (_done)
+        vSemaphoreDelete(_done);
+    free(_buffers[0]);
+    free(_buffers[1]);
+
+    free(_inflator);
+    free(_window);
+    free(_oldBuffer);
+
+    _buffers[0] = _buffers[1] = NULL;
+    _inflator = NULL;
+    _window = NULL;
+    _oldBuffer = NULL;
+    _free = _full = NULL;
+    _done = NULL;
+    _current = NULL;
+}
+
+void FirmwareWriter::_output(const uint8_t *data, size_t len)
+{
+    // the gzip trailer covers the inflated stream, patch or image
+    _crc = esp_rom_crc32_le(_crc, data, len);
+    _inflated += len;
+
+    if (_format == FIRMWARE_DELTA)
+        _patch(data, len);
+    else
+        _flash(data, len);
+}
+
+void FirmwareWriter::_nextSegment()
+{
+    if (_diffLen > 0)
+    {
+        _patchState = PATCH_DIFF;
+    }
+    else if (_extraLen > 0)
+    {
+        _patchState = PATCH_EXTRA;
+    }
+    else
+    {
+        _oldPos += _seek;
+        _seek = 0;
+        _patchState = _newPos == _newSize ? PATCH_DONE : PATCH_CONTROL;
+    }
+}
+
+void FirmwareWriter::_patch(const uint8_t *data, size_t len)
+{
+    while (len > 0 && !_failed)
+    {
+        switch (_patchState)
+        {
+        case PATCH_HEADER:
+        case PATCH_CONTROL:
+        {
+            size_t copy = min(len, sizeof(_control) - _controlLen);
+            memcpy(_control + _controlLen, data, copy);
+            _controlLen += copy;
+            data += copy;
+            len -= copy;
+
+            if (_controlLen < sizeof(_control))
+            {
+                break;
+            }
+            _controlLen = 0;
+
+            if (_patchState == PATCH_HEADER)
+            {
+                // magic and size of the new image
+                _newSize = offtin(_control + 16);
+                if (memcmp(_control, BSDIFF_MAGIC, 16) || _newSize <= 0)
+                {
+                    _fail("Not a delta patch");
+                    break;
+                }
+                _patchState = PATCH_CONTROL;
+                break;
+            }
+
+            // bytes to add to the old image, bytes to copy from the patch, how far to move in the old image
+            _diffLen = offtin(_control);
+            _extraLen = offtin(_control + 8);
+            _seek = offtin(_control + 16);
+            if (_diffLen < 0 || _extraLen < 0 || _newPos + _diffLen + _extraLen > _newSize ||
+                _oldPos < 0 || _oldPos + _diffLen > _oldPartition->size)
+            {
+                _fail("Delta patch is corrupt");
+                break;
+            }
+            _nextSegment();
+            break;
+        }
+
+        case PATCH_DIFF:
+        {
+            size_t copy = min((int64_t)min(len, (size_t)OTA_PATCH_BUFFER_SIZE), _diffLen);
+            if (esp_partition_read(_oldPartition, _oldPos, _oldBuffer, copy) != ESP_OK)
+            {
+                _fail("Reading the running firmware failed");
+                break;
+            }
+            for (size_t i = 0; i < copy; i++)
+            {
+                _oldBuffer[i] += data[i];
+            }
+            _flash(_oldBuffer, copy);
+
+            _oldPos += copy;
+            _newPos += copy;
+            _diffLen -= copy;
+            data += copy;
+            len -= copy;
+            if (_diffLen == 0)
+            {
+                _nextSegment();
+            }
+            break;
+        }
+
+        case PATCH_EXTRA:
+        {
+            size_t copy = min((int64_t)len, _extraLen);
+            _flash(data, copy);
+
+            _newPos += copy;
+            _extraLen -= copy;
+            data += copy;
+            len -= copy;
+            if (_extraLen == 0)
+            {
+                _nextSegment();
+            }
+            break;
+        }
+
+        case PATCH_DONE:
+            // nothing may follow the last segment
+            _fail("Delta patch is corrupt");
+            break;
+        }
+    }
+}
+
+void FirmwareWriter::_writerTask(void *writer)
+{
+    FirmwareWriter *self = (FirmwareWriter *)writer;
+    Chunk chunk;
+
+    while (xQueueReceive(self->_full, &chunk, portMAX_DELAY) == pdTRUE && chunk.len > 0)
+    {
+        // after an error or an abort the buffers are only handed back
+        if (!self->_failed && !self->_aborting)
+        {
+            if (self->isCompressed())
+                self->_inflate(chunk.data, chunk.len);
+            else
+                self->_flash(chunk.data, chunk.len);
+        }
+        self->_consumed += chunk.len;
+
+        xQueueSend(self->_free, &chunk.data, portMAX_DELAY);
+    }
+
+    // OTA_WRITER_STACK_SIZE has to hold inflate, patch and Update.write() on top of each other
+    ESP_LOGD(SVK_TAG, "Firmware writer stack headroom: %u bytes", (unsigned)uxTaskGetStackHighWaterMark(NULL));
+
+    xSemaphoreGive(self->_done);
+    vTaskDelete(NULL);
+}
@@ -0,0 +1,233 @@
+#ifndef FirmwareWriter_h
+#define FirmwareWriter_h
+
+/**
+ *   ESP32 SvelteKit
+ *
+ *   A simple, secure and extensible framework for IoT projects for ESP32 platforms
+ *   with responsive Sveltekit front-end built with TailwindCSS and DaisyUI.
+ *   https://github.com/theelims/ESP32-sveltekit
+ *
+ *   Copyright (C) 2018 - 2023 rjwats
+ *   Copyright (C) 2023 - 2025 theelims
+ *
+ *   All Rights Reserved. This software may be modified and distributed under
+ *   the terms of the LGPL v3 license. See the LICENSE file for details.
+ **/
+
+#include <Arduino.h>
+#include <Update.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <rom/miniz.h>
+#include <esp_partition.h>
+
+#ifndef OTA_WRITER_BUFFER_SIZE
+#define OTA_WRITER_BUFFER_SIZE 8192
+#endif
+
+// the headroom left is logged at debug level when the writer task ends
+#ifndef OTA_WRITER_STACK_SIZE
+#define OTA_WRITER_STACK_SIZE 4096
+#endif
+
+#ifndef OTA_WRITER_PRIORITY
+#define OTA_WRITER_PRIORITY (tskIDLE_PRIORITY + 5)
+#endif
+
+#ifndef OTA_PATCH_BUFFER_SIZE
+#define OTA_PATCH_BUFFER_SIZE 1024
+#endif
+
+enum FirmwareFormat
+{
+    FIRMWARE_RAW,  // plain .bin image
+    FIRMWARE_GZIP, // gzip compressed .bin.gz image
+    FIRMWARE_DELTA // gzip compressed bsdiff patch against the running firmware
+};
+
+constexpr uint8_t ESP_MAGIC_BYTE = 0xE9;       // ESP binary magic byte
+
+// ESP32 chip type identifiers (byte offset 12 in firmware)
+#if CONFIG_IDF_TARGET_ESP32
+    constexpr uint8_t ESP_CHIP_ID = 0;
+#elif CONFIG_IDF_TARGET_ESP32S2
+    constexpr uint8_t ESP_CHIP_ID = 2;
+#elif CONFIG_IDF_TARGET_ESP32C3
+    constexpr uint8_t ESP_CHIP_ID = 5;
+#elif CONFIG_IDF_TARGET_ESP32S3
+    constexpr uint8_t ESP_CHIP_ID = 9;
+#else
+    #error "Unsupported ESP32 target"
+#endif
+
+/**
+ * @brief Double buffered pipeline in front of Update.write()
+ *
+ * The caller fills one buffer while a writer task flushes the other one to the
+ * OTA partition. When both buffers are in flight write() blocks until the flash
+ * catches up, so the network is throttled to the flash speed and never the
+ * other way round. Update.begin() and Update.end() stay with the caller.
+ * The magic byte and chip type of firmware images are checked before the first
+ * byte is flashed.
+ *
+ * Gzip compressed images (.bin.gz) are inflated by the writer task with the
+ * inflater in ROM and a 32 kB window. The gzip CRC32 and size are verified on
+ * the inflated stream, the MD5 set with Update.setMD5() covers the inflated
+ * image as well.
+ *
+ * Delta updates are gzip compressed bsdiff patches in the ENDSLEY/BSDIFF43
+ * format as created by scripts/delta_patch.py. The patch is applied on the fly
+ * against the running partition, which is read back in small blocks.
+ */
+class FirmwareWriter
+{
+public:
+    FirmwareWriter();
+    ~FirmwareWriter();
+
+    /**
+     * @brief Allocate the buffers and start the writer task
+     * @param format what the data is, see FirmwareFormat
+     * @param command U_FLASH for firmware or U_SPIFFS for a filesystem image, as given to Update.begin()
+     * @return false if memory or the task could not be allocated
+     */
+    bool begin(FirmwareFormat format = FIRMWARE_RAW, int command = U_FLASH);
+
+    /**
+     * @brief Queue data for writing, copies it into the current buffer
+     * @return false once a flash write failed
+     */
+    bool write(const uint8_t *data, size_t len);
+
+    /**
+     * @brief Flush the last buffer and wait until everything is in flash
+     * @return true if all data was written
+     */
+    bool end();
+
+    /**
+     * @brief Drop whatever is queued and stop the writer task
+     */
+    void abort();
+
+    bool isRunning() { return _task != NULL; }
+    bool hasFailed() { return _failed; }
+    bool isCompressed() { return _format != FIRMWARE_RAW; }
+
+    /**
+     * @brief Bytes of input data accepted by write() so far, where an interrupted download resumes
+     */
+    size_t received() { return _received; }
+
+    /**
+     * @brief Bytes of input data the writer task has handled so far
+     */
+    size_t consumed() { return _consumed; }
+
+    /**
+     * @brief Why the last write failed
+     */
+    const char *errorString() { return _error; }
+
+    /**
+     * @brief Check magic byte and chip type of a firmware image
+     * @param data Start of the image
+     * @param len Length of data
+     * @return true if the image is made for this chip
+     */
+    static bool validImage(const uint8_t *data, size_t len);
+
+    /**
+     * @brief Throughput of the two pipeline stages in bytes per second
+     */
+    uint32_t networkRate();
+    uint32_t flashRate();
+
+private:
+    struct Chunk
+    {
+        uint8_t *data;
+        size_t len;
+    };
+
+    uint8_t *_buffers[2];
+    QueueHandle_t _free;
+    QueueHandle_t _full;
+    SemaphoreHandle_t _done;
+    TaskHandle_t _task;
+
+    uint8_t *_current;
+    size_t _fill;
+    volatile bool _failed;
+    volatile bool _aborting;
+    const char *_error;
+
+    // gzip state, only allocated for compressed images
+    enum GzipState
+    {
+        GZIP_HEADER,
+        GZIP_DATA,
+        GZIP_TRAILER,
+        GZIP_DONE
+    };
+
+    FirmwareFormat _format;
+    int _command;
+    GzipState _gzipState;
+    tinfl_decompressor *_inflator;
+    uint8_t *_window;
+    size_t _windowPos;
+    uint8_t _trailer[8];
+    size_t _trailerLen;
+    uint32_t _crc;
+    size_t _inflated;
+    uint8_t _header[16];
+    size_t _headerLen;
+
+    // bsdiff state, only allocated for delta updates
+    enum PatchState
+    {
+        PATCH_HEADER,
+        PATCH_CONTROL,
+        PATCH_DIFF,
+        PATCH_EXTRA,
+        PATCH_DONE
+    };
+
+    PatchState _patchState;
+    const esp_partition_t *_oldPartition;
+    uint8_t *_oldBuffer;
+    uint8_t _control[24];
+    size_t _controlLen;
+    int64_t _diffLen;
+    int64_t _extraLen;
+    int64_t _seek;
+    int64_t _oldPos;
+    int64_t _newPos;
+    int64_t _newSize;
+
+    // statistics, network time is everything except waiting for the flash
+    uint32_t _started;
+    uint32_t _waited;
+    size_t _received;
+    volatile uint32_t _flashTime;
+    volatile size_t _written;
+    volatile size_t _consumed;
+
+    bool _queue(uint8_t *data, size_t len);
+    void _fail(const char *error);
+    void _flash(const uint8_t *data, size_t len);
+    void _inflate(const uint8_t *data, size_t len);
+    void _output(const uint8_t *data, size_t len);
+    void _patch(const uint8_t *data, size_t len);
+    void _nextSegment();
+    size_t _gzipHeader(const uint8_t *data, size_t len);
+    void _stop();
+    void _release();
+    static void _writerTask(void *writer);
+};
+
+#endif // end FirmwareWriter_h
@@ -0,0 +1,149 @@
+/**
+ *   ESP32 SvelteKit
+ *
+ *   A simple, secure and extensible framework for IoT projects for ESP32 platforms
+ *   with responsive Sveltekit front-end built with TailwindCSS and DaisyUI.
+ *   https://github.com/theelims/ESP32-sveltekit
+ *
+ *   Copyright (C) 2018 - 2023 rjwats
+ *   Copyright (C) 2023 - 2025 theelims
+ *
+ *   All Rights Reserved. This software may be modified and distributed under
+ *   the terms of the LGPL v3 license. See the LICENSE file for details.
+ **/
+
+#include <RateLimiter.h>
+#include <SecurityManager.h>
+#include <lwip/sockets.h>
+
+RateLimiter::RateLimiter(const char *name, uint16_t rate, uint16_t burst, bool addressKeys) : _name(name),
+                                                                                              _addressKeys(addressKeys),
+                                                                                              _rate(rate),
+                                                                                              _capacity((uint32_t)max(burst, (uint16_t)1) * 1000),
+                                                                                              _allowed(0),
+                                                                                              _limited(0)
+{
+    memset(_buckets, 0, sizeof(_buckets));
+    portMUX_INITIALIZE(&_lock);
+}
+
+bool RateLimiter::allow(uint32_t key)
+{
+    if (_rate == 0)
+    {
+        _allowed++;
+        return true;
+    }
+
+    uint32_t now = millis();
+    bool allowed = false;
+    bool started = false;
+
+    taskENTER_CRITICAL(&_lock);
+
+    // find the client or the slot that was idle the longest
+    Bucket *bucket = NULL;
+    Bucket *oldest = &_buckets[0];
+    for (Bucket &candidate : _buckets)
+    {
+        if (candidate.used && candidate.key == key)
+        {
+            bucket = &candidate;
+            break;
+        }
+        if (!candidate.used || (oldest->used && now - candidate.updated > now - oldest->updated))
+        {
+            oldest = &candidate;
+        }
+    }
+
+    if (bucket == NULL)
+    {
+        bucket = oldest;
+        bucket->key = key;
+        bucket->tokens = _capacity;
+        bucket->updated = now;
+        bucket->used = true;
+        bucket->limited = false;
+    }
+
+    // refill, _rate thousandths of a token per millisecond
+    uint32_t elapsed = now - bucket->updated;
+    bucket->updated = now;
+    if (elapsed >= _capacity / _rate)
+    {
+        bucket->tokens = _capacity;
+    }
+    else
+    {
+        bucket->tokens = min(bucket->tokens + elapsed * _rate, _capacity);
+    }
+
+    if (bucket->tokens >= 1000)
+    {
+        bucket->tokens -= 1000;
+        bucket->limited = false;
+        allowed = true;
+        _allowed++;
+    }
+    else
+    {
+        started = !bucket->limited;
+        bucket->limited = true;
+        _limited++;
+    }
+
+    taskEXIT_CRITICAL(&_lock);
+
+    // only log when a client starts flooding, not for every request dropped
+    if (started)
+    {
+        if (_addressKeys)
+        {
+            ESP_LOGW(SVK_TAG, "Rate limit for %s exceeded by %s", _name, IPAddress(key).toString().c_str());
+        }
+        else
+        {
+            ESP_LOGW(SVK_TAG, "Rate limit for %s exceeded by socket %u", _name, key);
+        }
+    }
+
+    return allowed;
+}
+
+uint32_t RateLimiter::peerKey(int socket)
+{
+    // the address straight from the socket, without going through a string like PsychicClient::remoteIP()
+    struct sockaddr_in6 address;
+    socklen_t size = sizeof(address);
+    if (getpeername(socket, (struct sockaddr *)&address, &size) != 0)
+    {
+        return (uint32_t)socket;
+    }
+    if (address.sin6_family == AF_INET6)
+    {
+        return address.sin6_addr.un.u32_addr[3];
+    }
+    return ((struct sockaddr_in *)&address)->sin_addr.s_addr;
+}
+
+void RateLimiter::remove(uint32_t key)
+{
+    taskENTER_CRITICAL(&_lock);
+    for (Bucket &bucket : _buckets)
+    {
+        if (bucket.used && bucket.key == key)
+        {
+            bucket.used = false;
+        }
+    }
+    taskEXIT_CRITICAL(&_lock);
+}
+
+void RateLimiter::read(JsonObject &root)
+{
+    root["rate"] = _rate;
+    root["burst"] = _capacity / 1000;
+    root["allowed"] = _allowed;
+    root["limited"] = _limited;
+}
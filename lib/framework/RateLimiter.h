@@ -0,0 +1,94 @@
+#ifndef RateLimiter_h
+#define RateLimiter_h
+
+/**
+ *   ESP32 SvelteKit
+ *
+ *   A simple, secure and extensible framework for IoT projects for ESP32 platforms
+ *   with responsive Sveltekit front-end built with TailwindCSS and DaisyUI.
+ *   https://github.com/theelims/ESP32-sveltekit
+ *
+ *   Copyright (C) 2018 - 2023 rjwats
+ *   Copyright (C) 2023 - 2025 theelims
+ *
+ *   All Rights Reserved. This software may be modified and distributed under
+ *   the terms of the LGPL v3 license. See the LICENSE file for details.
+ **/
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+
+// number of clients tracked per route class, the least recently seen one is replaced
+#ifndef RATE_LIMIT_CLIENTS
+#define RATE_LIMIT_CLIENTS 8
+#endif
+
+/**
+ * @brief Token bucket per client
+ *
+ * Every client starts with a full bucket of burst tokens, each request takes one
+ * and rate tokens per second flow back in. An empty bucket means the request is
+ * refused. Clients are identified by a 32 bit key, the IPv4 address for HTTP
+ * requests or the socket for websocket frames. A rate of 0 disables the limit.
+ */
+class RateLimiter
+{
+public:
+    /**
+     * @param name Route class, used in the log
+     * @param rate Tokens per second, 0 disables the limit
+     * @param burst Size of the bucket
+     * @param addressKeys true if keys are IPv4 addresses, false for sockets
+     */
+    RateLimiter(const char *name, uint16_t rate, uint16_t burst, bool addressKeys = true);
+
+    /**
+     * @brief Take a token from the bucket of the client
+     * @return false if the client exceeded its rate
+     */
+    bool allow(uint32_t key);
+
+    /**
+     * @brief The key of the client on a socket, its IPv4 address
+     *
+     * IPv4 peers come as ::ffff:a.b.c.d when lwIP has IPv6 enabled and as plain
+     * IPv4 addresses otherwise. The socket itself is the key if the peer is unknown.
+     */
+    static uint32_t peerKey(int socket);
+
+    /**
+     * @brief Forget a client, e.g. when its socket is closed
+     */
+    void remove(uint32_t key);
+
+    uint32_t allowed() { return _allowed; }
+    uint32_t limited() { return _limited; }
+
+    /**
+     * @brief Write settings and counters to a JSON object
+     */
+    void read(JsonObject &root);
+
+private:
+    struct Bucket
+    {
+        uint32_t key;
+        uint32_t tokens; // in thousandths of a token
+        uint32_t updated;
+        bool used;
+        bool limited;
+    };
+
+    const char *_name;
+    bool _addressKeys;
+    uint32_t _rate;
+    uint32_t _capacity;
+    Bucket _buckets[RATE_LIMIT_CLIENTS];
+    portMUX_TYPE _lock;
+
+    uint32_t _allowed;
+    uint32_t _limited;
+};
+
+#endif // end RateLimiter_h
@@ -20,6 +20,7 @@
 #include <ESPmDNS.h>
 #include <PsychicHttp.h>
 #include <SecurityManager.h>
+#include <FSPersistence.h>
 
 #define RESTART_SERVICE_PATH "/rest/restart"
 
@@ -32,6 +33,8 @@ public:
 
     static void restartNow()
     {
+        // write pending settings before they are lost
+        FSPersistenceBase::shutdown();
         delay(250);
         MDNS.end();
         delay(100);
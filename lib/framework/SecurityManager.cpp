@@ -0,0 +1,51 @@
+/**
+ *   ESP32 SvelteKit
+ *
+ *   A simple, secure and extensible framework for IoT projects for ESP32 platforms
+ *   with responsive Sveltekit front-end built with TailwindCSS and DaisyUI.
+ *   https://github.com/theelims/ESP32-sveltekit
+ *
+ *   Copyright (C) 2018 - 2023 rjwats
+ *   Copyright (C) 2023 - 2025 theelims
+ *
+ *   All Rights Reserved. This software may be modified and distributed under
+ *   the terms of the LGPL v3 license. See the LICENSE file for details.
+ **/
+
+#include <SecurityManager.h>
+
+SecurityManager::SecurityManager() : _rateLimiters{{"api", RATE_LIMIT_API_RATE, RATE_LIMIT_API_BURST},
+                                                   {"sign in", RATE_LIMIT_SIGN_IN_RATE, RATE_LIMIT_SIGN_IN_BURST},
+                                                   {"events", RATE_LIMIT_EVENTS_RATE, RATE_LIMIT_EVENTS_BURST, false}}
+{
+}
+
+bool SecurityManager::allowRequest(PsychicRequest *request, RateLimitClass rateLimit)
+{
+    if (rateLimit == RATE_LIMIT_NONE)
+    {
+        return true;
+    }
+
+    return _rateLimiters[rateLimit].allow(RateLimiter::peerKey(httpd_req_to_sockfd(request->request())));
+}
+
+bool SecurityManager::allowFrame(int socket)
+{
+    return _rateLimiters[RATE_LIMIT_EVENTS].allow((uint32_t)socket);
+}
+
+void SecurityManager::releaseSocket(int socket)
+{
+    _rateLimiters[RATE_LIMIT_EVENTS].remove((uint32_t)socket);
+}
+
+void SecurityManager::readRateLimits(JsonObject &root)
+{
+    JsonObject api = root["api"].to<JsonObject>();
+    _rateLimiters[RATE_LIMIT_API].read(api);
+    JsonObject signIn = root["sign_in"].to<JsonObject>();
+    _rateLimiters[RATE_LIMIT_SIGN_IN].read(signIn);
+    JsonObject events = root["events"].to<JsonObject>();
+    _rateLimiters[RATE_LIMIT_EVENTS].read(events);
+}
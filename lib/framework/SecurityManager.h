@@ -18,7 +18,9 @@
 #include <Features.h>
 #include <ArduinoJsonJWT.h>
 #include <PsychicHttp.h>
+#include <RateLimiter.h>
 #include <list>
+#include <memory>
 
 #define SVK_TAG "🐼"
 
@@ -28,6 +30,39 @@
 #define AUTHORIZATION_HEADER_PREFIX "Bearer "
 #define AUTHORIZATION_HEADER_PREFIX_LEN 7
 
+// requests per second and burst size per client for each route class, a rate of 0 disables the limit
+#ifndef RATE_LIMIT_API_RATE
+#define RATE_LIMIT_API_RATE 20
+#endif
+
+#ifndef RATE_LIMIT_API_BURST
+#define RATE_LIMIT_API_BURST 40
+#endif
+
+#ifndef RATE_LIMIT_SIGN_IN_RATE
+#define RATE_LIMIT_SIGN_IN_RATE 1
+#endif
+
+#ifndef RATE_LIMIT_SIGN_IN_BURST
+#define RATE_LIMIT_SIGN_IN_BURST 5
+#endif
+
+#ifndef RATE_LIMIT_EVENTS_RATE
+#define RATE_LIMIT_EVENTS_RATE 50
+#endif
+
+#ifndef RATE_LIMIT_EVENTS_BURST
+#define RATE_LIMIT_EVENTS_BURST 100
+#endif
+
+enum RateLimitClass
+{
+    RATE_LIMIT_API,     // REST endpoints and websocket handshakes, per IP address
+    RATE_LIMIT_SIGN_IN, // password checks, per IP address
+    RATE_LIMIT_EVENTS,  // websocket frames, per socket
+    RATE_LIMIT_NONE
+};
+
 class User
 {
 public:
@@ -41,22 +76,28 @@ public:
     }
 };
 
+/*
+ * Users are stored once and never modified, a change of the security settings replaces them.
+ * Everyone else only holds a reference counted handle, copying it doesn't allocate.
+ */
+typedef std::shared_ptr<const User> SharedUser;
+
 class Authentication
 {
 public:
-    User *user;
+    SharedUser user;
     boolean authenticated;
 
 public:
-    Authentication(User &user) : user(new User(user)), authenticated(true)
+    Authentication(const SharedUser &user) : user(user), authenticated(user != nullptr)
     {
     }
-    Authentication() : user(nullptr), authenticated(false)
+    // copies the user, prefer the shared handle
+    Authentication(const User &user) : user(std::make_shared<const User>(user)), authenticated(true)
     {
     }
-    ~Authentication()
+    Authentication() : user(nullptr), authenticated(false)
     {
-        delete (user);
     }
 };
 
@@ -82,6 +123,28 @@ public:
 class SecurityManager
 {
 public:
+    SecurityManager();
+
+    /*
+     * Take a token for the client of the request, false if it exceeded the rate of the route class
+     */
+    bool allowRequest(PsychicRequest *request, RateLimitClass rateLimit = RATE_LIMIT_API);
+
+    /*
+     * Take a token for a websocket frame, false if the socket exceeded its rate
+     */
+    bool allowFrame(int socket);
+
+    /*
+     * Forget the bucket of a closed socket, the number is reused for the next connection
+     */
+    void releaseSocket(int socket);
+
+    /*
+     * Write the rate limit settings and counters of all route classes
+     */
+    void readRateLimits(JsonObject &root);
+
 #if FT_ENABLED(FT_SECURITY)
     /*
      * Authenticate, returning the user if found
@@ -91,7 +154,7 @@ public:
     /*
      * Generate a JWT for the user provided
      */
-    virtual String generateJWT(User *user) = 0;
+    virtual String generateJWT(const User *user) = 0;
 
 #endif
 
@@ -103,17 +166,21 @@ public:
     /**
      * Filter a request with the provided predicate, only returning true if the predicate matches.
      */
-    virtual PsychicRequestFilterFunction filterRequest(AuthenticationPredicate predicate) = 0;
+    virtual PsychicRequestFilterFunction filterRequest(AuthenticationPredicate predicate, RateLimitClass rateLimit = RATE_LIMIT_API) = 0;
 
     /**
      * Wrap the provided request to provide validation against an AuthenticationPredicate.
+     * Clients exceeding the rate of the route class are answered with 429 before the token is checked.
      */
-    virtual PsychicHttpRequestCallback wrapRequest(PsychicHttpRequestCallback onRequest, AuthenticationPredicate predicate) = 0;
+    virtual PsychicHttpRequestCallback wrapRequest(PsychicHttpRequestCallback onRequest, AuthenticationPredicate predicate, RateLimitClass rateLimit = RATE_LIMIT_API) = 0;
 
     /**
      * Wrap the provided json request callback to provide validation against an AuthenticationPredicate.
      */
-    virtual PsychicJsonRequestCallback wrapCallback(PsychicJsonRequestCallback onRequest, AuthenticationPredicate predicate) = 0;
+    virtual PsychicJsonRequestCallback wrapCallback(PsychicJsonRequestCallback onRequest, AuthenticationPredicate predicate, RateLimitClass rateLimit = RATE_LIMIT_API) = 0;
+
+protected:
+    RateLimiter _rateLimiters[RATE_LIMIT_NONE];
 };
 
 #endif // end SecurityManager_h
@@ -16,11 +16,17 @@
 
 #if FT_ENABLED(FT_SECURITY)
 
+// Authorization headers up to this length are read without a heap allocation
+#define AUTHORIZATION_BUFFER_SIZE 256
+
 SecuritySettingsService::SecuritySettingsService(PsychicHttpServer *server, FS *fs) : _server(server),
                                                                                       _httpEndpoint(SecuritySettings::read, SecuritySettings::update, this, server, SECURITY_SETTINGS_PATH, this),
                                                                                       _fsPersistence(SecuritySettings::read, SecuritySettings::update, this, fs, SECURITY_SETTINGS_FILE),
-                                                                                      _jwtHandler(FACTORY_JWT_SECRET)
+                                                                                      _jwtHandler(FACTORY_JWT_SECRET),
+                                                                                      _tokenCacheClock(0),
+                                                                                      _tokenCacheGeneration(0)
 {
+    _tokenCache.reserve(JWT_CACHE_SIZE);
     addUpdateHandler([&](const String &originId)
                      { configureJWTHandler(); },
                      false);
@@ -43,76 +49,166 @@ void SecuritySettingsService::begin()
 Authentication SecuritySettingsService::authenticateRequest(PsychicRequest *request)
 {
     // Load the parameters from the request, as they are only loaded later with the regular handler
-    if (request->hasHeader(AUTHORIZATION_HEADER))
+    size_t headerLength = httpd_req_get_hdr_value_len(request->request(), AUTHORIZATION_HEADER);
+    if (headerLength > 0)
     {
-        auto value = request->header(AUTHORIZATION_HEADER);
-        // ESP_LOGV(SVK_TAG, "Authorization header: %s", value.c_str());
-        if (value.startsWith(AUTHORIZATION_HEADER_PREFIX))
+        // tokens are short, read the header on the stack
+        if (headerLength < AUTHORIZATION_BUFFER_SIZE)
         {
-            value = value.substring(AUTHORIZATION_HEADER_PREFIX_LEN);
-            return authenticateJWT(value);
+            char value[AUTHORIZATION_BUFFER_SIZE];
+            httpd_req_get_hdr_value_str(request->request(), AUTHORIZATION_HEADER, value, sizeof(value));
+            // ESP_LOGV(SVK_TAG, "Authorization header: %s", value);
+            if (strncmp(value, AUTHORIZATION_HEADER_PREFIX, AUTHORIZATION_HEADER_PREFIX_LEN) == 0)
+            {
+                return authenticateJWT(value + AUTHORIZATION_HEADER_PREFIX_LEN, headerLength - AUTHORIZATION_HEADER_PREFIX_LEN);
+            }
+        }
+        else
+        {
+            String value = request->header(AUTHORIZATION_HEADER);
+            if (value.startsWith(AUTHORIZATION_HEADER_PREFIX))
+            {
+                return authenticateJWT(value.c_str() + AUTHORIZATION_HEADER_PREFIX_LEN, value.length() - AUTHORIZATION_HEADER_PREFIX_LEN);
+            }
         }
     }
     else if (request->hasParam(ACCESS_TOKEN_PARAMATER))
     {
-        String value = request->getParam(ACCESS_TOKEN_PARAMATER)->value();
-        // ESP_LOGV(SVK_TAG, "Access token parameter: %s", value.c_str());
-        return authenticateJWT(value);
+        const char *value = request->getParam(ACCESS_TOKEN_PARAMATER)->value();
+        // ESP_LOGV(SVK_TAG, "Access token parameter: %s", value);
+        return authenticateJWT(value, strlen(value));
     }
     return Authentication();
 }
 
 void SecuritySettingsService::configureJWTHandler()
 {
+    // the secret or the users changed, tokens have to be verified again
+    beginTransaction();
     _jwtHandler.setSecret(_state.jwtSecret);
+    _tokenCache.clear();
+    _tokenCacheGeneration++;
+    endTransaction();
 }
 
-Authentication SecuritySettingsService::authenticateJWT(String &jwt)
+// FNV-1a, only to skip most of the string compares in the cache
+static uint32_t hashToken(const char *jwt, size_t len)
 {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash = (hash ^ (uint8_t)jwt[i]) * 16777619u;
+    }
+    return hash;
+}
+
+Authentication SecuritySettingsService::authenticateJWT(const char *jwt, size_t len)
+{
+    uint32_t hash = hashToken(jwt, len);
+    SharedUser user;
+
+    beginTransaction();
+    for (CachedToken &cached : _tokenCache)
+    {
+        if (cached.hash == hash && cached.token.length() == len && memcmp(cached.token.c_str(), jwt, len) == 0)
+        {
+            cached.lastUsed = ++_tokenCacheClock;
+            user = cached.user;
+            break;
+        }
+    }
+    uint32_t generation = _tokenCacheGeneration;
+    endTransaction();
+
+    if (user)
+    {
+        return Authentication(user);
+    }
+
+    // verify the signature outside of the lock, it is the expensive part. The handler signs with a
+    // copy of the key states, a secret changed meanwhile only keeps the token out of the cache.
     JsonDocument payloadDocument;
-    _jwtHandler.parseJWT(jwt, payloadDocument);
+    _jwtHandler.parseJWT(jwt, len, payloadDocument);
     if (payloadDocument.is<JsonObject>())
     {
         JsonObject parsedPayload = payloadDocument.as<JsonObject>();
-        String username = parsedPayload["username"];
-        for (User _user : _state.users)
+        const char *username = parsedPayload["username"];
+
+        beginTransaction();
+        for (const SharedUser &_user : _state.users)
         {
-            if (_user.username == username && validatePayload(parsedPayload, &_user))
+            if (username && _user->username == username && validatePayload(parsedPayload, _user.get()))
             {
-                return Authentication(_user);
+                user = _user;
+                // don't cache a token that was verified against settings changed in the meantime
+                if (generation == _tokenCacheGeneration)
+                {
+                    cacheToken(hash, jwt, len, user);
+                }
+                break;
             }
         }
+        endTransaction();
     }
-    return Authentication();
+    return Authentication(user);
+}
+
+void SecuritySettingsService::cacheToken(uint32_t hash, const char *jwt, size_t len, const SharedUser &user)
+{
+    if (_tokenCache.size() < JWT_CACHE_SIZE)
+    {
+        _tokenCache.push_back({hash, ++_tokenCacheClock, String(), user});
+        _tokenCache.back().token.concat(jwt, len);
+        return;
+    }
+
+    CachedToken *oldest = &_tokenCache[0];
+    for (CachedToken &cached : _tokenCache)
+    {
+        if (cached.lastUsed < oldest->lastUsed)
+        {
+            oldest = &cached;
+        }
+    }
+    oldest->hash = hash;
+    oldest->lastUsed = ++_tokenCacheClock;
+    oldest->token = "";
+    oldest->token.concat(jwt, len);
+    oldest->user = user;
 }
 
 Authentication SecuritySettingsService::authenticate(const String &username, const String &password)
 {
-    for (User _user : _state.users)
+    SharedUser user;
+    beginTransaction();
+    for (const SharedUser &_user : _state.users)
     {
-        if (_user.username == username && _user.password == password)
+        if (_user->username == username && _user->password == password)
         {
-            return Authentication(_user);
+            user = _user;
+            break;
         }
     }
-    return Authentication();
+    endTransaction();
+    return Authentication(user);
 }
 
-inline void populateJWTPayload(JsonObject &payload, User *user)
+inline void populateJWTPayload(JsonObject &payload, const User *user)
 {
     payload["username"] = user->username;
     payload["admin"] = user->admin;
 }
 
-boolean SecuritySettingsService::validatePayload(JsonObject &parsedPayload, User *user)
+boolean SecuritySettingsService::validatePayload(JsonObject &parsedPayload, const User *user)
 {
-    JsonDocument jsonDocument;
-    JsonObject payload = jsonDocument.to<JsonObject>();
-    populateJWTPayload(payload, user);
-    return payload == parsedPayload;
+    // exactly what populateJWTPayload() puts in, without building a second document to compare
+    JsonVariant admin = parsedPayload["admin"];
+    return parsedPayload.size() == 2 &&
+           parsedPayload["username"] == user->username.c_str() &&
+           admin.is<bool>() && admin.as<bool>() == user->admin;
 }
 
-String SecuritySettingsService::generateJWT(User *user)
+String SecuritySettingsService::generateJWT(const User *user)
 {
     JsonDocument jsonDocument;
     JsonObject payload = jsonDocument.to<JsonObject>();
@@ -120,9 +216,9 @@ String SecuritySettingsService::generateJWT(User *user)
     return _jwtHandler.buildJWT(payload);
 }
 
-PsychicRequestFilterFunction SecuritySettingsService::filterRequest(AuthenticationPredicate predicate)
+PsychicRequestFilterFunction SecuritySettingsService::filterRequest(AuthenticationPredicate predicate, RateLimitClass rateLimit)
 {
-    return [this, predicate](PsychicRequest *request)
+    return [this, predicate, rateLimit](PsychicRequest *request)
     {
         // ESP_LOGV(SVK_TAG, "Authenticating filter request: %s", request->uri().c_str());
         // ESP_LOGV(SVK_TAG, "Request Method: %s", request->methodStr().c_str());
@@ -136,6 +232,10 @@ PsychicRequestFilterFunction SecuritySettingsService::filterRequest(Authenticati
             // ESP_LOGV(SVK_TAG, "Bogus filter request - allowing");
             return true;
         }
+        else if (!allowRequest(request, rateLimit))
+        {
+            return false;
+        }
         else
             request->loadParams();
 
@@ -146,10 +246,14 @@ PsychicRequestFilterFunction SecuritySettingsService::filterRequest(Authenticati
     };
 }
 
-PsychicHttpRequestCallback SecuritySettingsService::wrapRequest(PsychicHttpRequestCallback onRequest, AuthenticationPredicate predicate)
+PsychicHttpRequestCallback SecuritySettingsService::wrapRequest(PsychicHttpRequestCallback onRequest, AuthenticationPredicate predicate, RateLimitClass rateLimit)
 {
-    return [this, onRequest, predicate](PsychicRequest *request)
+    return [this, onRequest, predicate, rateLimit](PsychicRequest *request)
     {
+        if (!allowRequest(request, rateLimit))
+        {
+            return request->reply(429);
+        }
         Authentication authentication = authenticateRequest(request);
         if (!predicate(authentication))
         {
@@ -159,10 +263,14 @@ PsychicHttpRequestCallback SecuritySettingsService::wrapRequest(PsychicHttpReque
     };
 }
 
-PsychicJsonRequestCallback SecuritySettingsService::wrapCallback(PsychicJsonRequestCallback onRequest, AuthenticationPredicate predicate)
+PsychicJsonRequestCallback SecuritySettingsService::wrapCallback(PsychicJsonRequestCallback onRequest, AuthenticationPredicate predicate, RateLimitClass rateLimit)
 {
-    return [this, onRequest, predicate](PsychicRequest *request, JsonVariant &json)
+    return [this, onRequest, predicate, rateLimit](PsychicRequest *request, JsonVariant &json)
     {
+        if (!allowRequest(request, rateLimit))
+        {
+            return request->reply(429);
+        }
         Authentication authentication = authenticateRequest(request);
         if (!predicate(authentication))
         {
@@ -174,23 +282,32 @@ PsychicJsonRequestCallback SecuritySettingsService::wrapCallback(PsychicJsonRequ
 
 esp_err_t SecuritySettingsService::generateToken(PsychicRequest *request)
 {
-    String usernameParam = request->getParam("username")->value();
-    for (User _user : _state.users)
+    const char *usernameParam = request->getParam("username")->value();
+    SharedUser user;
+    beginTransaction();
+    for (const SharedUser &_user : _state.users)
     {
-        if (_user.username == usernameParam)
+        if (_user->username == usernameParam)
         {
-            PsychicJsonResponse response = PsychicJsonResponse(request, false);
-            JsonObject root = response.getRoot();
-            root["token"] = generateJWT(&_user);
-            return response.send();
+            user = _user;
+            break;
         }
     }
+    endTransaction();
+
+    if (user)
+    {
+        PsychicJsonResponse response = PsychicJsonResponse(request, false);
+        JsonObject root = response.getRoot();
+        root["token"] = generateJWT(user.get());
+        return response.send();
+    }
     return request->reply(401);
 }
 
 #else
 
-User ADMIN_USER = User(FACTORY_ADMIN_USERNAME, FACTORY_ADMIN_PASSWORD, true);
+SharedUser ADMIN_USER = std::make_shared<const User>(FACTORY_ADMIN_USERNAME, FACTORY_ADMIN_PASSWORD, true);
 
 SecuritySettingsService::SecuritySettingsService(PsychicHttpServer *server, FS *fs) : SecurityManager()
 {
@@ -199,12 +316,17 @@ SecuritySettingsService::~SecuritySettingsService()
 {
 }
 
-PsychicRequestFilterFunction SecuritySettingsService::filterRequest(AuthenticationPredicate predicate)
+PsychicRequestFilterFunction SecuritySettingsService::filterRequest(AuthenticationPredicate predicate, RateLimitClass rateLimit)
 {
-    return [this, predicate](PsychicRequest *request)
+    return [this, predicate, rateLimit](PsychicRequest *request)
     {
         // ESP_LOGV(SVK_TAG, "Security disabled - all requests are allowed");
-        return true;
+        // the bogus websocket filter request has no client to limit
+        if (request->uri().isEmpty() && request->method() == HTTP_DELETE)
+        {
+            return true;
+        }
+        return allowRequest(request, rateLimit);
     };
 }
 
@@ -214,17 +336,41 @@ Authentication SecuritySettingsService::authenticateRequest(PsychicRequest *requ
     return Authentication(ADMIN_USER);
 }
 
-// Return the function unwrapped
+// Return the function unwrapped unless it is rate limited
 PsychicHttpRequestCallback SecuritySettingsService::wrapRequest(PsychicHttpRequestCallback onRequest,
-                                                                AuthenticationPredicate predicate)
+                                                                AuthenticationPredicate predicate,
+                                                                RateLimitClass rateLimit)
 {
-    return onRequest;
+    if (rateLimit == RATE_LIMIT_NONE)
+    {
+        return onRequest;
+    }
+    return [this, onRequest, rateLimit](PsychicRequest *request)
+    {
+        if (!allowRequest(request, rateLimit))
+        {
+            return request->reply(429);
+        }
+        return onRequest(request);
+    };
 }
 
 PsychicJsonRequestCallback SecuritySettingsService::wrapCallback(PsychicJsonRequestCallback onRequest,
-                                                                 AuthenticationPredicate predicate)
+                                                                 AuthenticationPredicate predicate,
+                                                                 RateLimitClass rateLimit)
 {
-    return onRequest;
+    if (rateLimit == RATE_LIMIT_NONE)
+    {
+        return onRequest;
+    }
+    return [this, onRequest, rateLimit](PsychicRequest *request, JsonVariant &json)
+    {
+        if (!allowRequest(request, rateLimit))
+        {
+            return request->reply(429);
+        }
+        return onRequest(request, json);
+    };
 }
 
 #endif
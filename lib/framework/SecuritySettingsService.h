@@ -21,6 +21,8 @@
 #include <HttpEndpoint.h>
 #include <FSPersistence.h>
 
+#include <vector>
+
 #ifndef FACTORY_JWT_SECRET
 #define FACTORY_JWT_SECRET "#{random}-#{random}"
 #endif
@@ -46,13 +48,18 @@
 
 #define GENERATE_TOKEN_PATH "/rest/generateToken"
 
+// number of verified tokens remembered, saves the signature check on repeated requests
+#ifndef JWT_CACHE_SIZE
+#define JWT_CACHE_SIZE 8
+#endif
+
 #if FT_ENABLED(FT_SECURITY)
 
 class SecuritySettings
 {
 public:
     String jwtSecret;
-    std::list<User> users;
+    std::list<SharedUser> users;
 
     static void read(SecuritySettings &settings, JsonObject &root)
     {
@@ -61,12 +68,12 @@ public:
 
         // users
         JsonArray users = root["users"].to<JsonArray>();
-        for (User user : settings.users)
+        for (const SharedUser &user : settings.users)
         {
             JsonObject userRoot = users.add<JsonObject>();
-            userRoot["username"] = user.username;
-            userRoot["password"] = user.password;
-            userRoot["admin"] = user.admin;
+            userRoot["username"] = user->username;
+            userRoot["password"] = user->password;
+            userRoot["admin"] = user->admin;
         }
     }
 
@@ -81,13 +88,13 @@ public:
         {
             for (JsonVariant user : root["users"].as<JsonArray>())
             {
-                settings.users.push_back(User(user["username"], user["password"], user["admin"]));
+                settings.users.push_back(std::make_shared<const User>(user["username"], user["password"], user["admin"]));
             }
         }
         else
         {
-            settings.users.push_back(User(FACTORY_ADMIN_USERNAME, FACTORY_ADMIN_PASSWORD, true));
-            settings.users.push_back(User(FACTORY_GUEST_USERNAME, FACTORY_GUEST_PASSWORD, false));
+            settings.users.push_back(std::make_shared<const User>(FACTORY_ADMIN_USERNAME, FACTORY_ADMIN_PASSWORD, true));
+            settings.users.push_back(std::make_shared<const User>(FACTORY_GUEST_USERNAME, FACTORY_GUEST_PASSWORD, false));
         }
         return StateUpdateResult::CHANGED;
     }
@@ -103,11 +110,11 @@ public:
     // Functions to implement SecurityManager
     Authentication authenticate(const String &username, const String &password);
     Authentication authenticateRequest(PsychicRequest *request);
-    String generateJWT(User *user);
+    String generateJWT(const User *user);
 
-    PsychicRequestFilterFunction filterRequest(AuthenticationPredicate predicate);
-    PsychicHttpRequestCallback wrapRequest(PsychicHttpRequestCallback onRequest, AuthenticationPredicate predicate);
-    PsychicJsonRequestCallback wrapCallback(PsychicJsonRequestCallback onRequest, AuthenticationPredicate predicate);
+    PsychicRequestFilterFunction filterRequest(AuthenticationPredicate predicate, RateLimitClass rateLimit = RATE_LIMIT_API);
+    PsychicHttpRequestCallback wrapRequest(PsychicHttpRequestCallback onRequest, AuthenticationPredicate predicate, RateLimitClass rateLimit = RATE_LIMIT_API);
+    PsychicJsonRequestCallback wrapCallback(PsychicJsonRequestCallback onRequest, AuthenticationPredicate predicate, RateLimitClass rateLimit = RATE_LIMIT_API);
 
 private:
     PsychicHttpServer *_server;
@@ -116,6 +123,21 @@ private:
     FSPersistence<SecuritySettings> _fsPersistence;
     ArduinoJsonJWT _jwtHandler;
 
+    /*
+     * Recently verified tokens with the user they resolved to, the least recently used one is replaced
+     */
+    struct CachedToken
+    {
+        uint32_t hash;
+        uint32_t lastUsed;
+        String token;
+        SharedUser user;
+    };
+
+    std::vector<CachedToken> _tokenCache;
+    uint32_t _tokenCacheClock;
+    uint32_t _tokenCacheGeneration;
+
     esp_err_t generateToken(PsychicRequest *request);
 
     void configureJWTHandler();
@@ -123,12 +145,17 @@ private:
     /*
      * Lookup the user by JWT
      */
-    Authentication authenticateJWT(String &jwt);
+    Authentication authenticateJWT(const char *jwt, size_t len);
+
+    /*
+     * Remember a verified token, guarded by the state mutex
+     */
+    void cacheToken(uint32_t hash, const char *jwt, size_t len, const SharedUser &user);
 
     /*
      * Verify the payload is correct
      */
-    boolean validatePayload(JsonObject &parsedPayload, User *user);
+    boolean validatePayload(JsonObject &parsedPayload, const User *user);
 };
 
 #else
@@ -141,9 +168,9 @@ public:
 
     // minimal set of functions to support framework with security settings disabled
     Authentication authenticateRequest(PsychicRequest *request);
-    PsychicRequestFilterFunction filterRequest(AuthenticationPredicate predicate);
-    PsychicHttpRequestCallback wrapRequest(PsychicHttpRequestCallback onRequest, AuthenticationPredicate predicate);
-    PsychicJsonRequestCallback wrapCallback(PsychicJsonRequestCallback onRequest, AuthenticationPredicate predicate);
+    PsychicRequestFilterFunction filterRequest(AuthenticationPredicate predicate, RateLimitClass rateLimit = RATE_LIMIT_API);
+    PsychicHttpRequestCallback wrapRequest(PsychicHttpRequestCallback onRequest, AuthenticationPredicate predicate, RateLimitClass rateLimit = RATE_LIMIT_API);
+    PsychicJsonRequestCallback wrapCallback(PsychicJsonRequestCallback onRequest, AuthenticationPredicate predicate, RateLimitClass rateLimit = RATE_LIMIT_API);
 };
 
 #endif // end FT_ENABLED(FT_SECURITY)
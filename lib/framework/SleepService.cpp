@@ -68,6 +68,9 @@ void SleepService::sleepNow()
         callback();
     }
 
+    // write pending settings, including those changed by the callbacks
+    FSPersistenceBase::shutdown();
+
     MDNS.end();
     delay(100);
     WiFi.disconnect(true);
@@ -18,6 +18,7 @@
 
 #include <PsychicHttp.h>
 #include <SecurityManager.h>
+#include <FSPersistence.h>
 #include "driver/rtc_io.h"
 #include <vector>
 
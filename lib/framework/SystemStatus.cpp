@@ -162,5 +162,8 @@ esp_err_t SystemStatus::systemStatus(PsychicRequest *request)
     root["cpu_reset_reason"] = verbosePrintResetReason(esp_reset_reason());
     root["uptime"] = millis() / 1000;
 
+    JsonObject rateLimits = root["rate_limits"].to<JsonObject>();
+    _securityManager->readRateLimits(rateLimits);
+
     return response.send();
 }
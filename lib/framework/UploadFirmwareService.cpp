@@ -43,25 +43,11 @@ void UploadFirmwareService::begin()
     _server->maxUploadSize = SIZE_MAX;
     _maxFirmwareSize = getMaxFirmwareSize();
 
-    // Setup progress callback for Update library
+    // Update calls this from the firmware writer task, deep down in its call chain. The event is
+    // only built and sent by emitProgress() in the upload task, the writer's stack stays small.
     Update.onProgress([this](size_t progress, size_t total) {
-        if (_socket && total > 0) {
-            int percentComplete = (progress * 100) / total;
-            if (percentComplete > _previousProgress || progress == total) {
-                JsonDocument doc;
-                doc["status"] = "progress";
-                doc["progress"] = percentComplete;
-                doc["bytes_written"] = progress;
-                doc["total_bytes"] = total;
-                
-                JsonObject jsonObject = doc.as<JsonObject>();
-                _socket->emitEvent(EVENT_OTA_UPDATE, jsonObject);
-                
-                ESP_LOGV(SVK_TAG, "Firmware upload process at %d of %d bytes... (%d %%)", progress, total, percentComplete);
-                
-                _previousProgress = percentComplete;
-            }
-        }
+        _flashProgress = progress;
+        _flashTotal = total;
     });
 
     PsychicUploadHandler *uploadHandler = new PsychicUploadHandler();
@@ -89,24 +75,7 @@ size_t UploadFirmwareService::getMaxFirmwareSize()
 
 bool UploadFirmwareService::validateChipType(uint8_t *data, size_t len)
 {
-    if (len <= 12)
-    {
-        return false; // Not enough data to validate - firmware is invalid
-    }
-    
-    // Check magic byte at offset 0
-    if (data[0] != ESP_MAGIC_BYTE)
-    {
-        return false;
-    }
-    
-    // Check chip ID at offset 12
-    if (data[12] != ESP_CHIP_ID)
-    {
-        return false;
-    }
-    
-    return true;
+    return FirmwareWriter::validImage(data, len);
 }
 
 esp_err_t UploadFirmwareService::handleUpload(PsychicRequest *request,
@@ -138,6 +107,17 @@ esp_err_t UploadFirmwareService::handleUpload(PsychicRequest *request,
         std::string extension = fname.substr(position + 1);
         size_t fsize = request->contentLength();
 
+        // gzip compressed firmware binary (.bin.gz), inflated while writing
+        bool compressed = false;
+        if (strcasecmp(extension.c_str(), "gz") == 0 && position >= 4 && strncasecmp(fname.c_str() + position - 4, ".bin", 4) == 0)
+        {
+            compressed = true;
+            extension = "bin";
+        }
+
+        // filesystem image (littlefs.bin from "pio run -t buildfs"), replaces /www and keeps /config
+        bool filesystem = FilesystemUpdate::isImage(fname.c_str());
+
         _fileType = ft_none;
         if (strcasecmp(extension.c_str(), "md5") == 0)  // Are we processing an MD5 file?
         {
@@ -159,10 +139,11 @@ esp_err_t UploadFirmwareService::handleUpload(PsychicRequest *request,
         }
         else if (strcasecmp(extension.c_str(), "bin") == 0) // Are we processing a firmware binary?
         {
-            _fileType = ft_firmware;
+            _fileType = filesystem ? ft_filesystem : ft_firmware;
             
-            // Validate file size before processing
-            if (fsize > _maxFirmwareSize)
+            // Validate file size before processing. A filesystem image is as large as its partition,
+            // with the multipart overhead it always looks too large, Update.write() checks it instead.
+            if (!filesystem && fsize > _maxFirmwareSize)
             {
                 char errorMsg[64];
                 snprintf(errorMsg, sizeof(errorMsg), 
@@ -172,19 +153,36 @@ esp_err_t UploadFirmwareService::handleUpload(PsychicRequest *request,
                 return handleError(request, 413, errorMsg);
             }
             
-            ESP_LOGI(SVK_TAG, "Starting firmware upload: %s (%d bytes)", filename.c_str(), fsize);
+            ESP_LOGI(SVK_TAG, "Starting %s upload: %s (%d bytes)", filesystem ? "filesystem" : "firmware", filename.c_str(), fsize);
 #ifdef SERIAL_INFO
-            Serial.printf("Starting firmware upload: %s (%d bytes)\n", filename.c_str(), fsize);
+            Serial.printf("Starting %s upload: %s (%d bytes)\n", filesystem ? "filesystem" : "firmware", filename.c_str(), fsize);
 #endif
             
-            // Validate firmware header (magic byte and chip type)
-            if (!validateChipType(data, len))
+            // Validate firmware header (magic byte and chip type), the writer does it after inflating
+            if (!compressed && !filesystem && !validateChipType(data, len))
             {
                 return handleError(request, 503, "Wrong firmware for this device");
             }
+
+            // the filesystem is unmounted while its partition is overwritten
+            if (filesystem && !_filesystemUpdate.begin())
+            {
+                return handleError(request, 500, "Not enough memory to back up the settings");
+            }
             
-            if (Update.begin(fsize - sizeof(esp_image_header_t)))
+            // the inflated size is only known at the end
+            _uploadSize = fsize;
+            _flashProgress = 0;
+            _flashTotal = 0;
+            if (Update.begin(compressed || filesystem ? UPDATE_SIZE_UNKNOWN : fsize - sizeof(esp_image_header_t), filesystem ? U_SPIFFS : U_FLASH))
             {
+                if (!_writer.begin(compressed ? FIRMWARE_GZIP : FIRMWARE_RAW, filesystem ? U_SPIFFS : U_FLASH))
+                {
+                    Update.abort();
+                    _filesystemUpdate.end();
+                    return handleError(request, 500, "Not enough memory for the firmware upload");
+                }
+
                 // Emit preparing status after validation succeeds
                 if (_socket)
                 {
@@ -207,12 +205,13 @@ esp_err_t UploadFirmwareService::handleUpload(PsychicRequest *request,
             }
             else
             {
+                _filesystemUpdate.end();
                 return handleError(request, 507, "Insufficient storage space");
             }
         }
         else // Are we processing an unsupported file type?
         {
-            return handleError(request, 406, "File not a firmware binary or MD5 hash");
+            return handleError(request, 406, "File not a firmware binary, filesystem image or MD5 hash");
         }
     }
     else // we are continuing an existing upload
@@ -227,15 +226,26 @@ esp_err_t UploadFirmwareService::handleUpload(PsychicRequest *request,
     // if we haven't dealt with an error so far, continue with the firmware update
     if (!request->_tempObject)
     {
-        if (_fileType == ft_firmware)
+        if (_fileType == ft_firmware || _fileType == ft_filesystem)
         {
-            if (Update.write(data, len) != len)
+            if (!_writer.write(data, len))
             {
+                String errorMsg = _writer.errorString() ? _writer.errorString() : "Firmware write failed";
+                _writer.abort();
                 Update.abort();
-                return handleError(request, 500, "Firmware write failed");
+                return handleError(request, 500, errorMsg.c_str());
             }
+            emitProgress();
             if (final)
             {
+                // wait for the writer task to get the last buffers into flash
+                if (!_writer.end())
+                {
+                    String errorMsg = _writer.errorString() ? _writer.errorString() : "Firmware write failed";
+                    Update.abort();
+                    return handleError(request, 500, errorMsg.c_str());
+                }
+                emitProgress();
                 if (!Update.end(true))
                 {
                     // Get specific error message from Update library (includes MD5 mismatch)
@@ -247,6 +257,9 @@ esp_err_t UploadFirmwareService::handleUpload(PsychicRequest *request,
                     Update.abort();
                     return handleError(request, 500, errorMsg.c_str());
                 }
+
+                // mount the new filesystem and put the settings back
+                _filesystemUpdate.end();
             }
         }
     }
@@ -254,6 +267,43 @@ esp_err_t UploadFirmwareService::handleUpload(PsychicRequest *request,
     return ESP_OK;
 }
 
+void UploadFirmwareService::emitProgress()
+{
+    size_t progress = _flashProgress;
+    size_t total = _flashTotal;
+
+    // compressed uploads have no inflated size and filesystem images fill the whole
+    // partition, count the uploaded bytes instead
+    if ((_writer.isCompressed() || _fileType == ft_filesystem) && _uploadSize > 0)
+    {
+        total = _uploadSize;
+        progress = min(_writer.consumed(), total);
+    }
+    if (!_socket || total == 0)
+    {
+        return;
+    }
+
+    int percentComplete = (progress * 100) / total;
+    if (percentComplete > _previousProgress || progress == total)
+    {
+        JsonDocument doc;
+        doc["status"] = "progress";
+        doc["progress"] = percentComplete;
+        doc["bytes_written"] = progress;
+        doc["total_bytes"] = total;
+        doc["network_rate"] = _writer.networkRate();
+        doc["flash_rate"] = _writer.flashRate();
+
+        JsonObject jsonObject = doc.as<JsonObject>();
+        _socket->emitEvent(EVENT_OTA_UPDATE, jsonObject);
+
+        ESP_LOGV(SVK_TAG, "Firmware upload process at %d of %d bytes... (%d %%)", progress, total, percentComplete);
+
+        _previousProgress = percentComplete;
+    }
+}
+
 esp_err_t UploadFirmwareService::uploadComplete(PsychicRequest *request)
 {
     // if we already handled an error in handleUpload, do nothing
@@ -276,7 +326,7 @@ esp_err_t UploadFirmwareService::uploadComplete(PsychicRequest *request)
     }
 
     // if no error, send the success response
-    if (_fileType == ft_firmware)
+    if (_fileType == ft_firmware || _fileType == ft_filesystem)
     {
         // Emit finished event
         if (_socket)
@@ -289,9 +339,9 @@ esp_err_t UploadFirmwareService::uploadComplete(PsychicRequest *request)
             vTaskDelay(100 / portTICK_PERIOD_MS); // Give time for event to be sent
         }
         
-        ESP_LOGI(SVK_TAG, "Firmware upload successful - Restarting");
+        ESP_LOGI(SVK_TAG, "%s upload successful - Restarting", _fileType == ft_filesystem ? "Filesystem" : "Firmware");
 #ifdef SERIAL_INFO
-        Serial.println("Firmware upload successful - Restarting");
+        Serial.printf("%s upload successful - Restarting\n", _fileType == ft_filesystem ? "Filesystem" : "Firmware");
 #endif
         
         // Reset progress tracker for next upload
@@ -337,7 +387,7 @@ esp_err_t UploadFirmwareService::handleError(PsychicRequest *request, int code,
     }
 
     // Emit WebSocket error event for BIN files (skip for MD5 files)
-    if (_fileType == ft_firmware && _socket && message)
+    if ((_fileType == ft_firmware || _fileType == ft_filesystem) && _socket && message)
     {
         JsonDocument doc;
         doc["status"] = "error";
@@ -366,8 +416,11 @@ esp_err_t UploadFirmwareService::handleError(PsychicRequest *request, int code,
     _fileType = ft_none;
     _previousProgress = 0;
     
-    // Abort any ongoing Update to clear error state
+    // Abort any ongoing Update to clear error state, a partially written filesystem
+    // image leaves a formatted filesystem with the settings restored
+    _writer.abort();
     Update.abort();
+    _filesystemUpdate.end(false);
     
     // Mark this request as having encountered an error using _tempObject as a flag
     // (The pointer value itself is not used, only checked for NULL vs non-NULL)
@@ -378,6 +431,17 @@ esp_err_t UploadFirmwareService::handleError(PsychicRequest *request, int code,
 
 esp_err_t UploadFirmwareService::handleEarlyDisconnect()
 {
+    // drop whatever the writer task still has queued
+    _writer.abort();
+
+    // nothing would notice a partial filesystem image, unlike a firmware image
+    if (_filesystemUpdate.isRunning())
+    {
+        Update.abort();
+        _filesystemUpdate.end(false);
+        return ESP_OK;
+    }
+
     // if updated has not ended on connection close, abort it
     if (!Update.end(true))
     {
@@ -26,37 +26,28 @@
 #include <RestartService.h>
 #include <EventSocket.h>
 #include <FirmwareUpdateEvents.h>
+#include <FirmwareWriter.h>
+#include <FilesystemUpdate.h>
 
 #define UPLOAD_FIRMWARE_PATH "/rest/uploadFirmware"
 
 // Firmware upload constants
 constexpr size_t MD5_LENGTH = 32;              // MD5 hash length
-constexpr uint8_t ESP_MAGIC_BYTE = 0xE9;       // ESP binary magic byte
-
-// ESP32 chip type identifiers (byte offset 12 in firmware)
-#if CONFIG_IDF_TARGET_ESP32
-    constexpr uint8_t ESP_CHIP_ID = 0;
-#elif CONFIG_IDF_TARGET_ESP32S2
-    constexpr uint8_t ESP_CHIP_ID = 2;
-#elif CONFIG_IDF_TARGET_ESP32C3
-    constexpr uint8_t ESP_CHIP_ID = 5;
-#elif CONFIG_IDF_TARGET_ESP32S3
-    constexpr uint8_t ESP_CHIP_ID = 9;
-#else
-    #error "Unsupported ESP32 target"
-#endif
 
 enum FileType
 {
     ft_none = 0,
     ft_firmware = 1,
-    ft_md5 = 2
+    ft_md5 = 2,
+    ft_filesystem = 3
 };
 
 /**
  * @brief Service for handling firmware uploads over HTTP with OTA support
  * 
- * Supports chunked uploads of .bin firmware files and .md5 hash files for validation.
+ * Supports chunked uploads of .bin firmware files, gzip compressed .bin.gz files
+ * and .md5 hash files for validation. Filesystem images (littlefs.bin) are written
+ * to the filesystem partition, keeping the settings in /config.
  * Emits real-time progress updates via WebSocket and validates chip compatibility.
  */
 class UploadFirmwareService
@@ -86,6 +77,15 @@ private:
     FileType _fileType = ft_none;
     int _previousProgress = 0;
     size_t _maxFirmwareSize = 0;
+    size_t _uploadSize = 0;
+
+    // set by Update.onProgress() in the writer task, emitted from the upload task
+    volatile size_t _flashProgress = 0;
+    volatile size_t _flashTotal = 0;
+
+    // flash writes run in their own task while the next chunk is received
+    FirmwareWriter _writer;
+    FilesystemUpdate _filesystemUpdate;
 
     /**
      * @brief Get maximum firmware size from OTA partition
@@ -134,6 +134,11 @@ private:
      */
     esp_err_t handleError(PsychicRequest *request, int code, const char *message = nullptr);
     
+    /**
+     * @brief Emit a progress event if the percentage went up since the last one
+     */
+    void emitProgress();
+
     /**
      * @brief Handle client disconnection during upload
      * @return ESP_OK on successful cleanup
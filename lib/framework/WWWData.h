@@ -1,5 +1,14 @@
-#include <functional>
 #include <Arduino.h>
+
+struct WWWAsset {
+	const char *path;
+	const char *mime;
+	const char *encoding;
+	const char *etag;
+	const uint8_t *data;
+	size_t len;
+};
+
 // favicon.png
 const uint8_t ESP_SVELTEKIT_DATA_0[] = {
 	0x1F,0x8B,0x08,0x00,0xBD,0xA9,0x30,0x69,0x02,0xFF,0x01,0x23,0x06,0xDC,0xF9,0x89,
@@ -15023,21 +15032,46 @@ const uint8_t ESP_SVELTEKIT_DATA_9[] = {
 	0x6F,0xDF,0xA2,0x8A,0xD2,0x5D,0x02,0x00,0x00,
 };
 
-typedef std::function<void(const String& uri, const String& contentType, const uint8_t * content, size_t len)> RouteRegistrationHandler;
-
 class WWWData {
 	public:
-		static void registerRoutes(RouteRegistrationHandler handler) {
-			handler("/favicon.png", "image/png", ESP_SVELTEKIT_DATA_0, 1594);
-			handler("/index.html", "text/html", ESP_SVELTEKIT_DATA_1, 381);
-			handler("/manifest.json", "application/json", ESP_SVELTEKIT_DATA_2, 177);
-			handler("/_app/env.js", "application/javascript", ESP_SVELTEKIT_DATA_3, 39);
-			handler("/_app/version.json", "application/json", ESP_SVELTEKIT_DATA_4, 47);
-			handler("/_app/immutable/bundle.js", "application/javascript", ESP_SVELTEKIT_DATA_5, 188718);
-			handler("/_app/immutable/assets/bundle.css", "text/css", ESP_SVELTEKIT_DATA_6, 14698);
-			handler("/_app/immutable/assets/logo.png", "image/png", ESP_SVELTEKIT_DATA_7, 19156);
-			handler("/_app/immutable/assets/_layout.css", "text/css", ESP_SVELTEKIT_DATA_8, 14519);
-			handler("/_app/immutable/assets/_page.css", "text/css", ESP_SVELTEKIT_DATA_9, 329);
+		static constexpr size_t assetCount = 10;
+		static constexpr size_t tableSize = 16;
+		static constexpr uint32_t hashSeed = 0x00000054;
+
+		static constexpr WWWAsset assets[assetCount] = {
+			{"/favicon.png", "image/png", "gzip", "\"5146ed79b486cb9e\"", ESP_SVELTEKIT_DATA_0, 1594},
+			{"/index.html", "text/html", "gzip", "\"5e2b8c5892e88d3f\"", ESP_SVELTEKIT_DATA_1, 381},
+			{"/manifest.json", "application/json", "gzip", "\"fdb0d9f50a3f80d4\"", ESP_SVELTEKIT_DATA_2, 177},
+			{"/_app/env.js", "application/javascript", "gzip", "\"3c588b75cde52299\"", ESP_SVELTEKIT_DATA_3, 39},
+			{"/_app/version.json", "application/json", "gzip", "\"02c36ab88b3e93af\"", ESP_SVELTEKIT_DATA_4, 47},
+			{"/_app/immutable/bundle.js", "application/javascript", "gzip", "\"0d0090a373c7a943\"", ESP_SVELTEKIT_DATA_5, 188718},
+			{"/_app/immutable/assets/bundle.css", "text/css", "gzip", "\"038e7a56a7a7a3bd\"", ESP_SVELTEKIT_DATA_6, 14698},
+			{"/_app/immutable/assets/logo.png", "image/png", "gzip", "\"b54480533cdeee50\"", ESP_SVELTEKIT_DATA_7, 19156},
+			{"/_app/immutable/assets/_layout.css", "text/css", "gzip", "\"41f610c2d5a856c0\"", ESP_SVELTEKIT_DATA_8, 14519},
+			{"/_app/immutable/assets/_page.css", "text/css", "gzip", "\"e118a82c02ac5689\"", ESP_SVELTEKIT_DATA_9, 329},
+		};
+
+		// Perfect hash slot to index into assets, -1 marks an empty slot
+		static constexpr int16_t slots[tableSize] = {3, 1, -1, -1, 0, 8, 7, -1, 4, 6, 2, -1, 5, -1, 9, -1};
+
+		static constexpr uint32_t hash(const char *path, size_t len) {
+			uint32_t h = hashSeed;
+			for (size_t i = 0; i < len; i++) {
+				h = (h ^ (uint8_t)path[i]) * 16777619u;
+			}
+			return h ^ (h >> 16);
+		}
+
+		static const WWWAsset *find(const char *path, size_t len, bool brotli = false) {
+			int16_t slot = slots[hash(path, len) & (tableSize - 1)];
+			if (slot < 0 || strncmp(assets[slot].path, path, len) != 0 || assets[slot].path[len] != '\0') {
+				return nullptr;
+			}
+			// a brotli variant is always followed by its gzip fallback
+			if (!brotli && strcmp(assets[slot].encoding, "br") == 0) {
+				return &assets[slot + 1];
+			}
+			return &assets[slot];
 		}
 };
 
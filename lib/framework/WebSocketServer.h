@@ -75,11 +75,18 @@ public:
 
     void onWSClose(PsychicWebSocketClient *client)
     {
+        _securityManager->releaseSocket(client->socket());
         ESP_LOGI(SVK_TAG, "ws[%s][%u] disconnect", client->remoteIP().toString().c_str(), client->socket());
     }
 
     esp_err_t onWSFrame(PsychicWebSocketRequest *request, httpd_ws_frame *frame)
     {
+        // drop frames of a flooding client before anything is parsed
+        if (!_securityManager->allowFrame(request->client()->socket()))
+        {
+            return ESP_OK;
+        }
+
         ESP_LOGV(SVK_TAG, "ws[%s][%u] opcode[%d]", request->client()->remoteIP().toString().c_str(), request->client()->socket(), frame->type);
 
         if (frame->type == HTTPD_WS_TYPE_TEXT)
@@ -19,6 +19,7 @@ from os.path import exists, getmtime
 import os
 import sys
 import gzip
+import hashlib
 import mimetypes
 import glob
 from datetime import datetime
@@ -70,6 +71,21 @@ def gzip_file(file):
     os.remove(file)
 
 
+def brotli_file(file):
+    with open(file, 'rb') as f_in:
+        with open(file + '.br', 'wb') as f_out:
+            f_out.write(brotli_compress(f_in.read()))
+
+
+def brotli_compress(data):
+    try:
+        import brotli
+    except ImportError:
+        env.Execute("$PYTHONEXE -m pip install brotli")
+        import brotli
+    return brotli.compress(data, quality=11)
+
+
 def flag_exists(flag):
     for define in buildFlags.get("CPPDEFINES"):
         if (define == flag or (isinstance(define, list) and define[0] == flag)):
@@ -103,13 +119,101 @@ def embed_webapp():
     add_app_to_filesystem()
 
 
+FNV_PRIME = 16777619
+
+
+def fnv1a(data, seed):
+    h = seed
+    for byte in data:
+        h = ((h ^ byte) * FNV_PRIME) & 0xFFFFFFFF
+    # fold the high half in, the low bits of FNV-1a barely depend on the seed
+    return h ^ (h >> 16)
+
+
+def find_perfect_hash(paths):
+    # smallest power of two table with a seed that gives every path its own slot
+    size = 1
+    while size < len(paths):
+        size <<= 1
+    while True:
+        for seed in range(1, 1 << 16):
+            slots = {fnv1a(path.encode(), seed) & (size - 1) for path in paths}
+            if len(slots) == len(paths):
+                return seed, size
+        size <<= 1
+
+
+def write_asset_table(progmem, assets):
+    # variants of the same path are adjacent, the slot points at the first one
+    seed, size = find_perfect_hash(list(dict.fromkeys(asset["path"] for asset in assets)))
+    slots = [-1] * size
+    for idx, asset in enumerate(assets):
+        slot = fnv1a(asset["path"].encode(), seed) & (size - 1)
+        if slots[slot] < 0:
+            slots[slot] = idx
+
+    progmem.write("class WWWData {\n")
+    progmem.write("\tpublic:\n")
+    progmem.write(f"\t\tstatic constexpr size_t assetCount = {len(assets)};\n")
+    progmem.write(f"\t\tstatic constexpr size_t tableSize = {size};\n")
+    progmem.write(f"\t\tstatic constexpr uint32_t hashSeed = 0x{seed:08X};\n\n")
+
+    progmem.write("\t\tstatic constexpr WWWAsset assets[assetCount] = {\n")
+    for asset in assets:
+        progmem.write(
+            f'\t\t\t{{"{asset["path"]}", "{asset["mime"]}", "{asset["encoding"]}", "\\"{asset["etag"]}\\"", {asset["name"]}, {asset["size"]}}},\n'
+        )
+    progmem.write("\t\t};\n\n")
+
+    progmem.write("\t\t// Perfect hash slot to index into assets, -1 marks an empty slot\n")
+    progmem.write(f"\t\tstatic constexpr int16_t slots[tableSize] = {{{', '.join(str(slot) for slot in slots)}}};\n\n")
+
+    progmem.write("\t\tstatic constexpr uint32_t hash(const char *path, size_t len) {\n")
+    progmem.write("\t\t\tuint32_t h = hashSeed;\n")
+    progmem.write("\t\t\tfor (size_t i = 0; i < len; i++) {\n")
+    progmem.write(f"\t\t\t\th = (h ^ (uint8_t)path[i]) * {FNV_PRIME}u;\n")
+    progmem.write("\t\t\t}\n")
+    progmem.write("\t\t\treturn h ^ (h >> 16);\n")
+    progmem.write("\t\t}\n\n")
+
+    progmem.write("\t\tstatic const WWWAsset *find(const char *path, size_t len, bool brotli = false) {\n")
+    progmem.write("\t\t\tint16_t slot = slots[hash(path, len) & (tableSize - 1)];\n")
+    progmem.write("\t\t\tif (slot < 0 || strncmp(assets[slot].path, path, len) != 0 || assets[slot].path[len] != '\\0') {\n")
+    progmem.write("\t\t\t\treturn nullptr;\n")
+    progmem.write("\t\t\t}\n")
+    progmem.write("\t\t\t// a brotli variant is always followed by its gzip fallback\n")
+    progmem.write("\t\t\tif (!brotli && strcmp(assets[slot].encoding, \"br\") == 0) {\n")
+    progmem.write("\t\t\t\treturn &assets[slot + 1];\n")
+    progmem.write("\t\t\t}\n")
+    progmem.write("\t\t\treturn &assets[slot];\n")
+    progmem.write("\t\t}\n")
+    progmem.write("};\n\n")
+
+
+def write_data_array(progmem, name, data):
+    progmem.write(f"const uint8_t {name}[] = {{\n\t")
+    for i, byte in enumerate(data):
+        if i and not (i % 16):
+            progmem.write("\n\t")
+        progmem.write(f"0x{byte:02X},")
+    progmem.write("\n};\n\n")
+
+
 def build_progmem():
     mimetypes.init()
+    brotli = flag_exists("WWW_BROTLI")
     with open(output_file, "w") as progmem:
-        progmem.write("#include <functional>\n")
-        progmem.write("#include <Arduino.h>\n")
+        progmem.write("#include <Arduino.h>\n\n")
+        progmem.write("struct WWWAsset {\n")
+        progmem.write("\tconst char *path;\n")
+        progmem.write("\tconst char *mime;\n")
+        progmem.write("\tconst char *encoding;\n")
+        progmem.write("\tconst char *etag;\n")
+        progmem.write("\tconst uint8_t *data;\n")
+        progmem.write("\tsize_t len;\n")
+        progmem.write("};\n\n")
 
-        assetMap = {}
+        assets = []
 
         for idx, path in enumerate(Path(build_dir).rglob("*.*")):
             asset_path = path.relative_to(build_dir).as_posix()
@@ -119,38 +223,36 @@ def build_progmem():
             print(f"Converting {asset_path}")
 
             asset_var = f"ESP_SVELTEKIT_DATA_{idx}"
+            raw_data = path.read_bytes()
+            etag = hashlib.sha256(raw_data).hexdigest()[:16]
+
+            # Brotli first, gzip stays as the fallback for clients without br (plain HTTP)
+            if brotli:
+                br_data = brotli_compress(raw_data)
+                progmem.write(f"// {asset_path} (br)\n")
+                write_data_array(progmem, f"{asset_var}_BR", br_data)
+                assets.append({
+                    "path": f"/{asset_path}",
+                    "name": f"{asset_var}_BR",
+                    "mime": asset_mime,
+                    "encoding": "br",
+                    "etag": f"{etag}-br",
+                    "size": len(br_data),
+                })
+
+            file_data = gzip.compress(raw_data)
             progmem.write(f"// {asset_path}\n")
-            progmem.write(f"const uint8_t {asset_var}[] = {{\n\t")
-            file_data = gzip.compress(path.read_bytes())
-
-            for i, byte in enumerate(file_data):
-                if i and not (i % 16):
-                    progmem.write("\n\t")
-                progmem.write(f"0x{byte:02X},")
-
-            progmem.write("\n};\n\n")
-            assetMap[asset_path] = {
+            write_data_array(progmem, asset_var, file_data)
+            assets.append({
+                "path": f"/{asset_path}",
                 "name": asset_var,
                 "mime": asset_mime,
+                "encoding": "gzip",
+                "etag": etag,
                 "size": len(file_data),
-            }
-
-        progmem.write(
-            "typedef std::function<void(const String& uri, const String& contentType, const uint8_t * content, size_t len)> RouteRegistrationHandler;\n\n"
-        )
-        progmem.write("class WWWData {\n")
-        progmem.write("\tpublic:\n")
-        progmem.write(
-            "\t\tstatic void registerRoutes(RouteRegistrationHandler handler) {\n"
-        )
+            })
 
-        for asset_path, asset in assetMap.items():
-            progmem.write(
-                f'\t\t\thandler("/{asset_path}", "{asset["mime"]}", {asset["name"]}, {asset["size"]});\n'
-            )
-
-        progmem.write("\t\t}\n")
-        progmem.write("};\n\n")
+        write_asset_table(progmem, assets)
 
 
 def add_app_to_filesystem():
@@ -162,6 +264,8 @@ def add_app_to_filesystem():
     copytree(build_path, www_path)
     for current_path, _, files in os.walk(www_path):
         for file in files:
+            if flag_exists("WWW_BROTLI"):
+                brotli_file(os.path.join(current_path, file))
             gzip_file(os.path.join(current_path, file))
     if ("upload" in BUILD_TARGETS):
         print("Build LittleFS file system image and upload to ESP32")
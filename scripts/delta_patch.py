@@ -0,0 +1,247 @@
+#   ESP32 SvelteKit --
+#
+#   A simple, secure and extensible framework for IoT projects for ESP32 platforms
+#   with responsive Sveltekit front-end built with TailwindCSS and DaisyUI.
+#   https://github.com/theelims/ESP32-sveltekit
+#
+#   Copyright (C) 2023 - 2025 theelims
+#
+#   All Rights Reserved. This software may be modified and distributed under
+#   the terms of the LGPL v3 license. See the LICENSE file for details.
+#
+#   Creates a delta OTA patch from two firmware binaries:
+#
+#       python scripts/delta_patch.py <old firmware.bin> <new firmware.bin> <patch>
+#
+#   The patch is a gzip compressed bsdiff patch in the ENDSLEY/BSDIFF43 format.
+#   Control, diff and extra data are interleaved in a single stream, so the
+#   device applies it while downloading and reads the old firmware straight
+#   from the running partition. The patch is applied again after creation and
+#   compared byte for byte with the new firmware before it is written.
+
+import argparse
+import gzip
+import hashlib
+import os
+import sys
+
+MAGIC = b"ENDSLEY/BSDIFF43"
+
+
+def suffix_array(data):
+    # prefix doubling, slow but without dependencies
+    n = len(data)
+    rank = [b + 1 for b in data] + [0]
+    sa = sorted(range(n + 1), key=rank.__getitem__)
+    k = 1
+    m = max(n, 256) + 2
+    while True:
+        padded = rank + [0] * k
+        key = [rank[i] * m + padded[i + k] for i in range(n + 1)]
+        sa.sort(key=key.__getitem__)
+        new = [0] * (n + 1)
+        r = 0
+        prev = key[sa[0]]
+        for s in sa:
+            cur = key[s]
+            if cur != prev:
+                r += 1
+                prev = cur
+            new[s] = r
+        rank = new
+        if r == n:
+            return sa
+        k <<= 1
+
+
+def matchlen(old, o, new, n):
+    length = min(len(old) - o, len(new) - n)
+    i = 0
+    step = 32
+    while i < length:
+        m = min(step, length - i)
+        if old[o + i:o + i + m] != new[n + i:n + i + m]:
+            while old[o + i] == new[n + i]:
+                i += 1
+            return i
+        i += m
+        step *= 2
+    return length
+
+
+def less(old, o, new, n):
+    # memcmp(old + o, new + n, min(...)) < 0
+    length = min(len(old) - o, len(new) - n)
+    i = 0
+    step = 32
+    while i < length:
+        m = min(step, length - i)
+        a = old[o + i:o + i + m]
+        b = new[n + i:n + i + m]
+        if a != b:
+            return a < b
+        i += m
+        step *= 2
+    return False
+
+
+def search(sa, old, new, n):
+    st = 0
+    en = len(old)
+    while en - st >= 2:
+        x = st + (en - st) // 2
+        if less(old, sa[x], new, n):
+            st = x
+        else:
+            en = x
+    x = matchlen(old, sa[st], new, n)
+    y = matchlen(old, sa[en], new, n)
+    return (x, sa[st]) if x > y else (y, sa[en])
+
+
+def diff(old, new):
+    """ Port of bsdiff 4.3, returns a list of (diff, extra, seek) tuples """
+    sa = suffix_array(old)
+    oldsize = len(old)
+    newsize = len(new)
+    control = []
+
+    scan = length = pos = 0
+    lastscan = lastpos = lastoffset = 0
+
+    while scan < newsize:
+        oldscore = 0
+        scan += length
+        scsc = scan
+        while scan < newsize:
+            length, pos = search(sa, old, new, scan)
+            while scsc < scan + length:
+                if scsc + lastoffset < oldsize and old[scsc + lastoffset] == new[scsc]:
+                    oldscore += 1
+                scsc += 1
+            if (length == oldscore and length != 0) or length > oldscore + 8:
+                break
+            if scan + lastoffset < oldsize and old[scan + lastoffset] == new[scan]:
+                oldscore -= 1
+            scan += 1
+
+        if length != oldscore or scan == newsize:
+            s = sf = lenf = i = 0
+            while lastscan + i < scan and lastpos + i < oldsize:
+                if old[lastpos + i] == new[lastscan + i]:
+                    s += 1
+                i += 1
+                if s * 2 - i > sf * 2 - lenf:
+                    sf = s
+                    lenf = i
+
+            lenb = 0
+            if scan < newsize:
+                s = sb = 0
+                i = 1
+                while scan >= lastscan + i and pos >= i:
+                    if old[pos - i] == new[scan - i]:
+                        s += 1
+                    if s * 2 - i > sb * 2 - lenb:
+                        sb = s
+                        lenb = i
+                    i += 1
+
+            if lastscan + lenf > scan - lenb:
+                overlap = (lastscan + lenf) - (scan - lenb)
+                s = ss = lens = 0
+                for i in range(overlap):
+                    if new[lastscan + lenf - overlap + i] == old[lastpos + lenf - overlap + i]:
+                        s += 1
+                    if new[scan - lenb + i] == old[pos - lenb + i]:
+                        s -= 1
+                    if s > ss:
+                        ss = s
+                        lens = i + 1
+                lenf += lens - overlap
+                lenb -= lens
+
+            diff_bytes = bytes((new[lastscan + i] - old[lastpos + i]) & 0xFF for i in range(lenf))
+            extra_bytes = new[lastscan + lenf:scan - lenb]
+            control.append((diff_bytes, extra_bytes, (pos - lenb) - (lastpos + lenf)))
+
+            lastscan = scan - lenb
+            lastpos = pos - lenb
+            lastoffset = pos - scan
+
+    return control
+
+
+def offtout(x):
+    # sign and magnitude, little endian
+    value = abs(x).to_bytes(8, "little")
+    if x < 0:
+        value = value[:7] + bytes([value[7] | 0x80])
+    return value
+
+
+def offtin(buf):
+    value = int.from_bytes(buf[:7] + bytes([buf[7] & 0x7F]), "little")
+    return -value if buf[7] & 0x80 else value
+
+
+def create_patch(old, new):
+    out = bytearray(MAGIC)
+    out += offtout(len(new))
+    for diff_bytes, extra_bytes, seek in diff(old, new):
+        out += offtout(len(diff_bytes)) + offtout(len(extra_bytes)) + offtout(seek)
+        out += diff_bytes
+        out += extra_bytes
+    return gzip.compress(bytes(out), compresslevel=9, mtime=0)
+
+
+def apply_patch(old, patch):
+    stream = gzip.decompress(patch)
+    if stream[:16] != MAGIC:
+        raise ValueError("not a BSDIFF43 patch")
+    newsize = offtin(stream[16:24])
+    new = bytearray()
+    p = 24
+    oldpos = 0
+    while len(new) < newsize:
+        x = offtin(stream[p:p + 8])
+        y = offtin(stream[p + 8:p + 16])
+        z = offtin(stream[p + 16:p + 24])
+        p += 24
+        if x < 0 or y < 0 or oldpos < 0 or oldpos + x > len(old) or len(new) + x + y > newsize:
+            raise ValueError("corrupt patch")
+        new += bytes((stream[p + i] + old[oldpos + i]) & 0xFF for i in range(x))
+        p += x
+        new += stream[p:p + y]
+        p += y
+        oldpos += x + z
+    return bytes(new)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Create a delta OTA patch between two firmware binaries")
+    parser.add_argument("old", help="firmware binary currently running on the device")
+    parser.add_argument("new", help="new firmware binary")
+    parser.add_argument("patch", help="patch file to write")
+    args = parser.parse_args()
+
+    with open(args.old, "rb") as f:
+        old = f.read()
+    with open(args.new, "rb") as f:
+        new = f.read()
+
+    print("Creating delta patch, this may take a minute")
+    patch = create_patch(old, new)
+
+    if apply_patch(old, patch) != new:
+        sys.exit("Patch verification failed")
+
+    with open(args.patch, "wb") as f:
+        f.write(patch)
+
+    print("Patch {}: {} bytes ({:.1f}% of {}), new firmware MD5 {}".format(
+        args.patch, len(patch), 100.0 * len(patch) / len(new), os.path.basename(args.new), hashlib.md5(new).hexdigest()))
+
+
+if __name__ == "__main__":
+    main()
@@ -18,6 +18,7 @@
 import shutil
 import re
 import os
+import gzip
 Import("env")
 import hashlib
 
@@ -36,7 +37,7 @@ def readFlag(flag):
     return None
 
 
-def bin_copy(source, target, env):
+def variant_name():
 
     # get the build info
     app_version = readFlag("APP_VERSION")
@@ -49,7 +50,10 @@ def bin_copy(source, target, env):
     print("Build Target: " + build_target)
 
     # convert . to - so Windows doesn't complain
-    variant = app_name + "_" +  build_target + "_" + app_version.replace(".", "-")
+    return app_name + "_" +  build_target + "_" + app_version.replace(".", "-")
+
+
+def release_copy(source, variant):
 
     # check if output directories exist and create if necessary
     if not os.path.isdir(OUTPUT_DIR):
@@ -58,9 +62,10 @@ def bin_copy(source, target, env):
     # create string with location and file names based on variant
     bin_file = "{}{}.bin".format(OUTPUT_DIR, variant)
     md5_file = "{}{}.md5".format(OUTPUT_DIR, variant)
+    gz_file = "{}{}.bin.gz".format(OUTPUT_DIR, variant)
 
     # check if new target files exist and remove if necessary
-    for f in [bin_file]:
+    for f in [bin_file, gz_file]:
         if os.path.isfile(f):
             os.remove(f)
 
@@ -72,14 +77,30 @@ def bin_copy(source, target, env):
     print("Renaming file to "+bin_file)
 
     # copy firmware.bin to firmware/<variant>.bin
-    shutil.copy(str(target[0]), bin_file)
+    shutil.copy(source, bin_file)
 
     with open(bin_file,"rb") as f:
-        result = hashlib.md5(f.read())
+        firmware = f.read()
+        result = hashlib.md5(firmware)
         print("Calculating MD5: "+result.hexdigest())
         file1 = open(md5_file, 'w')
         file1.write(result.hexdigest())
         file1.close()
 
+    # gzip compressed copy for OTA, the MD5 stays the one of the uncompressed image
+    print("Compressing firmware to "+gz_file)
+    with open(gz_file, "wb") as f:
+        f.write(gzip.compress(firmware, compresslevel=9, mtime=0))
+
+
+def bin_copy(source, target, env):
+    release_copy(str(target[0]), variant_name())
+
+
+def fs_copy(source, target, env):
+    # "pio run -t buildfs", the image is recognized as filesystem by its name ending in littlefs.bin
+    release_copy(str(target[0]), variant_name() + ".littlefs")
+
 env.AddPostAction("$BUILD_DIR/${PROGNAME}.bin", [bin_copy])
 env.AddPostAction("$BUILD_DIR/${PROGNAME}.md5", [bin_copy])
+env.AddPostAction("$BUILD_DIR/${ESP32_FS_IMAGE_NAME}.bin", [fs_copy])
@@ -0,0 +1,23 @@
+// Minimal assertions for the host tests, a failed check is reported and fails the run
+#pragma once
+
+#include <cstdio>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                       \
+    do                                                                         \
+    {                                                                          \
+        if (!(condition))                                                      \
+        {                                                                      \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+static int finish()
+{
+    if (failures)
+        fprintf(stderr, "%d check(s) failed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,142 @@
+#   ESP32 SvelteKit --
+#
+#   A simple, secure and extensible framework for IoT projects for ESP32 platforms
+#   with responsive Sveltekit front-end built with TailwindCSS and DaisyUI.
+#   https://github.com/theelims/ESP32-sveltekit
+#
+#   Copyright (C) 2023 - 2025 theelims
+#
+#   All Rights Reserved. This software may be modified and distributed under
+#   the terms of the LGPL v3 license. See the LICENSE file for details.
+#
+#   Local stand-in for the firmware download server:
+#
+#       python test/host/ota_server.py [--port 8080] [--drop-after BYTES] [--drops N] [--no-range] <directory>
+#
+#   Serves the firmware images and delta patches in a directory with a strong
+#   ETag and answers Range and If-Range requests like a CDN does. With
+#   --drop-after it cuts the connection after that many body bytes, for the
+#   first --drops responses, so the resume of the download OTA can be tested
+#   against it. --no-range ignores Range headers like a server that can't
+#   resume. The host tests import it, a device can be pointed at it as well.
+
+import argparse
+import hashlib
+import http.server
+import os
+import re
+import threading
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def do_HEAD(self):
+        self.respond(False)
+
+    def do_GET(self):
+        self.respond(True)
+
+    def respond(self, body):
+        config = self.server.config
+        if body and config["hook"]:
+            config["hook"](config["requests"])
+        path = os.path.join(config["directory"], os.path.basename(self.path.split("?")[0]))
+        if not os.path.isfile(path):
+            self.send_error(404)
+            return
+
+        with open(path, "rb") as f:
+            data = f.read()
+        etag = '"{}"'.format(hashlib.md5(data).hexdigest())
+
+        start = 0
+        end = len(data) - 1
+        partial = False
+        match = re.fullmatch(r"bytes=(\d+)-(\d*)", self.headers.get("Range", ""))
+        if match and not config["no_range"]:
+            # a stale If-Range asks for the whole new file instead
+            if_range = self.headers.get("If-Range")
+            if if_range is None or if_range == etag:
+                start = int(match.group(1))
+                if match.group(2):
+                    end = min(end, int(match.group(2)))
+                if start > end:
+                    self.send_response(416)
+                    self.send_header("Content-Range", "bytes */{}".format(len(data)))
+                    self.send_header("Content-Length", "0")
+                    self.end_headers()
+                    return
+                partial = True
+
+        self.send_response(206 if partial else 200)
+        self.send_header("Content-Type", "application/octet-stream")
+        self.send_header("Content-Length", str(end - start + 1))
+        self.send_header("ETag", etag)
+        self.send_header("Accept-Ranges", "none" if config["no_range"] else "bytes")
+        if partial:
+            self.send_header("Content-Range", "bytes {}-{}/{}".format(start, end, len(data)))
+        self.end_headers()
+        if not body:
+            return
+
+        with self.server.lock:
+            config["requests"] += 1
+            drop = config["drop_after"] is not None and config["drops"] > 0
+            if drop:
+                config["drops"] -= 1
+
+        payload = data[start:end + 1]
+        if drop:
+            # the client sees a short body and a closed connection
+            self.wfile.write(payload[:config["drop_after"]])
+            self.wfile.flush()
+            self.close_connection = True
+            return
+        self.wfile.write(payload)
+
+    def log_message(self, format, *args):
+        if self.server.config["verbose"]:
+            super().log_message(format, *args)
+
+
+def start(directory, port=0, drop_after=None, drops=0, no_range=False, verbose=False, hook=None):
+    """
+    Serves directory in a background thread, returns the server, its port is server.server_port.
+    hook is called with the number of earlier requests before each GET is answered.
+    """
+    server = http.server.ThreadingHTTPServer(("", port), Handler)
+    server.daemon_threads = True
+    server.lock = threading.Lock()
+    server.config = {
+        "directory": directory,
+        "drop_after": drop_after,
+        "drops": drops,
+        "no_range": no_range,
+        "verbose": verbose,
+        "hook": hook,
+        "requests": 0,
+    }
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return server
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Firmware download stand-in with Range support and injected disconnects")
+    parser.add_argument("directory", help="directory with the firmware images and patches")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--drop-after", type=int, help="close the connection after this many body bytes")
+    parser.add_argument("--drops", type=int, default=1 << 30, help="how many responses are cut, all by default")
+    parser.add_argument("--no-range", action="store_true", help="ignore Range requests")
+    args = parser.parse_args()
+
+    server = start(args.directory, args.port, args.drop_after, args.drops, args.no_range, True)
+    print("Serving {} on port {}".format(args.directory, server.server_port))
+    try:
+        threading.Event().wait()
+    except KeyboardInterrupt:
+        server.shutdown()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,45 @@
+// Settings documents shaped like those of the framework, for the settings tests built in several configurations
+#pragma once
+
+#include <FSPersistence.h>
+
+static const char *SETTINGS[][2] = {
+    {"/config/wifiSettings.json",
+     R"({"hostname":"esp32-sveltekit","connection_mode":1,"wifi_networks":[)"
+     R"({"ssid":"Home Network","password":"correct horse battery staple","static_ip_config":false},)"
+     R"({"ssid":"Workshop","password":"s3cr3t-passw0rd","static_ip_config":true,"local_ip":"192.168.1.50",)"
+     R"("gateway_ip":"192.168.1.1","subnet_mask":"255.255.255.0","dns_ip_1":"192.168.1.1","dns_ip_2":"8.8.8.8"},)"
+     R"({"ssid":"Phone Hotspot","password":"hotspot1234","static_ip_config":false}]})"},
+    {"/config/apSettings.json",
+     R"({"provision_mode":1,"ssid":"ESP32-SvelteKit-a1b2c3","password":"esp-sveltekit","channel":1,"ssid_hidden":false,)"
+     R"("max_clients":4,"local_ip":"192.168.4.1","gateway_ip":"192.168.4.1","subnet_mask":"255.255.255.0"})"},
+    {"/config/ethernetSettings.json",
+     R"({"hostname":"esp32-sveltekit","static_ip_config":true,"local_ip":"10.0.0.20","gateway_ip":"10.0.0.1",)"
+     R"("subnet_mask":"255.255.255.0","dns_ip_1":"10.0.0.1","dns_ip_2":"1.1.1.1"})"},
+    {"/config/ntpSettings.json",
+     R"({"enabled":true,"server":"time.google.com","tz_label":"Europe/Berlin","tz_format":"CET-1CEST,M3.5.0,M10.5.0/3"})"},
+    {"/config/mqttSettings.json",
+     R"({"enabled":true,"uri":"mqtts://broker.example.com:8883","username":"esp32-a1b2c3","password":"mqtt-password",)"
+     R"("client_id":"esp32-a1b2c3","keep_alive":120,"clean_session":true,"message_interval_ms":5000})"},
+    {"/config/securitySettings.json",
+     R"({"jwt_secret":"4f1c9a7e2b8d6c3f0a5e9b1d7c2f8a6e","users":[{"username":"admin","password":"admin","admin":true},)"
+     R"({"username":"guest","password":"guest","admin":false}]})"}};
+
+static const size_t COUNT = sizeof(SETTINGS) / sizeof(SETTINGS[0]);
+
+// the settings kept as a document, applying them copies every value like the services do
+struct Settings
+{
+    JsonDocument document;
+
+    static void read(Settings &settings, JsonObject &root)
+    {
+        JsonVariant::copy(*root.node(), *settings.document.node());
+    }
+
+    static StateUpdateResult update(JsonObject &root, Settings &settings, const String &originId)
+    {
+        settings.document.set(root);
+        return StateUpdateResult::CHANGED;
+    }
+};
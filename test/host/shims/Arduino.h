@@ -0,0 +1,238 @@
+// Host shim of the Arduino core, just enough for the libraries under test
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <strings.h>
+
+#include <Print.h>
+#include <sdkconfig.h>
+
+using std::max;
+using std::min;
+
+#define ESP_LOGE(tag, format, ...) fprintf(stderr, "E %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) fprintf(stderr, "W %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...)
+#define ESP_LOGD(tag, format, ...)
+#define ESP_LOGV(tag, format, ...)
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+inline const char *esp_err_to_name(esp_err_t err)
+{
+    return err == ESP_OK ? "ESP_OK" : "ESP_FAIL";
+}
+
+inline uint32_t micros()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// a test can stop the clock of millis() and move it on by hand, micros() keeps running for timings
+inline std::atomic<bool> hostClockStopped{false};
+inline std::atomic<uint32_t> hostMillis{0};
+
+inline uint32_t millis()
+{
+    return hostClockStopped ? hostMillis.load() : micros() / 1000;
+}
+
+#define F(string) (string)
+
+inline size_t strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t len = strlen(src);
+    if (size > 0)
+    {
+        size_t copy = min(len, size - 1);
+        memcpy(dst, src, copy);
+        dst[copy] = 0;
+    }
+    return len;
+}
+
+class IPAddress
+{
+public:
+    IPAddress() : _address(0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _address(a | (b << 8) | (c << 16) | ((uint32_t)d << 24)) {}
+    IPAddress(uint32_t address) : _address(address) {}
+    operator uint32_t() const { return _address; }
+
+    bool fromString(const char *address)
+    {
+        unsigned a, b, c, d;
+        if (sscanf(address, "%u.%u.%u.%u", &a, &b, &c, &d) != 4 || a > 255 || b > 255 || c > 255 || d > 255)
+            return false;
+        _address = a | (b << 8) | (c << 16) | (d << 24);
+        return true;
+    }
+    class String toString() const;
+
+private:
+    uint32_t _address;
+};
+
+class String
+{
+public:
+    String() {}
+    String(const char *s) : _s(s ? s : "") {}
+    String(const std::string &s) : _s(s) {}
+    String(int value) : _s(std::to_string(value)) {}
+    String(unsigned int value) : _s(std::to_string(value)) {}
+    String(long value) : _s(std::to_string(value)) {}
+    String(unsigned long value) : _s(std::to_string(value)) {}
+
+    const char *c_str() const { return _s.c_str(); }
+    size_t length() const { return _s.size(); }
+    bool isEmpty() const { return _s.empty(); }
+    char operator[](size_t i) const { return i < _s.size() ? _s[i] : 0; }
+    char &operator[](size_t i) { return _s[i]; }
+
+    bool concat(const char *s, size_t len)
+    {
+        _s.append(s, len);
+        return true;
+    }
+    String &operator+=(const String &s)
+    {
+        _s += s._s;
+        return *this;
+    }
+    String &operator+=(const char *s)
+    {
+        _s += s;
+        return *this;
+    }
+    String &operator+=(char c)
+    {
+        _s += c;
+        return *this;
+    }
+    friend String operator+(const String &a, const String &b) { return String(a._s + b._s); }
+    friend String operator+(const String &a, const char *b) { return String(a._s + b); }
+    friend String operator+(const char *a, const String &b) { return String(a + b._s); }
+    friend String operator+(const String &a, char b) { return String(a._s + b); }
+
+    bool operator==(const String &s) const { return _s == s._s; }
+    bool operator!=(const String &s) const { return _s != s._s; }
+    bool operator==(const char *s) const { return _s == s; }
+    bool operator<(const String &s) const { return _s < s._s; }
+
+    String substring(size_t from) const { return from < _s.size() ? String(_s.substr(from)) : String(); }
+    String substring(size_t from, size_t to) const { return from < _s.size() && to > from ? String(_s.substr(from, to - from)) : String(); }
+    void replace(const char *find, const char *replacement)
+    {
+        size_t findLength = strlen(find), replacementLength = strlen(replacement);
+        for (size_t pos = _s.find(find); findLength && pos != std::string::npos; pos = _s.find(find, pos + replacementLength))
+            _s.replace(pos, findLength, replacement);
+    }
+    void remove(size_t index) { _s.erase(min(index, _s.size())); }
+    void remove(size_t index, size_t count) { _s.erase(min(index, _s.size()), count); }
+    int indexOf(char c, size_t from = 0) const
+    {
+        size_t pos = _s.find(c, from);
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+    int indexOf(const char *s, size_t from = 0) const
+    {
+        size_t pos = _s.find(s, from);
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+    bool startsWith(const char *s) const { return _s.compare(0, strlen(s), s) == 0; }
+    bool startsWith(const String &s) const { return startsWith(s.c_str()); }
+    bool endsWith(const char *s) const
+    {
+        size_t len = strlen(s);
+        return _s.size() >= len && _s.compare(_s.size() - len, len, s) == 0;
+    }
+    int indexOf(const String &s, size_t from = 0) const { return indexOf(s.c_str(), from); }
+    int lastIndexOf(char c) const
+    {
+        size_t pos = _s.rfind(c);
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+    long toInt() const { return strtol(_s.c_str(), NULL, 10); }
+    float toFloat() const { return strtof(_s.c_str(), NULL); }
+
+    bool concat(const char *s) { return concat(s, strlen(s)); }
+    bool concat(const String &s) { return concat(s.c_str(), s.length()); }
+    void clear() { _s.clear(); }
+    void trim()
+    {
+        size_t first = _s.find_first_not_of(" \t\r\n");
+        size_t last = _s.find_last_not_of(" \t\r\n");
+        _s = first == std::string::npos ? std::string() : _s.substr(first, last - first + 1);
+    }
+    void toLowerCase()
+    {
+        for (char &c : _s)
+            c = tolower(c);
+    }
+    bool equals(const char *s) const { return _s == s; }
+    bool equals(const String &s) const { return _s == s._s; }
+    bool equalsIgnoreCase(const char *s) const { return strcasecmp(_s.c_str(), s) == 0; }
+    bool equalsIgnoreCase(const String &s) const { return equalsIgnoreCase(s.c_str()); }
+    bool equalsConstantTime(const String &s) const
+    {
+        if (_s.size() != s._s.size())
+            return false;
+        uint8_t diff = 0;
+        for (size_t i = 0; i < _s.size(); i++)
+            diff |= _s[i] ^ s._s[i];
+        return diff == 0;
+    }
+
+private:
+    std::string _s;
+};
+
+inline String IPAddress::toString() const
+{
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", _address & 0xff, _address >> 8 & 0xff, _address >> 16 & 0xff, _address >> 24);
+    return buffer;
+}
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    // without the timeout of the Arduino core, the host streams don't wait for data
+    virtual size_t readBytes(char *buffer, size_t length)
+    {
+        size_t count = 0;
+        int c;
+        while (count < length && (c = read()) >= 0)
+            buffer[count++] = (char)c;
+        return count;
+    }
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+};
+
+class EspClass
+{
+public:
+    // the tests never get that far
+    void restart() { abort(); }
+};
+
+inline EspClass ESP;
+
+// the Arduino core brings FreeRTOS along
+#include <freertos/FreeRTOS.h>
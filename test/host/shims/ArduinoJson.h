@@ -0,0 +1,1154 @@
+// Stand-in for ArduinoJson 7: a document tree of objects, arrays, strings and numbers with the
+// JSON and MessagePack serializers the framework uses. It is slower than the real library, the
+// benchmarks compare two ways of using it, not the library itself.
+#pragma once
+
+#include <Arduino.h>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#define ARDUINOJSON_VERSION_MAJOR 7
+
+struct JsonNode
+{
+    enum Type
+    {
+        Null,
+        Bool,
+        Integer,
+        Float,
+        Text,
+        Array,
+        Object
+    };
+
+    Type type = Null;
+    bool boolean = false;
+    int64_t integer = 0;
+    double number = 0;
+    std::string text;
+    std::vector<std::pair<std::string, std::unique_ptr<JsonNode>>> members;
+    std::vector<std::unique_ptr<JsonNode>> items;
+
+    void reset(Type to)
+    {
+        type = to;
+        text.clear();
+        members.clear();
+        items.clear();
+    }
+
+    JsonNode *member(const char *key)
+    {
+        for (auto &member : members)
+            if (member.first == key)
+                return member.second.get();
+        return NULL;
+    }
+
+    JsonNode *addMember(const char *key)
+    {
+        members.emplace_back(key, std::unique_ptr<JsonNode>(new JsonNode()));
+        return members.back().second.get();
+    }
+
+    JsonNode *addItem()
+    {
+        items.emplace_back(new JsonNode());
+        return items.back().get();
+    }
+};
+
+class JsonObject;
+class JsonArray;
+
+/**
+ * A value in a document, or a member or item that is only created once something is assigned
+ */
+class JsonVariant
+{
+public:
+    JsonVariant() : _node(NULL), _parent(NULL) {}
+    JsonVariant(JsonNode *node) : _node(node), _parent(NULL) {}
+    JsonVariant(JsonNode *parent, const char *key) : _node(parent ? parent->member(key) : NULL), _parent(parent), _key(key) {}
+
+    JsonNode *node() const { return _node; }
+
+    bool isNull() const { return _node == NULL || _node->type == JsonNode::Null; }
+
+    template <typename T>
+    bool is() const
+    {
+        if (_node == NULL)
+            return false;
+        if (std::is_same<T, JsonObject>::value)
+            return _node->type == JsonNode::Object;
+        if (std::is_same<T, JsonArray>::value)
+            return _node->type == JsonNode::Array;
+        if (std::is_same<T, bool>::value)
+            return _node->type == JsonNode::Bool;
+        if (std::is_same<T, const char *>::value || std::is_same<T, String>::value)
+            return _node->type == JsonNode::Text;
+        if (std::is_floating_point<T>::value)
+            return _node->type == JsonNode::Integer || _node->type == JsonNode::Float;
+        if (std::is_integral<T>::value)
+            return _node->type == JsonNode::Integer;
+        return false;
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_arithmetic<T>::value, T>::type as() const
+    {
+        if (_node == NULL)
+            return 0;
+        switch (_node->type)
+        {
+        case JsonNode::Bool:
+            return _node->boolean;
+        case JsonNode::Integer:
+            return (T)_node->integer;
+        case JsonNode::Float:
+            return (T)_node->number;
+        default:
+            return 0;
+        }
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_same<T, const char *>::value, T>::type as() const
+    {
+        return _node && _node->type == JsonNode::Text ? _node->text.c_str() : NULL;
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_same<T, String>::value, T>::type as() const
+    {
+        return _node && _node->type == JsonNode::Text ? String(_node->text) : String();
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_same<T, JsonObject>::value || std::is_same<T, JsonArray>::value, T>::type as() const;
+
+    template <typename T>
+    typename std::enable_if<std::is_same<T, JsonVariant>::value, T>::type as() const
+    {
+        return *this;
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_same<T, JsonObject>::value || std::is_same<T, JsonArray>::value, T>::type to();
+
+    template <typename T>
+    operator T() const { return as<T>(); }
+
+    // the value, or the default if it is missing or of another type
+    template <typename T>
+    T operator|(const T &fallback) const { return is<T>() ? as<T>() : fallback; }
+    const char *operator|(const char *fallback) const { return is<const char *>() ? as<const char *>() : fallback; }
+    String operator|(const String &fallback) const { return is<String>() ? as<String>() : fallback; }
+
+    JsonVariant operator[](const char *key) const { return JsonVariant(_node && _node->type == JsonNode::Object ? _node : NULL, key); }
+    JsonVariant operator[](const String &key) const { return (*this)[key.c_str()]; }
+    JsonVariant operator[](size_t index) const
+    {
+        return JsonVariant(_node && _node->type == JsonNode::Array && index < _node->items.size() ? _node->items[index].get() : NULL);
+    }
+    JsonVariant operator[](int index) const { return (*this)[(size_t)index]; }
+
+    JsonVariant &operator=(const JsonVariant &value)
+    {
+        if (value._node == NULL)
+            return set(JsonNode::Null);
+        JsonNode *node = create();
+        if (node && node != value._node)
+            copy(*node, *value._node);
+        return *this;
+    }
+    JsonVariant &operator=(const char *value)
+    {
+        if (value == NULL)
+            return set(JsonNode::Null);
+        set(JsonNode::Text);
+        if (_node)
+            _node->text = value;
+        return *this;
+    }
+    JsonVariant &operator=(char *value) { return *this = (const char *)value; }
+    JsonVariant &operator=(const String &value) { return *this = value.c_str(); }
+    JsonVariant &operator=(bool value)
+    {
+        set(JsonNode::Bool);
+        if (_node)
+            _node->boolean = value;
+        return *this;
+    }
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value, JsonVariant &>::type operator=(T value)
+    {
+        set(JsonNode::Integer);
+        if (_node)
+            _node->integer = (int64_t)value;
+        return *this;
+    }
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value, JsonVariant &>::type operator=(T value)
+    {
+        set(JsonNode::Float);
+        if (_node)
+            _node->number = value;
+        return *this;
+    }
+    JsonVariant &operator=(const JsonObject &value);
+    JsonVariant &operator=(const JsonArray &value);
+
+    template <typename T>
+    bool set(const T &value)
+    {
+        *this = value;
+        return _node != NULL;
+    }
+
+    size_t size() const
+    {
+        if (_node == NULL)
+            return 0;
+        return _node->type == JsonNode::Object ? _node->members.size() : _node->type == JsonNode::Array ? _node->items.size() : 0;
+    }
+
+    bool containsKey(const char *key) const { return _node && _node->type == JsonNode::Object && _node->member(key); }
+
+    static void copy(JsonNode &to, const JsonNode &from)
+    {
+        to.reset(from.type);
+        to.boolean = from.boolean;
+        to.integer = from.integer;
+        to.number = from.number;
+        to.text = from.text;
+        for (const auto &member : from.members)
+            copy(*to.addMember(member.first.c_str()), *member.second);
+        for (const auto &item : from.items)
+            copy(*to.addItem(), *item);
+    }
+
+protected:
+    JsonNode *_node;
+    JsonNode *_parent;
+    std::string _key;
+
+    // the node of a member assigned for the first time is added to its object now
+    JsonNode *create()
+    {
+        if (_node == NULL && _parent != NULL && _parent->type == JsonNode::Object)
+            _node = _parent->addMember(_key.c_str());
+        return _node;
+    }
+
+    JsonVariant &set(JsonNode::Type type)
+    {
+        if (create())
+            _node->reset(type);
+        return *this;
+    }
+};
+
+class JsonObject : public JsonVariant
+{
+public:
+    JsonObject() {}
+    explicit JsonObject(JsonNode *node) : JsonVariant(node && node->type == JsonNode::Object ? node : NULL) {}
+    JsonObject(const JsonObject &other) = default;
+
+    // objects are references, assigning one rebinds it
+    JsonObject &operator=(const JsonObject &other)
+    {
+        _node = other._node;
+        _parent = NULL;
+        return *this;
+    }
+
+    JsonVariant operator[](const char *key) const { return JsonVariant(_node, key); }
+    JsonVariant operator[](const String &key) const { return JsonVariant(_node, key.c_str()); }
+
+    void remove(const char *key)
+    {
+        if (_node == NULL)
+            return;
+        for (auto i = _node->members.begin(); i != _node->members.end(); ++i)
+            if (i->first == key)
+            {
+                _node->members.erase(i);
+                return;
+            }
+    }
+    void clear()
+    {
+        if (_node)
+            _node->reset(JsonNode::Object);
+    }
+};
+
+class JsonArray : public JsonVariant
+{
+public:
+    JsonArray() {}
+    explicit JsonArray(JsonNode *node) : JsonVariant(node && node->type == JsonNode::Array ? node : NULL) {}
+    JsonArray(const JsonArray &other) = default;
+
+    JsonArray &operator=(const JsonArray &other)
+    {
+        _node = other._node;
+        _parent = NULL;
+        return *this;
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_same<T, JsonObject>::value || std::is_same<T, JsonArray>::value, T>::type add()
+    {
+        if (_node == NULL)
+            return T();
+        JsonNode *item = _node->addItem();
+        item->reset(std::is_same<T, JsonObject>::value ? JsonNode::Object : JsonNode::Array);
+        return T(item);
+    }
+
+    template <typename T>
+    bool add(const T &value)
+    {
+        if (_node == NULL)
+            return false;
+        JsonVariant item(_node->addItem());
+        item = value;
+        return true;
+    }
+
+    class iterator
+    {
+    public:
+        iterator(std::vector<std::unique_ptr<JsonNode>>::iterator i) : _i(i) {}
+        JsonVariant operator*() const { return JsonVariant(_i->get()); }
+        iterator &operator++()
+        {
+            ++_i;
+            return *this;
+        }
+        bool operator!=(const iterator &other) const { return _i != other._i; }
+
+    private:
+        std::vector<std::unique_ptr<JsonNode>>::iterator _i;
+    };
+
+    iterator begin() const { return _node ? iterator(_node->items.begin()) : iterator(empty().begin()); }
+    iterator end() const { return _node ? iterator(_node->items.end()) : iterator(empty().end()); }
+
+private:
+    static std::vector<std::unique_ptr<JsonNode>> &empty()
+    {
+        static std::vector<std::unique_ptr<JsonNode>> items;
+        return items;
+    }
+};
+
+template <typename T>
+typename std::enable_if<std::is_same<T, JsonObject>::value || std::is_same<T, JsonArray>::value, T>::type JsonVariant::as() const
+{
+    return T(_node);
+}
+
+template <typename T>
+typename std::enable_if<std::is_same<T, JsonObject>::value || std::is_same<T, JsonArray>::value, T>::type JsonVariant::to()
+{
+    set(std::is_same<T, JsonObject>::value ? JsonNode::Object : JsonNode::Array);
+    return T(_node);
+}
+
+inline JsonVariant &JsonVariant::operator=(const JsonObject &value) { return *this = (const JsonVariant &)value; }
+inline JsonVariant &JsonVariant::operator=(const JsonArray &value) { return *this = (const JsonVariant &)value; }
+
+class JsonDocument
+{
+public:
+    JsonDocument() : _root(new JsonNode()) {}
+    JsonDocument(const JsonDocument &other) : _root(new JsonNode()) { JsonVariant::copy(*_root, *other._root); }
+    JsonDocument &operator=(const JsonDocument &other)
+    {
+        JsonVariant::copy(*_root, *other._root);
+        return *this;
+    }
+
+    JsonNode *node() const { return _root.get(); }
+
+    // the root becomes an object when a member is assigned
+    JsonVariant operator[](const char *key)
+    {
+        if (_root->type == JsonNode::Null)
+            _root->reset(JsonNode::Object);
+        return JsonVariant(_root.get(), key);
+    }
+    JsonVariant operator[](const String &key) { return (*this)[key.c_str()]; }
+
+    template <typename T>
+    bool is() const { return JsonVariant(_root.get()).is<T>(); }
+
+    template <typename T>
+    T as() const { return JsonVariant(_root.get()).as<T>(); }
+
+    template <typename T>
+    T to()
+    {
+        _root->reset(JsonNode::Null);
+        return JsonVariant(_root.get()).to<T>();
+    }
+
+    template <typename T>
+    T add()
+    {
+        if (_root->type != JsonNode::Array)
+            _root->reset(JsonNode::Array);
+        return JsonArray(_root.get()).add<T>();
+    }
+
+    operator JsonVariant() const { return JsonVariant(_root.get()); }
+
+    // a deep copy of the source like ArduinoJson's JsonDocument::set()
+    bool set(const JsonVariant &source)
+    {
+        if (source.node() == NULL)
+            _root->reset(JsonNode::Null);
+        else
+            JsonVariant::copy(*_root, *source.node());
+        return true;
+    }
+
+    void clear() { _root->reset(JsonNode::Null); }
+    bool overflowed() const { return false; }
+    size_t size() const { return JsonVariant(_root.get()).size(); }
+
+private:
+    std::unique_ptr<JsonNode> _root;
+};
+
+class DeserializationError
+{
+public:
+    enum Code
+    {
+        Ok,
+        EmptyInput,
+        IncompleteInput,
+        InvalidInput,
+        NoMemory,
+        TooDeep
+    };
+
+    DeserializationError(Code code = Ok) : _code(code) {}
+    Code code() const { return _code; }
+    explicit operator bool() const { return _code != Ok; }
+    bool operator==(Code code) const { return _code == code; }
+    bool operator!=(Code code) const { return _code != code; }
+    const char *c_str() const
+    {
+        static const char *names[] = {"Ok", "EmptyInput", "IncompleteInput", "InvalidInput", "NoMemory", "TooDeep"};
+        return names[_code];
+    }
+
+private:
+    Code _code;
+};
+
+namespace ArduinoJsonShim
+{
+    inline const JsonNode *nodeOf(const JsonDocument &source) { return source.node(); }
+    inline const JsonNode *nodeOf(const JsonVariant &source) { return source.node(); }
+
+    // ArduinoJson hands small pieces to the writer as well
+    struct Writer
+    {
+        virtual void write(const char *s, size_t len) = 0;
+        void put(char c) { write(&c, 1); }
+        void put(const char *s) { write(s, strlen(s)); }
+    };
+
+    struct CountingWriter : Writer
+    {
+        size_t count = 0;
+        void write(const char *s, size_t len) override { count += len; }
+    };
+
+    struct BufferWriter : Writer
+    {
+        char *buffer;
+        size_t size;
+        size_t pos = 0;
+        BufferWriter(char *buffer, size_t size) : buffer(buffer), size(size) {}
+        void write(const char *s, size_t len) override
+        {
+            len = min(len, size - pos);
+            memcpy(buffer + pos, s, len);
+            pos += len;
+        }
+    };
+
+    struct PrintWriter : Writer
+    {
+        Print &print;
+        size_t count = 0;
+        PrintWriter(Print &print) : print(print) {}
+        void write(const char *s, size_t len) override
+        {
+            count += len == 1 ? print.write((uint8_t)*s) : print.write((const uint8_t *)s, len);
+        }
+    };
+
+    struct StringWriter : Writer
+    {
+        String &string;
+        StringWriter(String &string) : string(string) {}
+        void write(const char *s, size_t len) override { string.concat(s, len); }
+    };
+
+    inline void writeJsonString(Writer &out, const std::string &text)
+    {
+        out.put('"');
+        size_t start = 0;
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            unsigned char c = text[i];
+            if (c != '"' && c != '\\' && c >= 0x20)
+                continue;
+            out.write(text.data() + start, i - start);
+            char escaped[8];
+            switch (c)
+            {
+            case '"':
+                out.put("\\\"");
+                break;
+            case '\\':
+                out.put("\\\\");
+                break;
+            case '\n':
+                out.put("\\n");
+                break;
+            case '\r':
+                out.put("\\r");
+                break;
+            case '\t':
+                out.put("\\t");
+                break;
+            default:
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out.put(escaped);
+            }
+            start = i + 1;
+        }
+        out.write(text.data() + start, text.size() - start);
+        out.put('"');
+    }
+
+    inline void writeJson(Writer &out, const JsonNode *node)
+    {
+        char number[32];
+        switch (node ? node->type : JsonNode::Null)
+        {
+        case JsonNode::Null:
+            out.put("null");
+            break;
+        case JsonNode::Bool:
+            out.put(node->boolean ? "true" : "false");
+            break;
+        case JsonNode::Integer:
+            snprintf(number, sizeof(number), "%lld", (long long)node->integer);
+            out.put(number);
+            break;
+        case JsonNode::Float:
+            snprintf(number, sizeof(number), "%.9g", node->number);
+            out.put(std::isfinite(node->number) ? number : "null");
+            break;
+        case JsonNode::Text:
+            writeJsonString(out, node->text);
+            break;
+        case JsonNode::Array:
+            out.put('[');
+            for (size_t i = 0; i < node->items.size(); i++)
+            {
+                if (i)
+                    out.put(',');
+                writeJson(out, node->items[i].get());
+            }
+            out.put(']');
+            break;
+        case JsonNode::Object:
+            out.put('{');
+            for (size_t i = 0; i < node->members.size(); i++)
+            {
+                if (i)
+                    out.put(',');
+                writeJsonString(out, node->members[i].first);
+                out.put(':');
+                writeJson(out, node->members[i].second.get());
+            }
+            out.put('}');
+            break;
+        }
+    }
+
+    inline void writeBigEndian(Writer &out, uint8_t marker, uint64_t value, int bytes)
+    {
+        char data[9];
+        data[0] = marker;
+        for (int i = 0; i < bytes; i++)
+            data[1 + i] = value >> (8 * (bytes - 1 - i));
+        out.write(data, bytes + 1);
+    }
+
+    inline void writeMsgPackLength(Writer &out, size_t len, uint8_t fix, size_t fixMax, uint8_t marker8, uint8_t marker16, uint8_t marker32)
+    {
+        if (len <= fixMax)
+            out.put((char)(fix | len));
+        else if (marker8 && len <= 0xff)
+            writeBigEndian(out, marker8, len, 1);
+        else if (len <= 0xffff)
+            writeBigEndian(out, marker16, len, 2);
+        else
+            writeBigEndian(out, marker32, len, 4);
+    }
+
+    inline void writeMsgPack(Writer &out, const JsonNode *node)
+    {
+        switch (node ? node->type : JsonNode::Null)
+        {
+        case JsonNode::Null:
+            out.put((char)0xc0);
+            break;
+        case JsonNode::Bool:
+            out.put((char)(node->boolean ? 0xc3 : 0xc2));
+            break;
+        case JsonNode::Integer:
+        {
+            int64_t value = node->integer;
+            if (value >= 0)
+            {
+                if (value < 0x80)
+                    out.put((char)value);
+                else if (value <= 0xff)
+                    writeBigEndian(out, 0xcc, value, 1);
+                else if (value <= 0xffff)
+                    writeBigEndian(out, 0xcd, value, 2);
+                else if (value <= 0xffffffffLL)
+                    writeBigEndian(out, 0xce, value, 4);
+                else
+                    writeBigEndian(out, 0xcf, value, 8);
+            }
+            else if (value >= -32)
+                out.put((char)value);
+            else if (value >= INT8_MIN)
+                writeBigEndian(out, 0xd0, (uint8_t)value, 1);
+            else if (value >= INT16_MIN)
+                writeBigEndian(out, 0xd1, (uint16_t)value, 2);
+            else if (value >= INT32_MIN)
+                writeBigEndian(out, 0xd2, (uint32_t)value, 4);
+            else
+                writeBigEndian(out, 0xd3, (uint64_t)value, 8);
+            break;
+        }
+        case JsonNode::Float:
+        {
+            // float32 if nothing is lost, like ArduinoJson does
+            float single = (float)node->number;
+            if ((double)single == node->number)
+            {
+                uint32_t bits;
+                memcpy(&bits, &single, 4);
+                writeBigEndian(out, 0xca, bits, 4);
+            }
+            else
+            {
+                uint64_t bits;
+                memcpy(&bits, &node->number, 8);
+                writeBigEndian(out, 0xcb, bits, 8);
+            }
+            break;
+        }
+        case JsonNode::Text:
+            writeMsgPackLength(out, node->text.size(), 0xa0, 31, 0xd9, 0xda, 0xdb);
+            out.write(node->text.data(), node->text.size());
+            break;
+        case JsonNode::Array:
+            writeMsgPackLength(out, node->items.size(), 0x90, 15, 0, 0xdc, 0xdd);
+            for (const auto &item : node->items)
+                writeMsgPack(out, item.get());
+            break;
+        case JsonNode::Object:
+            writeMsgPackLength(out, node->members.size(), 0x80, 15, 0, 0xde, 0xdf);
+            for (const auto &member : node->members)
+            {
+                writeMsgPackLength(out, member.first.size(), 0xa0, 31, 0xd9, 0xda, 0xdb);
+                out.write(member.first.data(), member.first.size());
+                writeMsgPack(out, member.second.get());
+            }
+            break;
+        }
+    }
+
+    class Reader
+    {
+    public:
+        Reader(const uint8_t *data, size_t len) : _data(data), _end(data + len) {}
+
+        DeserializationError json(JsonNode &root)
+        {
+            skipSpace();
+            if (_data == _end)
+                return DeserializationError::EmptyInput;
+            return jsonValue(root, 0);
+        }
+
+        DeserializationError msgPack(JsonNode &root)
+        {
+            if (_data == _end)
+                return DeserializationError::EmptyInput;
+            return msgPackValue(root, 0);
+        }
+
+    private:
+        const uint8_t *_data;
+        const uint8_t *_end;
+
+        static const int maxDepth = 10;
+
+        void skipSpace()
+        {
+            while (_data < _end && (*_data == ' ' || *_data == '\t' || *_data == '\n' || *_data == '\r'))
+                _data++;
+        }
+
+        bool literal(const char *word)
+        {
+            size_t len = strlen(word);
+            if ((size_t)(_end - _data) < len || memcmp(_data, word, len) != 0)
+                return false;
+            _data += len;
+            return true;
+        }
+
+        DeserializationError jsonString(std::string &text)
+        {
+            _data++;
+            for (;;)
+            {
+                if (_data == _end)
+                    return DeserializationError::IncompleteInput;
+                char c = *_data++;
+                if (c == '"')
+                    return DeserializationError::Ok;
+                if (c != '\\')
+                {
+                    text += c;
+                    continue;
+                }
+                if (_data == _end)
+                    return DeserializationError::IncompleteInput;
+                c = *_data++;
+                switch (c)
+                {
+                case 'n':
+                    text += '\n';
+                    break;
+                case 'r':
+                    text += '\r';
+                    break;
+                case 't':
+                    text += '\t';
+                    break;
+                case 'b':
+                    text += '\b';
+                    break;
+                case 'f':
+                    text += '\f';
+                    break;
+                case 'u':
+                {
+                    if (_end - _data < 4)
+                        return DeserializationError::IncompleteInput;
+                    unsigned code = strtoul(std::string((const char *)_data, 4).c_str(), NULL, 16);
+                    _data += 4;
+                    if (code < 0x80)
+                        text += (char)code;
+                    else if (code < 0x800)
+                    {
+                        text += (char)(0xc0 | (code >> 6));
+                        text += (char)(0x80 | (code & 0x3f));
+                    }
+                    else
+                    {
+                        text += (char)(0xe0 | (code >> 12));
+                        text += (char)(0x80 | ((code >> 6) & 0x3f));
+                        text += (char)(0x80 | (code & 0x3f));
+                    }
+                    break;
+                }
+                default:
+                    text += c;
+                }
+            }
+        }
+
+        DeserializationError jsonValue(JsonNode &node, int depth)
+        {
+            if (depth > maxDepth)
+                return DeserializationError::TooDeep;
+            skipSpace();
+            if (_data == _end)
+                return DeserializationError::IncompleteInput;
+
+            char c = *_data;
+            if (c == '{' || c == '[')
+            {
+                bool object = c == '{';
+                node.reset(object ? JsonNode::Object : JsonNode::Array);
+                _data++;
+                skipSpace();
+                if (_data < _end && *_data == (object ? '}' : ']'))
+                {
+                    _data++;
+                    return DeserializationError::Ok;
+                }
+                for (;;)
+                {
+                    JsonNode *child;
+                    if (object)
+                    {
+                        skipSpace();
+                        if (_data == _end)
+                            return DeserializationError::IncompleteInput;
+                        if (*_data != '"')
+                            return DeserializationError::InvalidInput;
+                        std::string key;
+                        DeserializationError error = jsonString(key);
+                        if (error)
+                            return error;
+                        skipSpace();
+                        if (_data == _end)
+                            return DeserializationError::IncompleteInput;
+                        if (*_data++ != ':')
+                            return DeserializationError::InvalidInput;
+                        child = node.addMember(key.c_str());
+                    }
+                    else
+                        child = node.addItem();
+
+                    DeserializationError error = jsonValue(*child, depth + 1);
+                    if (error)
+                        return error;
+                    skipSpace();
+                    if (_data == _end)
+                        return DeserializationError::IncompleteInput;
+                    c = *_data++;
+                    if (c == (object ? '}' : ']'))
+                        return DeserializationError::Ok;
+                    if (c != ',')
+                        return DeserializationError::InvalidInput;
+                }
+            }
+            if (c == '"')
+            {
+                node.reset(JsonNode::Text);
+                return jsonString(node.text);
+            }
+            if (literal("true") || literal("false"))
+            {
+                node.reset(JsonNode::Bool);
+                node.boolean = _data[-1] == 'e' && _data[-2] == 'u';
+                return DeserializationError::Ok;
+            }
+            if (literal("null"))
+            {
+                node.reset(JsonNode::Null);
+                return DeserializationError::Ok;
+            }
+
+            const uint8_t *start = _data;
+            bool integer = true;
+            while (_data < _end && strchr("0123456789+-.eE", *_data))
+            {
+                if (!isdigit(*_data) && !(*_data == '-' && _data == start))
+                    integer = false;
+                _data++;
+            }
+            if (_data == start)
+                return DeserializationError::InvalidInput;
+            std::string number((const char *)start, _data - start);
+            if (integer)
+            {
+                node.reset(JsonNode::Integer);
+                node.integer = strtoll(number.c_str(), NULL, 10);
+            }
+            else
+            {
+                node.reset(JsonNode::Float);
+                node.number = strtod(number.c_str(), NULL);
+            }
+            return DeserializationError::Ok;
+        }
+
+        bool bigEndian(int bytes, uint64_t &value)
+        {
+            if (_end - _data < bytes)
+                return false;
+            value = 0;
+            for (int i = 0; i < bytes; i++)
+                value = (value << 8) | *_data++;
+            return true;
+        }
+
+        DeserializationError msgPackText(std::string &text, size_t len)
+        {
+            if ((size_t)(_end - _data) < len)
+                return DeserializationError::IncompleteInput;
+            text.assign((const char *)_data, len);
+            _data += len;
+            return DeserializationError::Ok;
+        }
+
+        DeserializationError msgPackValue(JsonNode &node, int depth)
+        {
+            if (depth > maxDepth)
+                return DeserializationError::TooDeep;
+            if (_data == _end)
+                return DeserializationError::IncompleteInput;
+
+            uint8_t marker = *_data++;
+            uint64_t value = 0;
+            size_t count = 0;
+            bool object = false;
+
+            if (marker < 0x80 || marker >= 0xe0)
+            {
+                node.reset(JsonNode::Integer);
+                node.integer = (int8_t)marker;
+                if (marker < 0x80)
+                    node.integer = marker;
+                return DeserializationError::Ok;
+            }
+            if ((marker & 0xe0) == 0xa0)
+            {
+                node.reset(JsonNode::Text);
+                return msgPackText(node.text, marker & 0x1f);
+            }
+            if ((marker & 0xf0) == 0x90 || (marker & 0xf0) == 0x80)
+            {
+                object = (marker & 0xf0) == 0x80;
+                count = marker & 0x0f;
+            }
+            else
+            {
+                static const int sizes[] = {1, 2, 4, 8};
+                switch (marker)
+                {
+                case 0xc0:
+                    node.reset(JsonNode::Null);
+                    return DeserializationError::Ok;
+                case 0xc2:
+                case 0xc3:
+                    node.reset(JsonNode::Bool);
+                    node.boolean = marker == 0xc3;
+                    return DeserializationError::Ok;
+                case 0xcc:
+                case 0xcd:
+                case 0xce:
+                case 0xcf:
+                    if (!bigEndian(sizes[marker - 0xcc], value))
+                        return DeserializationError::IncompleteInput;
+                    node.reset(JsonNode::Integer);
+                    node.integer = (int64_t)value;
+                    return DeserializationError::Ok;
+                case 0xd0:
+                case 0xd1:
+                case 0xd2:
+                case 0xd3:
+                {
+                    int bytes = sizes[marker - 0xd0];
+                    if (!bigEndian(bytes, value))
+                        return DeserializationError::IncompleteInput;
+                    node.reset(JsonNode::Integer);
+                    node.integer = bytes == 8 ? (int64_t)value : (int64_t)(value << (64 - 8 * bytes)) >> (64 - 8 * bytes);
+                    return DeserializationError::Ok;
+                }
+                case 0xca:
+                {
+                    if (!bigEndian(4, value))
+                        return DeserializationError::IncompleteInput;
+                    uint32_t bits = value;
+                    float single;
+                    memcpy(&single, &bits, 4);
+                    node.reset(JsonNode::Float);
+                    node.number = single;
+                    return DeserializationError::Ok;
+                }
+                case 0xcb:
+                    if (!bigEndian(8, value))
+                        return DeserializationError::IncompleteInput;
+                    node.reset(JsonNode::Float);
+                    memcpy(&node.number, &value, 8);
+                    return DeserializationError::Ok;
+                case 0xd9:
+                case 0xda:
+                case 0xdb:
+                    if (!bigEndian(sizes[marker - 0xd9], value))
+                        return DeserializationError::IncompleteInput;
+                    node.reset(JsonNode::Text);
+                    return msgPackText(node.text, value);
+                case 0xdc:
+                case 0xdd:
+                case 0xde:
+                case 0xdf:
+                    if (!bigEndian(marker & 1 ? 4 : 2, value))
+                        return DeserializationError::IncompleteInput;
+                    count = value;
+                    object = marker >= 0xde;
+                    break;
+                default:
+                    return DeserializationError::InvalidInput;
+                }
+            }
+
+            node.reset(object ? JsonNode::Object : JsonNode::Array);
+            for (size_t i = 0; i < count; i++)
+            {
+                JsonNode *child;
+                if (object)
+                {
+                    JsonNode key;
+                    DeserializationError error = msgPackValue(key, depth + 1);
+                    if (error)
+                        return error;
+                    if (key.type != JsonNode::Text)
+                        return DeserializationError::InvalidInput;
+                    child = node.addMember(key.text.c_str());
+                }
+                else
+                    child = node.addItem();
+                DeserializationError error = msgPackValue(*child, depth + 1);
+                if (error)
+                    return error;
+            }
+            return DeserializationError::Ok;
+        }
+    };
+}
+
+template <typename Source>
+size_t measureJson(const Source &source)
+{
+    ArduinoJsonShim::CountingWriter out;
+    ArduinoJsonShim::writeJson(out, ArduinoJsonShim::nodeOf(source));
+    return out.count;
+}
+
+// like ArduinoJson the output is null terminated if there is room, the length excludes the terminator
+template <typename Source>
+size_t serializeJson(const Source &source, char *buffer, size_t size)
+{
+    if (size == 0)
+        return 0;
+    ArduinoJsonShim::BufferWriter out(buffer, size - 1);
+    ArduinoJsonShim::writeJson(out, ArduinoJsonShim::nodeOf(source));
+    buffer[out.pos] = 0;
+    return out.pos;
+}
+
+template <typename Source>
+size_t serializeJson(const Source &source, Print &print)
+{
+    ArduinoJsonShim::PrintWriter out(print);
+    ArduinoJsonShim::writeJson(out, ArduinoJsonShim::nodeOf(source));
+    return out.count;
+}
+
+template <typename Source>
+size_t serializeJson(const Source &source, String &string)
+{
+    ArduinoJsonShim::StringWriter out(string);
+    ArduinoJsonShim::writeJson(out, ArduinoJsonShim::nodeOf(source));
+    return string.length();
+}
+
+template <typename Source>
+size_t measureMsgPack(const Source &source)
+{
+    ArduinoJsonShim::CountingWriter out;
+    ArduinoJsonShim::writeMsgPack(out, ArduinoJsonShim::nodeOf(source));
+    return out.count;
+}
+
+template <typename Source>
+size_t serializeMsgPack(const Source &source, char *buffer, size_t size)
+{
+    ArduinoJsonShim::BufferWriter out(buffer, size);
+    ArduinoJsonShim::writeMsgPack(out, ArduinoJsonShim::nodeOf(source));
+    return out.pos;
+}
+
+template <typename Source>
+size_t serializeMsgPack(const Source &source, Print &print)
+{
+    ArduinoJsonShim::PrintWriter out(print);
+    ArduinoJsonShim::writeMsgPack(out, ArduinoJsonShim::nodeOf(source));
+    return out.count;
+}
+
+inline DeserializationError deserializeJson(JsonDocument &document, const uint8_t *data, size_t len)
+{
+    document.clear();
+    return ArduinoJsonShim::Reader(data, len).json(*document.node());
+}
+
+inline DeserializationError deserializeJson(JsonDocument &document, const char *data, size_t len)
+{
+    return deserializeJson(document, (const uint8_t *)data, len);
+}
+
+inline DeserializationError deserializeJson(JsonDocument &document, const char *data)
+{
+    return deserializeJson(document, data, strlen(data));
+}
+
+inline DeserializationError deserializeJson(JsonDocument &document, const String &data)
+{
+    return deserializeJson(document, data.c_str(), data.length());
+}
+
+// streams are read to the end first, the shim doesn't parse incrementally
+inline DeserializationError deserializeJson(JsonDocument &document, Stream &input)
+{
+    std::string data;
+    char buffer[256];
+    size_t read;
+    while ((read = input.readBytes(buffer, sizeof(buffer))) > 0)
+        data.append(buffer, read);
+    return deserializeJson(document, data.data(), data.size());
+}
+
+inline DeserializationError deserializeMsgPack(JsonDocument &document, const uint8_t *data, size_t len)
+{
+    document.clear();
+    return ArduinoJsonShim::Reader(data, len).msgPack(*document.node());
+}
+
+inline DeserializationError deserializeMsgPack(JsonDocument &document, const char *data, size_t len)
+{
+    return deserializeMsgPack(document, (const uint8_t *)data, len);
+}
+
+inline DeserializationError deserializeMsgPack(JsonDocument &document, Stream &input)
+{
+    std::string data;
+    char buffer[256];
+    size_t read;
+    while ((read = input.readBytes(buffer, sizeof(buffer))) > 0)
+        data.append(buffer, read);
+    return deserializeMsgPack(document, data.data(), data.size());
+}
@@ -0,0 +1,87 @@
+// Host shim of DownloadFirmwareService.h, the service as declared there with small stand-ins
+// for the server, the event socket and the filesystem it works with
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <FirmwareUpdateEvents.h>
+#include <FirmwareWriter.h>
+#include <SecurityManager.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+#include <vector>
+
+#define GITHUB_FIRMWARE_PATH "/rest/downloadUpdate"
+#define OTA_TASK_STACK_SIZE 9216
+
+// short backoffs keep the tests fast
+#define OTA_DOWNLOAD_RETRIES 5
+#define OTA_DOWNLOAD_BACKOFF_MS 10
+
+class PsychicRequest
+{
+public:
+    esp_err_t reply(int code) { return ESP_OK; }
+};
+
+class PsychicHttpServer
+{
+public:
+    template <typename Callback>
+    void on(const char *uri, int method, Callback callback) {}
+};
+
+#define HTTP_POST 3
+
+typedef bool Authentication;
+
+namespace AuthenticationPredicates
+{
+    inline bool IS_ADMIN(Authentication &authentication) { return authentication; }
+}
+
+class SecurityManager
+{
+public:
+    template <typename Callback, typename Predicate>
+    Callback wrapCallback(Callback callback, Predicate predicate) { return callback; }
+};
+
+// keeps the status of every event
+class EventSocket
+{
+public:
+    bool isEventValid(const char *event) { return true; }
+    void registerEvent(const char *event) {}
+    void emitEvent(const char *event, JsonObject &json) { statuses.push_back(json["status"]); }
+
+    std::vector<String> statuses;
+};
+
+class FilesystemUpdate
+{
+public:
+    bool begin() { return true; }
+    void end(bool intact = true) {}
+    static bool isImage(const char *name) { return strstr(name, "littlefs") != NULL; }
+};
+
+class FSPersistenceBase
+{
+public:
+    static void shutdown(bool flush = true) {}
+};
+
+class DownloadFirmwareService
+{
+public:
+    DownloadFirmwareService(PsychicHttpServer *server, SecurityManager *securityManager, EventSocket *socket);
+
+    void begin();
+
+private:
+    SecurityManager *_securityManager;
+    PsychicHttpServer *_server;
+    EventSocket *_socket;
+    esp_err_t downloadUpdate(PsychicRequest *request, JsonVariant &json);
+};
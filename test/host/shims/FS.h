@@ -0,0 +1,323 @@
+// Host shim of the Arduino filesystem: an in-memory filesystem that behaves like LittleFS where it
+// matters for the framework. What is written to a file is only committed when the file is closed,
+// rename and remove are atomic. A test can count the operations and cut the power after any write,
+// close, rename or remove, the pending content of open files is lost then.
+#pragma once
+
+#include <Arduino.h>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace fs
+{
+    // thrown out of the filesystem call at which the power is cut
+    struct PowerCut
+    {
+    };
+
+    struct HostStorage
+    {
+        struct Entry
+        {
+            std::vector<uint8_t> data;
+            time_t modified;
+        };
+
+        std::map<std::string, Entry> files;
+        std::set<std::string> directories = {"/"};
+
+        // esp_littlefs stores time(NULL), the test sets the clock
+        time_t now = 1700000000;
+
+        // number of steps until the power is cut, -1 never
+        long cutAfter = -1;
+        bool off = false;
+
+        struct
+        {
+            unsigned exists, open, write, close, rename, remove, mkdir;
+        } counts = {};
+
+        void step()
+        {
+            if (cutAfter > 0 && --cutAfter == 0)
+            {
+                off = true;
+                throw PowerCut();
+            }
+        }
+
+        // the device comes up again, only committed data is left
+        void reboot()
+        {
+            off = false;
+            cutAfter = -1;
+        }
+
+        bool isDirectory(const std::string &path) const { return directories.count(path) > 0; }
+
+        static std::string parent(const std::string &path)
+        {
+            size_t slash = path.rfind('/');
+            return slash == 0 || slash == std::string::npos ? "/" : path.substr(0, slash);
+        }
+    };
+
+    enum SeekMode
+    {
+        SeekSet = 0,
+        SeekCur = 1,
+        SeekEnd = 2
+    };
+
+    class File : public Stream
+    {
+    public:
+        File() {}
+        File(std::shared_ptr<HostStorage> storage, const std::string &path, bool writing, bool keep, bool append = false)
+            : _state(new State{storage, path, writing, false, 0, {}, {}})
+        {
+            if (storage->isDirectory(path))
+            {
+                _state->directory = true;
+                std::string prefix = path == "/" ? "/" : path + "/";
+                for (const auto &file : storage->files)
+                    if (file.first.compare(0, prefix.size(), prefix) == 0 && file.first.find('/', prefix.size()) == std::string::npos)
+                        _state->children.push_back(file.first);
+                for (const std::string &directory : storage->directories)
+                    if (directory != path && directory.compare(0, prefix.size(), prefix) == 0 && directory.find('/', prefix.size()) == std::string::npos)
+                        _state->children.push_back(directory);
+                return;
+            }
+            if (!writing || keep)
+                _state->data = storage->files[path].data;
+            if (append)
+                _state->position = _state->data.size();
+        }
+
+        ~File()
+        {
+            if (_state && _state.use_count() == 1)
+                close();
+        }
+
+        File(const File &other) = default;
+        File &operator=(const File &other)
+        {
+            if (_state && _state != other._state && _state.use_count() == 1)
+                close();
+            _state = other._state;
+            return *this;
+        }
+
+        explicit operator bool() const { return _state != nullptr; }
+
+        size_t write(uint8_t c) override { return write(&c, 1); }
+        size_t write(const uint8_t *buffer, size_t size) override
+        {
+            if (!_state || !_state->writing || _state->storage->off)
+                return 0;
+            std::vector<uint8_t> &data = _state->data;
+            if (data.size() < _state->position + size)
+                data.resize(_state->position + size);
+            memcpy(data.data() + _state->position, buffer, size);
+            _state->position += size;
+            _state->storage->counts.write++;
+            _state->storage->step();
+            return size;
+        }
+
+        int available() override { return _state && !_state->directory ? (int)(_state->data.size() - _state->position) : 0; }
+        int read() override
+        {
+            uint8_t c;
+            return read(&c, 1) == 1 ? c : -1;
+        }
+        int peek() override { return available() ? _state->data[_state->position] : -1; }
+        size_t read(uint8_t *buffer, size_t size)
+        {
+            size = min(size, (size_t)available());
+            if (size)
+                memcpy(buffer, _state->data.data() + _state->position, size);
+            if (_state)
+                _state->position += size;
+            return size;
+        }
+        size_t readBytes(char *buffer, size_t length) override { return read((uint8_t *)buffer, length); }
+
+        bool seek(uint32_t pos, SeekMode mode = SeekSet)
+        {
+            if (!_state)
+                return false;
+            size_t base = mode == SeekSet ? 0 : mode == SeekCur ? _state->position : _state->data.size();
+            if (base + pos > _state->data.size())
+                return false;
+            _state->position = base + pos;
+            return true;
+        }
+        size_t position() const { return _state ? _state->position : 0; }
+        size_t size() const { return _state ? _state->data.size() : 0; }
+
+        // like esp_littlefs, flush() hands the data to the filesystem without committing it
+        void flush() override {}
+
+        void close()
+        {
+            if (!_state)
+                return;
+            std::shared_ptr<State> state = _state;
+            _state.reset();
+            if (!state->writing || state->storage->off)
+                return;
+            HostStorage::Entry &entry = state->storage->files[state->path];
+            entry.data = state->data;
+            entry.modified = state->storage->now;
+            state->storage->counts.close++;
+            state->storage->step();
+        }
+
+        time_t getLastWrite()
+        {
+            if (!_state)
+                return 0;
+            auto it = _state->storage->files.find(_state->path);
+            return it == _state->storage->files.end() ? 0 : it->second.modified;
+        }
+
+        const char *path() const { return _state ? _state->path.c_str() : ""; }
+        const char *name() const
+        {
+            if (!_state)
+                return "";
+            const char *slash = strrchr(_state->path.c_str(), '/');
+            return slash ? slash + 1 : _state->path.c_str();
+        }
+
+        bool isDirectory() const { return _state && _state->directory; }
+
+        File openNextFile(const char *mode = "r")
+        {
+            if (!isDirectory() || _state->next >= _state->children.size())
+                return File();
+            return File(_state->storage, _state->children[_state->next++], false, false);
+        }
+
+        void rewindDirectory()
+        {
+            if (_state)
+                _state->next = 0;
+        }
+
+    private:
+        struct State
+        {
+            std::shared_ptr<HostStorage> storage;
+            std::string path;
+            bool writing;
+            bool directory;
+            size_t position;
+            std::vector<uint8_t> data;
+            std::vector<std::string> children;
+            size_t next = 0;
+        };
+
+        std::shared_ptr<State> _state;
+    };
+
+    /**
+     * A filesystem, copies share the storage like the FS objects of the Arduino core share their implementation
+     */
+    class FS
+    {
+    public:
+        FS() : _storage(std::make_shared<HostStorage>()) {}
+
+        HostStorage &storage() { return *_storage; }
+
+        File open(const char *path, const char *mode = "r", const bool create = false)
+        {
+            HostStorage &storage = *_storage;
+            storage.counts.open++;
+            if (storage.off)
+                return File();
+
+            std::string name(path);
+            bool writing = mode[0] == 'w' || mode[0] == 'a' || strchr(mode, '+');
+            bool exists = storage.files.count(name) || storage.isDirectory(name);
+            if (!exists && !writing)
+            {
+                ESP_LOGE("vfs", "%s does not exist, no permits for creation", path);
+                return File();
+            }
+            if (writing && !storage.isDirectory(HostStorage::parent(name)))
+                return File();
+
+            // like LittleFS the new file is in the directory right away, its content only once it is closed
+            if (!exists)
+                storage.files[name].modified = storage.now;
+            return File(_storage, name, writing, mode[0] == 'a' || mode[0] == 'r', mode[0] == 'a');
+        }
+        File open(const String &path, const char *mode = "r", const bool create = false) { return open(path.c_str(), mode, create); }
+
+        bool exists(const char *path)
+        {
+            _storage->counts.exists++;
+            return _storage->files.count(path) || _storage->isDirectory(path);
+        }
+        bool exists(const String &path) { return exists(path.c_str()); }
+
+        bool remove(const char *path)
+        {
+            HostStorage &storage = *_storage;
+            storage.counts.remove++;
+            if (storage.off || !storage.files.erase(path))
+                return false;
+            storage.step();
+            return true;
+        }
+        bool remove(const String &path) { return remove(path.c_str()); }
+
+        // LittleFS replaces an existing file
+        bool rename(const char *pathFrom, const char *pathTo)
+        {
+            HostStorage &storage = *_storage;
+            storage.counts.rename++;
+            auto it = storage.files.find(pathFrom);
+            if (storage.off || it == storage.files.end() || !storage.isDirectory(HostStorage::parent(pathTo)))
+                return false;
+            HostStorage::Entry entry = it->second;
+            storage.files.erase(it);
+            storage.files[pathTo] = entry;
+            storage.step();
+            return true;
+        }
+        bool rename(const String &pathFrom, const String &pathTo) { return rename(pathFrom.c_str(), pathTo.c_str()); }
+
+        bool mkdir(const char *path)
+        {
+            HostStorage &storage = *_storage;
+            storage.counts.mkdir++;
+            if (storage.off || !storage.isDirectory(HostStorage::parent(path)))
+                return false;
+            storage.directories.insert(path);
+            return true;
+        }
+        bool mkdir(const String &path) { return mkdir(path.c_str()); }
+
+        bool rmdir(const char *path)
+        {
+            return !_storage->off && _storage->directories.erase(path) > 0;
+        }
+        bool rmdir(const String &path) { return rmdir(path.c_str()); }
+
+    private:
+        std::shared_ptr<HostStorage> _storage;
+    };
+}
+
+using fs::File;
+using fs::FS;
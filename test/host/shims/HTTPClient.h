@@ -0,0 +1,200 @@
+// Host shim of the Arduino HTTPClient on POSIX sockets, plain HTTP with Content-Length bodies only.
+// Error codes and the way writeToStream() reports a short body follow the ESP32 library.
+#pragma once
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <netdb.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_NO_HTTP_SERVER (-7)
+#define HTTPC_ERROR_STREAM_WRITE (-10)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+#define HTTP_CODE_OK 200
+#define HTTP_CODE_PARTIAL_CONTENT 206
+
+typedef enum
+{
+    HTTPC_DISABLE_FOLLOW_REDIRECTS,
+    HTTPC_STRICT_FOLLOW_REDIRECTS,
+    HTTPC_FORCE_FOLLOW_REDIRECTS
+} followRedirects_t;
+
+class HTTPClient
+{
+public:
+    ~HTTPClient() { end(); }
+
+    bool begin(WiFiClientSecure &client, const String &url)
+    {
+        std::string u = url.c_str();
+        if (u.compare(0, 7, "http://") != 0)
+            return false;
+        size_t slash = u.find('/', 7);
+        std::string host = u.substr(7, slash == std::string::npos ? std::string::npos : slash - 7);
+        _path = slash == std::string::npos ? "/" : u.substr(slash);
+        size_t colon = host.find(':');
+        _port = colon == std::string::npos ? "80" : host.substr(colon + 1);
+        _host = host.substr(0, colon);
+        return true;
+    }
+
+    void setFollowRedirects(followRedirects_t follow) {}
+    void setTimeout(uint16_t timeout) { _timeout = timeout; }
+    void setReuse(bool reuse) {}
+
+    void collectHeaders(const char *keys[], size_t count)
+    {
+        _collect.assign(keys, keys + count);
+    }
+
+    void addHeader(const String &name, const String &value)
+    {
+        _request += std::string(name.c_str()) + ": " + value.c_str() + "\r\n";
+    }
+
+    int GET()
+    {
+        addrinfo hints = {}, *address;
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(_host.c_str(), _port.c_str(), &hints, &address) != 0)
+            return HTTPC_ERROR_CONNECTION_REFUSED;
+        _socket = socket(address->ai_family, address->ai_socktype, 0);
+        bool connected = _socket >= 0 && connect(_socket, address->ai_addr, address->ai_addrlen) == 0;
+        freeaddrinfo(address);
+        if (!connected)
+            return HTTPC_ERROR_CONNECTION_REFUSED;
+
+        timeval timeout = {_timeout / 1000, (_timeout % 1000) * 1000};
+        setsockopt(_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        std::string request = "GET " + _path + " HTTP/1.1\r\nHost: " + _host + "\r\nConnection: close\r\n" + _request + "\r\n";
+        if (send(_socket, request.data(), request.size(), MSG_NOSIGNAL) != (ssize_t)request.size())
+            return HTTPC_ERROR_SEND_HEADER_FAILED;
+
+        // status line and headers, whatever follows them is the start of the body
+        std::string head;
+        size_t end;
+        while ((end = head.find("\r\n\r\n")) == std::string::npos)
+        {
+            char buffer[512];
+            ssize_t len = recv(_socket, buffer, sizeof(buffer), 0);
+            if (len <= 0)
+                return len < 0 ? HTTPC_ERROR_READ_TIMEOUT : HTTPC_ERROR_CONNECTION_LOST;
+            head.append(buffer, len);
+        }
+        _body = head.substr(end + 4);
+        head.resize(end);
+
+        if (head.compare(0, 5, "HTTP/") != 0 || head.find(' ') == std::string::npos)
+            return HTTPC_ERROR_NO_HTTP_SERVER;
+        int code = atoi(head.c_str() + head.find(' ') + 1);
+
+        size_t pos = head.find("\r\n");
+        while (pos != std::string::npos)
+        {
+            size_t next = head.find("\r\n", pos + 2);
+            std::string line = head.substr(pos + 2, next == std::string::npos ? std::string::npos : next - pos - 2);
+            size_t colon = line.find(':');
+            if (colon != std::string::npos)
+            {
+                std::string name = line.substr(0, colon);
+                std::string value = line.substr(line.find_first_not_of(' ', colon + 1));
+                if (strcasecmp(name.c_str(), "Content-Length") == 0)
+                    _size = atoi(value.c_str());
+                for (const char *key : _collect)
+                    if (strcasecmp(name.c_str(), key) == 0)
+                        _headers[key] = value;
+            }
+            pos = next;
+        }
+        return code;
+    }
+
+    int getSize() { return _size; }
+
+    String header(const char *name)
+    {
+        auto header = _headers.find(name);
+        return header == _headers.end() ? String() : String(header->second);
+    }
+
+    int writeToStream(Stream *stream)
+    {
+        int written = 0;
+        std::string block = _body;
+        while (_size < 0 || written < _size)
+        {
+            if (block.empty())
+            {
+                char buffer[1460];
+                ssize_t len = recv(_socket, buffer, sizeof(buffer), 0);
+                if (len <= 0)
+                    break;
+                block.assign(buffer, len);
+            }
+            if (_size >= 0 && written + (int)block.size() > _size)
+                block.resize(_size - written);
+            if (stream->write((const uint8_t *)block.data(), block.size()) != block.size())
+                return HTTPC_ERROR_STREAM_WRITE;
+            written += block.size();
+            block.clear();
+        }
+        // a body shorter than Content-Length
+        if (_size > 0 && written != _size)
+            return HTTPC_ERROR_STREAM_WRITE;
+        return written;
+    }
+
+    void end()
+    {
+        if (_socket >= 0)
+            close(_socket);
+        _socket = -1;
+    }
+
+    static String errorToString(int error)
+    {
+        switch (error)
+        {
+        case HTTPC_ERROR_CONNECTION_REFUSED:
+            return "connection refused";
+        case HTTPC_ERROR_SEND_HEADER_FAILED:
+            return "send header failed";
+        case HTTPC_ERROR_CONNECTION_LOST:
+            return "connection lost";
+        case HTTPC_ERROR_NO_HTTP_SERVER:
+            return "no HTTP server";
+        case HTTPC_ERROR_STREAM_WRITE:
+            return "Stream write error";
+        case HTTPC_ERROR_READ_TIMEOUT:
+            return "read Timeout";
+        default:
+            return String();
+        }
+    }
+
+private:
+    std::string _host;
+    std::string _port;
+    std::string _path;
+    std::string _request;
+    std::string _body;
+    std::vector<const char *> _collect;
+    std::map<std::string, std::string> _headers;
+    uint16_t _timeout = 5000;
+    int _socket = -1;
+    int _size = -1;
+};
@@ -0,0 +1,14 @@
+// Host shim of the Arduino MD5Builder, digest authentication is not tested on the host
+#pragma once
+
+#include <Arduino.h>
+
+class MD5Builder
+{
+public:
+    void begin() {}
+    void add(const String &data) {}
+    void add(const uint8_t *data, size_t len) {}
+    void calculate() {}
+    String toString() { return String(); }
+};
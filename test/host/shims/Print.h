@@ -0,0 +1,23 @@
+// Host shim of the Arduino Print class, writes end up in write(uint8_t) unless a class does better
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t n = 0;
+        while (n < size && write(buffer[n]))
+            n++;
+        return n;
+    }
+    virtual void flush() {}
+
+    size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+};
@@ -0,0 +1,4 @@
+// Host shim, only the log tag of the framework
+#pragma once
+
+#define SVK_TAG "SVK"
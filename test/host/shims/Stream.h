@@ -0,0 +1,4 @@
+// Host shim of the Arduino core Stream header, the class is in Arduino.h
+#pragma once
+
+#include <Arduino.h>
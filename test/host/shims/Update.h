@@ -0,0 +1,47 @@
+// Host shim of the Arduino Update library, collects what would go to the OTA partition
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+#define U_FLASH 0
+#define U_SPIFFS 100
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+
+class UpdateClass
+{
+public:
+    bool begin(size_t size, int command)
+    {
+        written.clear();
+        running = true;
+        return true;
+    }
+
+    void setMD5(const char *md5) {}
+
+    bool end(bool evenIfRemaining = false)
+    {
+        running = false;
+        return true;
+    }
+
+    void abort() { running = false; }
+
+    size_t write(uint8_t *data, size_t len)
+    {
+        if (failAfter >= 0 && written.size() + len > (size_t)failAfter)
+            return 0;
+        written.insert(written.end(), data, data + len);
+        return len;
+    }
+
+    const char *errorString() { return "Flash Write Failed"; }
+
+    std::vector<uint8_t> written;
+    bool running = false;
+    // writes beyond this many bytes fail, -1 never fails
+    long failAfter = -1;
+};
+
+inline UpdateClass Update;
@@ -0,0 +1,22 @@
+// Host shim of the UrlEncode library
+#pragma once
+
+#include <Arduino.h>
+
+inline String urlEncode(const String &text)
+{
+    String encoded;
+    for (size_t i = 0; i < text.length(); i++)
+    {
+        unsigned char c = text[i];
+        if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~')
+            encoded += (char)c;
+        else
+        {
+            char hex[4];
+            snprintf(hex, sizeof(hex), "%%%02X", c);
+            encoded += hex;
+        }
+    }
+    return encoded;
+}
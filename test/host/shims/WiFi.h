@@ -0,0 +1,16 @@
+// Host shim of the Arduino WiFi class, the addresses of the interfaces are set by the test
+#pragma once
+
+#include <Arduino.h>
+
+class WiFiClass
+{
+public:
+    IPAddress localIP() { return stationIP; }
+    IPAddress softAPIP() { return accessPointIP; }
+
+    IPAddress stationIP;
+    IPAddress accessPointIP;
+};
+
+inline WiFiClass WiFi;
@@ -0,0 +1,12 @@
+// Host shim, the download tests talk plain HTTP to a local stand-in
+#pragma once
+
+#include <Arduino.h>
+
+class WiFiClientSecure
+{
+public:
+    void setCACertBundle(const uint8_t *bundle, size_t size = 0) {}
+    void setInsecure() {}
+    void setTimeout(uint32_t timeout) {}
+};
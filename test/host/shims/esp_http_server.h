@@ -0,0 +1,366 @@
+// Host shim of the ESP-IDF HTTP server. A request is a HostRequest with its headers and body in
+// memory, the body is received in the chunk sizes a test asks for and the response is collected.
+#pragma once
+
+#include <Arduino.h>
+#include <strings.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum http_method
+{
+    HTTP_DELETE = 0,
+    HTTP_GET = 1,
+    HTTP_HEAD = 2,
+    HTTP_POST = 3,
+    HTTP_PUT = 4,
+    HTTP_OPTIONS = 6,
+    HTTP_PATCH = 28
+};
+
+inline const char *http_method_str(http_method method)
+{
+    switch (method)
+    {
+    case HTTP_DELETE:
+        return "DELETE";
+    case HTTP_GET:
+        return "GET";
+    case HTTP_HEAD:
+        return "HEAD";
+    case HTTP_POST:
+        return "POST";
+    case HTTP_PUT:
+        return "PUT";
+    case HTTP_OPTIONS:
+        return "OPTIONS";
+    default:
+        return "PATCH";
+    }
+}
+
+typedef void *httpd_handle_t;
+typedef struct httpd_req httpd_req_t;
+typedef void (*httpd_free_ctx_fn_t)(void *ctx);
+typedef esp_err_t (*httpd_open_func_t)(httpd_handle_t hd, int sockfd);
+typedef void (*httpd_close_func_t)(httpd_handle_t hd, int sockfd);
+typedef bool (*httpd_uri_match_func_t)(const char *reference_uri, const char *uri_to_match, size_t match_upto);
+
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_NOT_FOUND 0x105
+#define ESP_ERR_HTTPD_BASE 0xb000
+#define ESP_ERR_HTTPD_HANDLERS_FULL (ESP_ERR_HTTPD_BASE + 1)
+#define ESP_ERR_HTTPD_HANDLER_EXISTS (ESP_ERR_HTTPD_BASE + 2)
+#define ESP_ERR_HTTPD_INVALID_REQ (ESP_ERR_HTTPD_BASE + 3)
+#define ESP_ERR_HTTPD_RESULT_TRUNC (ESP_ERR_HTTPD_BASE + 4)
+#define ESP_ERR_HTTPD_RESP_HDR (ESP_ERR_HTTPD_BASE + 5)
+#define ESP_ERR_HTTPD_RESP_SEND (ESP_ERR_HTTPD_BASE + 6)
+
+#define HTTPD_SOCK_ERR_FAIL -1
+#define HTTPD_SOCK_ERR_INVALID -2
+#define HTTPD_SOCK_ERR_TIMEOUT -3
+
+#define HTTPD_MAX_URI_LEN 512
+
+typedef enum
+{
+    HTTPD_500_INTERNAL_SERVER_ERROR = 0,
+    HTTPD_501_METHOD_NOT_IMPLEMENTED,
+    HTTPD_505_VERSION_NOT_SUPPORTED,
+    HTTPD_400_BAD_REQUEST,
+    HTTPD_401_UNAUTHORIZED,
+    HTTPD_403_FORBIDDEN,
+    HTTPD_404_NOT_FOUND,
+    HTTPD_405_METHOD_NOT_ALLOWED,
+    HTTPD_408_REQ_TIMEOUT,
+    HTTPD_411_LENGTH_REQUIRED,
+    HTTPD_414_URI_TOO_LONG,
+    HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE,
+    HTTPD_ERR_CODE_MAX
+} httpd_err_code_t;
+
+typedef esp_err_t (*httpd_err_handler_func_t)(httpd_req_t *req, httpd_err_code_t error);
+
+typedef struct
+{
+    unsigned task_priority;
+    size_t stack_size;
+    int core_id;
+    uint16_t server_port;
+    uint16_t ctrl_port;
+    uint16_t max_open_sockets;
+    uint16_t max_uri_handlers;
+    uint16_t max_resp_headers;
+    uint16_t backlog_conn;
+    bool lru_purge_enable;
+    uint16_t recv_wait_timeout;
+    uint16_t send_wait_timeout;
+    void *global_user_ctx;
+    httpd_free_ctx_fn_t global_user_ctx_free_fn;
+    void *global_transport_ctx;
+    httpd_free_ctx_fn_t global_transport_ctx_free_fn;
+    bool enable_so_linger;
+    int linger_timeout;
+    bool keep_alive_enable;
+    httpd_open_func_t open_fn;
+    httpd_close_func_t close_fn;
+    httpd_uri_match_func_t uri_match_fn;
+} httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG() httpd_config_t{5, 4096, 0x7fffffff, 80, 32768, 7, 8, 8, 5, false, 5, 5}
+
+typedef enum
+{
+    HTTPD_WS_TYPE_CONTINUE = 0x0,
+    HTTPD_WS_TYPE_TEXT = 0x1,
+    HTTPD_WS_TYPE_BINARY = 0x2,
+    HTTPD_WS_TYPE_CLOSE = 0x8,
+    HTTPD_WS_TYPE_PING = 0x9,
+    HTTPD_WS_TYPE_PONG = 0xA
+} httpd_ws_type_t;
+
+typedef struct httpd_ws_frame
+{
+    bool final;
+    bool fragmented;
+    httpd_ws_type_t type;
+    uint8_t *payload;
+    size_t len;
+} httpd_ws_frame_t;
+
+typedef struct httpd_uri
+{
+    const char *uri;
+    http_method method;
+    esp_err_t (*handler)(httpd_req_t *r);
+    void *user_ctx;
+    bool is_websocket;
+    bool handle_ws_control_frames;
+    const char *supported_subprotocol;
+} httpd_uri_t;
+
+struct httpd_req
+{
+    httpd_handle_t handle;
+    int method;
+    char uri[HTTPD_MAX_URI_LEN + 1];
+    size_t content_len;
+    void *aux;
+    void *user_ctx;
+    void *sess_ctx;
+    httpd_free_ctx_fn_t free_ctx;
+    bool ignore_sess_ctx_changes;
+};
+
+/**
+ * A request as httpd hands it to a handler, with what the handler sent back
+ */
+struct HostRequest : httpd_req
+{
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+    size_t received = 0;
+    std::vector<size_t> chunks; // sizes httpd_req_recv() returns in turn, repeated, everything at once if empty
+    size_t chunk = 0;
+    int socket = 54;
+
+    std::string status = "200 OK";
+    std::string contentType = "text/html";
+    std::vector<std::pair<std::string, std::string>> responseHeaders;
+    std::string response;
+    bool chunked = false;
+    bool finished = false;
+
+    HostRequest(http_method method, const char *path, const std::string &content = std::string()) : httpd_req(), body(content)
+    {
+        this->method = method;
+        strlcpy(uri, path, sizeof(uri));
+        content_len = content.size();
+    }
+
+    ~HostRequest()
+    {
+        if (sess_ctx && free_ctx)
+            free_ctx(sess_ctx);
+    }
+
+    void header(const char *field, const std::string &value) { headers.emplace_back(field, value); }
+
+    const std::string *find(const char *field) const
+    {
+        for (const auto &header : headers)
+            if (strcasecmp(header.first.c_str(), field) == 0)
+                return &header.second;
+        return NULL;
+    }
+};
+
+inline HostRequest *hostRequest(httpd_req_t *req) { return static_cast<HostRequest *>(req); }
+
+inline size_t httpd_req_get_hdr_value_len(httpd_req_t *req, const char *field)
+{
+    const std::string *value = hostRequest(req)->find(field);
+    return value ? value->size() : 0;
+}
+
+inline esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *req, const char *field, char *val, size_t val_size)
+{
+    const std::string *value = hostRequest(req)->find(field);
+    if (value == NULL)
+        return ESP_ERR_NOT_FOUND;
+    strlcpy(val, value->c_str(), val_size);
+    return value->size() < val_size ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+
+inline size_t httpd_req_get_url_query_len(httpd_req_t *req)
+{
+    const char *query = strchr(req->uri, '?');
+    return query ? strlen(query + 1) : 0;
+}
+
+inline esp_err_t httpd_req_get_url_query_str(httpd_req_t *req, char *buf, size_t buf_len)
+{
+    const char *query = strchr(req->uri, '?');
+    if (query == NULL)
+        return ESP_ERR_NOT_FOUND;
+    strlcpy(buf, query + 1, buf_len);
+    return strlen(query + 1) < buf_len ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+
+inline esp_err_t httpd_req_get_cookie_val(httpd_req_t *req, const char *cookie_name, char *val, size_t *val_size)
+{
+    const std::string *cookies = hostRequest(req)->find("Cookie");
+    if (cookies == NULL)
+        return ESP_ERR_NOT_FOUND;
+    std::string prefix = std::string(cookie_name) + "=";
+    size_t pos = 0;
+    while (pos < cookies->size())
+    {
+        while (pos < cookies->size() && (*cookies)[pos] == ' ')
+            pos++;
+        size_t end = cookies->find(';', pos);
+        if (end == std::string::npos)
+            end = cookies->size();
+        if (cookies->compare(pos, prefix.size(), prefix) == 0)
+        {
+            std::string value = cookies->substr(pos + prefix.size(), end - pos - prefix.size());
+            strlcpy(val, value.c_str(), *val_size);
+            bool fits = value.size() < *val_size;
+            *val_size = value.size() + 1;
+            return fits ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+        }
+        pos = end + 1;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+inline int httpd_req_recv(httpd_req_t *req, char *buf, size_t buf_len)
+{
+    HostRequest *host = hostRequest(req);
+    size_t len = min(buf_len, host->body.size() - host->received);
+    if (!host->chunks.empty())
+        len = min(len, host->chunks[host->chunk++ % host->chunks.size()]);
+    memcpy(buf, host->body.data() + host->received, len);
+    host->received += len;
+    return (int)len;
+}
+
+inline int httpd_req_to_sockfd(httpd_req_t *req) { return hostRequest(req)->socket; }
+
+inline esp_err_t httpd_resp_set_status(httpd_req_t *req, const char *status)
+{
+    hostRequest(req)->status = status;
+    return ESP_OK;
+}
+
+inline esp_err_t httpd_resp_set_type(httpd_req_t *req, const char *type)
+{
+    hostRequest(req)->contentType = type;
+    return ESP_OK;
+}
+
+inline esp_err_t httpd_resp_set_hdr(httpd_req_t *req, const char *field, const char *value)
+{
+    hostRequest(req)->responseHeaders.emplace_back(field, value);
+    return ESP_OK;
+}
+
+inline esp_err_t httpd_resp_send(httpd_req_t *req, const char *buf, ssize_t buf_len)
+{
+    HostRequest *host = hostRequest(req);
+    if (buf)
+        host->response.append(buf, buf_len < 0 ? strlen(buf) : buf_len);
+    host->finished = true;
+    return ESP_OK;
+}
+
+inline esp_err_t httpd_resp_send_chunk(httpd_req_t *req, const char *buf, ssize_t buf_len)
+{
+    HostRequest *host = hostRequest(req);
+    host->chunked = true;
+    if (buf == NULL || buf_len == 0)
+        host->finished = true;
+    else
+        host->response.append(buf, buf_len < 0 ? strlen(buf) : buf_len);
+    return ESP_OK;
+}
+
+inline esp_err_t httpd_resp_sendstr_chunk(httpd_req_t *req, const char *str)
+{
+    return httpd_resp_send_chunk(req, str, str ? strlen(str) : 0);
+}
+
+inline esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg)
+{
+    static const char *statuses[] = {"500 Internal Server Error", "501 Method Not Implemented", "505 Version Not Supported",
+                                     "400 Bad Request", "401 Unauthorized", "403 Forbidden", "404 Not Found",
+                                     "405 Method Not Allowed", "408 Request Timeout", "411 Length Required",
+                                     "414 URI Too Long", "431 Request Header Fields Too Large"};
+    HostRequest *host = hostRequest(req);
+    host->status = statuses[error];
+    return httpd_resp_send(req, msg, -1);
+}
+
+// raw bytes on the socket of a request, like the event source headers
+inline int httpd_send(httpd_req_t *req, const char *buf, size_t buf_len)
+{
+    hostRequest(req)->response.append(buf, buf_len);
+    return (int)buf_len;
+}
+
+inline int httpd_socket_send(httpd_handle_t hd, int sockfd, const char *buf, size_t buf_len, int flags) { return (int)buf_len; }
+
+// WebSocket frames are not tested on the host
+inline esp_err_t httpd_ws_send_frame(httpd_req_t *req, httpd_ws_frame_t *frame) { return ESP_OK; }
+inline esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame) { return ESP_OK; }
+inline esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *frame, size_t max_len) { return ESP_FAIL; }
+inline esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd) { return ESP_OK; }
+
+// the server handle is the config it was started with
+inline esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+    *handle = (httpd_handle_t) new httpd_config_t(*config);
+    return ESP_OK;
+}
+
+inline esp_err_t httpd_stop(httpd_handle_t handle)
+{
+    delete (httpd_config_t *)handle;
+    return ESP_OK;
+}
+
+inline void *httpd_get_global_user_ctx(httpd_handle_t handle) { return ((httpd_config_t *)handle)->global_user_ctx; }
+inline esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler) { return ESP_OK; }
+inline esp_err_t httpd_unregister_uri_handler(httpd_handle_t handle, const char *uri, http_method method) { return ESP_OK; }
+inline esp_err_t httpd_register_err_handler(httpd_handle_t handle, httpd_err_code_t error, httpd_err_handler_func_t handler) { return ESP_OK; }
+
+// httpd_uri_match_wildcard() without the optional character, the baseline for the router benchmark
+inline bool httpd_uri_match_wildcard(const char *tpl, const char *uri, size_t len)
+{
+    size_t tpl_len = strlen(tpl);
+    if (tpl_len > 0 && tpl[tpl_len - 1] == '*')
+        return len >= tpl_len - 1 && strncmp(tpl, uri, tpl_len - 1) == 0;
+    return len == tpl_len && strncmp(tpl, uri, len) == 0;
+}
@@ -0,0 +1,11 @@
+// Host shim of the IDF OTA API, the test sets up the running partition
+#pragma once
+
+#include <esp_partition.h>
+
+inline esp_partition_t runningPartition = {0, {}};
+
+inline const esp_partition_t *esp_ota_get_running_partition()
+{
+    return &runningPartition;
+}
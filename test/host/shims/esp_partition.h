@@ -0,0 +1,21 @@
+// Host shim of the IDF partition API, partitions are buffers in memory
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+#define ESP_ERR_INVALID_SIZE 0x104
+
+typedef struct
+{
+    uint32_t size;
+    std::vector<uint8_t> data;
+} esp_partition_t;
+
+inline esp_err_t esp_partition_read(const esp_partition_t *partition, size_t offset, void *dst, size_t size)
+{
+    if (offset + size > partition->size || offset + size > partition->data.size())
+        return ESP_ERR_INVALID_SIZE;
+    memcpy(dst, partition->data.data() + offset, size);
+    return ESP_OK;
+}
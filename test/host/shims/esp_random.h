@@ -0,0 +1,11 @@
+// Host shim of the hardware random number generator
+#pragma once
+
+#include <cstdint>
+#include <random>
+
+inline uint32_t esp_random()
+{
+    static std::mt19937 random(1);
+    return random();
+}
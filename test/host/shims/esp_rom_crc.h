@@ -0,0 +1,10 @@
+// Host shim of the ROM CRC functions on top of zlib
+#pragma once
+
+#include <cstdint>
+#include <zlib.h>
+
+inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    return crc32(crc, buf, len);
+}
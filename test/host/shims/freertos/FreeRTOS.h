@@ -0,0 +1,155 @@
+// Host shim of the FreeRTOS queues, semaphores and tasks the framework uses, on top of std::thread
+#pragma once
+
+#include <Arduino.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void (*TaskFunction_t)(void *);
+typedef void *TaskHandle_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define portMAX_DELAY 0xffffffffUL
+#define tskIDLE_PRIORITY 0
+#define tskNO_AFFINITY 0x7fffffff
+#define configMAX_PRIORITIES 25
+#define portTICK_PERIOD_MS 1
+
+struct HostQueue
+{
+    std::mutex lock;
+    std::condition_variable changed;
+    std::deque<std::vector<uint8_t>> items;
+    size_t length;
+    size_t itemSize;
+
+    // the task holding a recursive mutex and how often it took it
+    std::atomic<std::thread::id> holder{};
+    std::atomic<int> depth{0};
+};
+
+typedef HostQueue *QueueHandle_t;
+typedef HostQueue *SemaphoreHandle_t;
+
+inline QueueHandle_t xQueueCreate(size_t length, size_t itemSize)
+{
+    QueueHandle_t queue = new HostQueue();
+    queue->length = length;
+    queue->itemSize = itemSize;
+    return queue;
+}
+
+inline void vQueueDelete(QueueHandle_t queue)
+{
+    delete queue;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait)
+{
+    std::unique_lock<std::mutex> lock(queue->lock);
+    if (queue->items.size() >= queue->length)
+    {
+        if (wait == 0)
+            return pdFALSE;
+        queue->changed.wait(lock, [queue] { return queue->items.size() < queue->length; });
+    }
+    const uint8_t *bytes = (const uint8_t *)item;
+    queue->items.emplace_back(bytes, bytes + queue->itemSize);
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait)
+{
+    std::unique_lock<std::mutex> lock(queue->lock);
+    if (queue->items.empty())
+    {
+        if (wait == 0)
+            return pdFALSE;
+        queue->changed.wait(lock, [queue] { return !queue->items.empty(); });
+    }
+    if (queue->itemSize)
+        memcpy(item, queue->items.front().data(), queue->itemSize);
+    queue->items.pop_front();
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    return xQueueCreate(1, 0);
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    return xQueueSend(semaphore, NULL, 0);
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t wait)
+{
+    return xQueueReceive(semaphore, NULL, wait);
+}
+
+inline void vSemaphoreDelete(SemaphoreHandle_t semaphore)
+{
+    vQueueDelete(semaphore);
+}
+
+// what a task handle points to, the notifications of freertos/task.h
+struct HostTask
+{
+    std::mutex lock;
+    std::condition_variable notified;
+    uint32_t notifications = 0;
+};
+
+inline thread_local HostTask *hostCurrentTask = NULL;
+
+// tasks are detached threads, their state lives as long as the test
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackSize, void *parameter,
+                                          UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    HostTask *state = new HostTask();
+    std::thread task([state, function, parameter]() {
+        hostCurrentTask = state;
+        function(parameter);
+    });
+    if (handle)
+        *handle = state;
+    task.detach();
+    return pdPASS;
+}
+
+// a task ends by returning from its function on the host
+inline void vTaskDelete(TaskHandle_t task) {}
+
+inline void vTaskDelay(TickType_t ticks)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+inline void vTaskPrioritySet(TaskHandle_t task, UBaseType_t priority) {}
+
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    return 0;
+}
+
+// critical sections only keep other tasks out on the host, there are no interrupts
+struct portMUX_TYPE
+{
+    std::mutex lock;
+};
+
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portMUX_INITIALIZE(mux)
+#define taskENTER_CRITICAL(mux) (mux)->lock.lock()
+#define taskEXIT_CRITICAL(mux) (mux)->lock.unlock()
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+
+// a mutex is a binary semaphore that starts out given, without priority inheritance on the host
+inline SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    SemaphoreHandle_t mutex = xSemaphoreCreateBinary();
+    xSemaphoreGive(mutex);
+    return mutex;
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex()
+{
+    return xSemaphoreCreateMutex();
+}
+
+// only the holder changes holder and depth once the mutex is taken
+inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, TickType_t wait)
+{
+    if (mutex->depth > 0 && mutex->holder == std::this_thread::get_id())
+    {
+        mutex->depth++;
+        return pdTRUE;
+    }
+    if (!xSemaphoreTake(mutex, wait))
+        return pdFALSE;
+    mutex->holder = std::this_thread::get_id();
+    mutex->depth = 1;
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex)
+{
+    if (--mutex->depth > 0)
+        return pdTRUE;
+    mutex->holder = std::thread::id();
+    return xSemaphoreGive(mutex);
+}
@@ -0,0 +1,29 @@
+// Host shim of the FreeRTOS task notifications, a counting notification per task
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+inline void xTaskNotifyGive(TaskHandle_t task)
+{
+    HostTask *state = (HostTask *)task;
+    std::lock_guard<std::mutex> lock(state->lock);
+    state->notifications++;
+    state->notified.notify_all();
+}
+
+// the timeout runs on millis(), a test that stopped the clock wakes the task by moving it on
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks)
+{
+    HostTask *state = hostCurrentTask;
+    uint32_t start = millis();
+    std::unique_lock<std::mutex> lock(state->lock);
+    while (state->notifications == 0 && (ticks == portMAX_DELAY || millis() - start < ticks))
+        state->notified.wait_for(lock, std::chrono::milliseconds(1));
+
+    uint32_t count = state->notifications;
+    if (count)
+        state->notifications = clearOnExit ? 0 : count - 1;
+    return count;
+}
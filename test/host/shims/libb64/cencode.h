@@ -0,0 +1,28 @@
+// Host shim of the base64 encoder in the Arduino core
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#define base64_encode_expected_len(n) ((((4 * (n)) / 3) + 3) & ~3)
+
+inline int base64_encode_chars(const char *plaintext_in, int length_in, char *code_out)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const uint8_t *in = (const uint8_t *)plaintext_in;
+    int out = 0;
+    for (int i = 0; i < length_in; i += 3)
+    {
+        uint32_t block = in[i] << 16;
+        if (i + 1 < length_in)
+            block |= in[i + 1] << 8;
+        if (i + 2 < length_in)
+            block |= in[i + 2];
+        code_out[out++] = alphabet[block >> 18 & 63];
+        code_out[out++] = alphabet[block >> 12 & 63];
+        code_out[out++] = i + 1 < length_in ? alphabet[block >> 6 & 63] : '=';
+        code_out[out++] = i + 2 < length_in ? alphabet[block & 63] : '=';
+    }
+    code_out[out] = 0;
+    return out;
+}
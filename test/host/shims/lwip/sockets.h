@@ -0,0 +1,125 @@
+// Host shim of lwIP, its sockets are numbered from LWIP_SOCKET_OFFSET on like on the ESP32.
+// The address types have the lwIP layout, the addresses of a socket are set by the test.
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <unistd.h>
+
+#define LWIP_SOCKET_OFFSET 54
+
+#define AF_INET 2
+#define AF_INET6 10
+#define INET_ADDRSTRLEN 16
+#define INET6_ADDRSTRLEN 46
+
+typedef uint8_t sa_family_t;
+typedef uint16_t in_port_t;
+typedef uint32_t socklen_t;
+
+struct in_addr
+{
+    uint32_t s_addr;
+};
+
+struct in6_addr
+{
+    union
+    {
+        uint32_t u32_addr[4];
+        uint8_t u8_addr[16];
+    } un;
+};
+
+struct sockaddr
+{
+    uint8_t sa_len;
+    sa_family_t sa_family;
+    char sa_data[14];
+};
+
+struct sockaddr_in
+{
+    uint8_t sin_len;
+    sa_family_t sin_family;
+    in_port_t sin_port;
+    struct in_addr sin_addr;
+    char sin_zero[8];
+};
+
+struct sockaddr_in6
+{
+    uint8_t sin6_len;
+    sa_family_t sin6_family;
+    in_port_t sin6_port;
+    uint32_t sin6_flowinfo;
+    struct in6_addr sin6_addr;
+    uint32_t sin6_scope_id;
+};
+
+struct sockaddr_storage
+{
+    uint8_t s2_len;
+    sa_family_t ss_family;
+    char s2_data1[2];
+    uint32_t s2_data2[3];
+    uint32_t s2_data3[3];
+};
+
+// the local and the peer address of each socket
+struct HostSocket
+{
+    sockaddr_storage local;
+    sockaddr_storage peer;
+};
+
+inline std::map<int, HostSocket> hostSockets;
+
+// an IPv4 peer as httpd sees it with IPv6 enabled, ::ffff:a.b.c.d
+inline sockaddr_storage hostAddress6(uint32_t ipv4)
+{
+    sockaddr_storage storage = {};
+    sockaddr_in6 *address = (sockaddr_in6 *)&storage;
+    address->sin6_len = sizeof(sockaddr_in6);
+    address->sin6_family = AF_INET6;
+    address->sin6_addr.un.u32_addr[2] = 0xffff0000;
+    address->sin6_addr.un.u32_addr[3] = ipv4;
+    return storage;
+}
+
+// an IPv4 peer of a stack without IPv6
+inline sockaddr_storage hostAddress4(uint32_t ipv4)
+{
+    sockaddr_storage storage = {};
+    sockaddr_in *address = (sockaddr_in *)&storage;
+    address->sin_len = sizeof(sockaddr_in);
+    address->sin_family = AF_INET;
+    address->sin_addr.s_addr = ipv4;
+    return storage;
+}
+
+inline int hostSocketAddress(int s, const sockaddr_storage HostSocket::*which, struct sockaddr *name, socklen_t *namelen)
+{
+    auto it = hostSockets.find(s);
+    if (it == hostSockets.end())
+        return -1;
+    const sockaddr_storage &address = it->second.*which;
+    socklen_t len = address.ss_family == AF_INET ? sizeof(sockaddr_in) : sizeof(sockaddr_in6);
+    memcpy(name, &address, *namelen < len ? *namelen : len);
+    *namelen = len;
+    return 0;
+}
+
+inline int getsockname(int s, struct sockaddr *name, socklen_t *namelen) { return hostSocketAddress(s, &HostSocket::local, name, namelen); }
+inline int getpeername(int s, struct sockaddr *name, socklen_t *namelen) { return hostSocketAddress(s, &HostSocket::peer, name, namelen); }
+
+inline const char *inet_ntop(int af, const void *src, char *dst, socklen_t size)
+{
+    if (af != AF_INET)
+        return NULL;
+    const uint8_t *bytes = (const uint8_t *)src;
+    snprintf(dst, size, "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+    return dst;
+}
@@ -0,0 +1,83 @@
+// Host shim of NVS, an in-memory namespace of blobs. A test can count the calls and clear the store.
+#pragma once
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#define ESP_ERR_NVS_BASE 0x1100
+#define ESP_ERR_NVS_NOT_FOUND (ESP_ERR_NVS_BASE + 0x02)
+#define ESP_ERR_NVS_INVALID_LENGTH (ESP_ERR_NVS_BASE + 0x0c)
+#define NVS_KEY_NAME_MAX_SIZE 16
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum
+{
+    NVS_READONLY,
+    NVS_READWRITE
+} nvs_open_mode_t;
+
+struct HostNvs
+{
+    std::map<std::string, std::map<std::string, std::vector<uint8_t>>> namespaces;
+    std::vector<std::string> handles;
+
+    struct
+    {
+        unsigned open, get, set, commit;
+    } counts = {};
+};
+
+inline HostNvs hostNvs;
+
+inline esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle)
+{
+    hostNvs.counts.open++;
+    if (mode == NVS_READONLY && !hostNvs.namespaces.count(name))
+        return ESP_ERR_NVS_NOT_FOUND;
+    hostNvs.namespaces[name];
+    hostNvs.handles.push_back(name);
+    *handle = hostNvs.handles.size();
+    return ESP_OK;
+}
+
+inline void nvs_close(nvs_handle_t handle) {}
+
+inline esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    hostNvs.counts.set++;
+    const uint8_t *bytes = (const uint8_t *)value;
+    hostNvs.namespaces[hostNvs.handles[handle - 1]][key].assign(bytes, bytes + length);
+    return ESP_OK;
+}
+
+inline esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    hostNvs.counts.get++;
+    auto &blobs = hostNvs.namespaces[hostNvs.handles[handle - 1]];
+    auto it = blobs.find(key);
+    if (it == blobs.end())
+        return ESP_ERR_NVS_NOT_FOUND;
+    if (out_value != NULL)
+    {
+        if (*length < it->second.size())
+            return ESP_ERR_NVS_INVALID_LENGTH;
+        memcpy(out_value, it->second.data(), it->second.size());
+    }
+    *length = it->second.size();
+    return ESP_OK;
+}
+
+inline esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    hostNvs.counts.commit++;
+    return ESP_OK;
+}
+
+inline esp_err_t nvs_erase_all(nvs_handle_t handle)
+{
+    hostNvs.namespaces[hostNvs.handles[handle - 1]].clear();
+    return ESP_OK;
+}
@@ -0,0 +1,61 @@
+// Host shim of the tinfl inflater in ROM on top of zlib raw inflate.
+// zlib keeps its own window, the wrapping output buffer is only filled like tinfl does.
+#pragma once
+
+#include <cstring>
+#include <zlib.h>
+
+#define TINFL_LZ_DICT_SIZE 32768
+#define TINFL_FLAG_HAS_MORE_INPUT 2
+
+typedef enum
+{
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+
+// the decompressor is malloc'ed and freed by the caller without a destructor,
+// so the zlib state of the last stream is leaked, which is fine for a test
+typedef struct
+{
+    z_stream stream;
+    bool done;
+} tinfl_decompressor;
+
+inline void tinfl_init(tinfl_decompressor *decomp)
+{
+    memset(decomp, 0, sizeof(*decomp));
+    inflateInit2(&decomp->stream, -15);
+}
+
+inline tinfl_status tinfl_decompress(tinfl_decompressor *decomp, const uint8_t *in, size_t *inSize,
+                                     uint8_t *outStart, uint8_t *outNext, size_t *outSize, int flags)
+{
+    (void)outStart;
+    (void)flags;
+    if (decomp->done)
+    {
+        *inSize = *outSize = 0;
+        return TINFL_STATUS_DONE;
+    }
+
+    z_stream &s = decomp->stream;
+    s.next_in = (Bytef *)in;
+    s.avail_in = *inSize;
+    s.next_out = outNext;
+    s.avail_out = *outSize;
+    int result = inflate(&s, Z_NO_FLUSH);
+    *inSize -= s.avail_in;
+    *outSize -= s.avail_out;
+
+    if (result == Z_STREAM_END)
+    {
+        decomp->done = true;
+        return TINFL_STATUS_DONE;
+    }
+    if (result != Z_OK && result != Z_BUF_ERROR)
+        return TINFL_STATUS_FAILED;
+    return s.avail_out == 0 ? TINFL_STATUS_HAS_MORE_OUTPUT : TINFL_STATUS_NEEDS_MORE_INPUT;
+}
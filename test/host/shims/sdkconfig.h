@@ -0,0 +1,4 @@
+// Host shim of the generated IDF configuration, the tests build for a plain ESP32
+#pragma once
+
+#define CONFIG_IDF_TARGET_ESP32 1
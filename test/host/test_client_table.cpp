@@ -0,0 +1,90 @@
+/**
+ * Client lookup by socket in the table against the list walks it replaces, with 16 open sockets.
+ * Also checks that a late close of a reused socket keeps the new client.
+ */
+
+#include "harness.h"
+#include <PsychicClient.h>
+#include <list>
+#include <vector>
+
+PsychicClient::PsychicClient(httpd_handle_t server, int socket) : _server(server), _socket(socket), _friend(NULL) {}
+PsychicClient::~PsychicClient() {}
+int PsychicClient::socket() { return _socket; }
+
+// what PsychicHttpServer::getClient() and PsychicHandler::getClient() did before
+static PsychicClient *listFind(std::list<PsychicClient *> &clients, int socket)
+{
+    for (PsychicClient *client : clients)
+        if (client->socket() == socket)
+            return client;
+    return NULL;
+}
+
+int main()
+{
+    const int sockets = 16;
+    std::list<PsychicClient *> serverList, handlerList;
+    PsychicClientTable serverTable, handlerTable;
+    std::vector<PsychicClient *> clients;
+
+    for (int i = 0; i < sockets; i++)
+    {
+        PsychicClient *client = new PsychicClient(NULL, LWIP_SOCKET_OFFSET + i);
+        clients.push_back(client);
+        serverList.push_back(client);
+        handlerList.push_back(client);
+        serverTable.set(client->socket(), client);
+        handlerTable.set(client->socket(), client);
+    }
+
+    const size_t rounds = 200000;
+    size_t found = 0;
+
+    // a handler lookup: its own clients, then whether the server still has the same one
+    uint32_t start = micros();
+    for (size_t round = 0; round < rounds; round++)
+        for (int i = 0; i < sockets; i++)
+        {
+            int socket = LWIP_SOCKET_OFFSET + (i * 7) % sockets;
+            PsychicClient *client = listFind(handlerList, socket);
+            found += client != NULL && listFind(serverList, socket) != NULL;
+        }
+    uint32_t listTime = micros() - start;
+
+    start = micros();
+    for (size_t round = 0; round < rounds; round++)
+        for (int i = 0; i < sockets; i++)
+        {
+            int socket = LWIP_SOCKET_OFFSET + (i * 7) % sockets;
+            PsychicClient *client = handlerTable.get(socket);
+            found += client != NULL && serverTable.get(socket) == client;
+        }
+    uint32_t tableTime = micros() - start;
+
+    CHECK(found == 2 * rounds * sockets);
+
+    size_t lookups = rounds * sockets;
+    printf("%d sockets, %u lookups: list walk %.1f ns, table %.1f ns per lookup\n",
+           sockets, (unsigned)lookups, listTime * 1000.0 / lookups, tableTime * 1000.0 / lookups);
+
+    // the socket of clients[3] is reused before its close comes through
+    int reused = clients[3]->socket();
+    PsychicClient *successor = new PsychicClient(NULL, reused);
+    serverTable.set(reused, successor);
+    serverTable.remove(reused, clients[3]);
+    CHECK(serverTable.get(reused) == successor);
+    serverTable.remove(reused, successor);
+    CHECK(serverTable.get(reused) == NULL);
+
+    // out of range or unknown sockets are ignored
+    serverTable.remove(LWIP_SOCKET_OFFSET + 1000, NULL);
+    serverTable.remove(LWIP_SOCKET_OFFSET - 1, clients[0]);
+    CHECK(serverTable.get(LWIP_SOCKET_OFFSET - 1) == NULL);
+
+    delete successor;
+    for (PsychicClient *client : clients)
+        delete client;
+
+    return finish();
+}
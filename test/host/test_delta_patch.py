@@ -0,0 +1,169 @@
+"""
+Delta OTA patches from scripts/delta_patch.py, created and applied in Python and
+applied by FirmwareWriter's BSDIFF43 reader in build/test_firmware_writer. The
+patches are fetched from the local stand-in with disconnects injected first.
+Every result is compared byte for byte with the new image.
+
+    python3 test_delta_patch.py [build directory]
+"""
+
+import os
+import random
+import subprocess
+import sys
+import tempfile
+import urllib.error
+import urllib.request
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, "..", "..", "scripts"))
+
+import delta_patch  # noqa: E402
+import ota_server  # noqa: E402
+
+BUILD = sys.argv[1] if len(sys.argv) > 1 else os.path.join(HERE, "build")
+READER = os.path.join(BUILD, "test_firmware_writer")
+
+failures = 0
+
+
+def check(condition, what):
+    global failures
+    if not condition:
+        print("check failed: " + what, file=sys.stderr)
+        failures += 1
+
+
+def firmware(size, seed):
+    """ Random code with some repeating tables, starting with an ESP32 image header """
+    rnd = random.Random(seed)
+    data = bytearray(rnd.getrandbits(8) for _ in range(size))
+    for table in range(0, size - 256, 4096):
+        data[table:table + 256] = bytes(range(256))
+    data[0] = 0xE9
+    data[12] = 0  # ESP32
+    return bytes(data)
+
+
+def relink(data, seed, changes):
+    """ What a small source change does: a few edits and shifted addresses """
+    rnd = random.Random(seed)
+    data = bytearray(data)
+    for _ in range(changes):
+        pos = rnd.randrange(16, len(data) - 16)
+        data[pos] = (data[pos] + rnd.randrange(1, 255)) & 0xFF
+    for i in range(1024, len(data) - 4, 997):
+        data[i] = (data[i] + 4) & 0xFF
+    return bytes(data)
+
+
+def download(url, retries=8):
+    """ Resumes like DownloadFirmwareService: Range and If-Range after a cut connection """
+    data = b""
+    etag = None
+    for _ in range(retries):
+        request = urllib.request.Request(url)
+        if data:
+            request.add_header("Range", "bytes={}-".format(len(data)))
+            request.add_header("If-Range", etag)
+        try:
+            with urllib.request.urlopen(request) as response:
+                if response.status == 200:
+                    data = b""
+                etag = response.headers["ETag"]
+                total = len(data) + int(response.headers["Content-Length"])
+                while len(data) < total:
+                    chunk = response.read(1024)
+                    if not chunk:
+                        break
+                    data += chunk
+                if len(data) == total:
+                    return data
+        except (urllib.error.URLError, ConnectionError, OSError):
+            pass
+    raise RuntimeError("download of {} failed".format(url))
+
+
+def reader(old, patch, workdir):
+    """ Runs the patch through FirmwareWriter, returns the new image or None if it was refused """
+    paths = [os.path.join(workdir, name) for name in ("old.bin", "firmware.patch", "new.bin")]
+    for path, data in zip(paths, (old, patch)):
+        with open(path, "wb") as f:
+            f.write(data)
+    if os.path.exists(paths[2]):
+        os.remove(paths[2])
+    result = subprocess.run([READER] + paths, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    if result.returncode != 0:
+        return None
+    with open(paths[2], "rb") as f:
+        return f.read()
+
+
+def main():
+    old = firmware(48 * 1024, 1)
+    inserted = old[:20000] + bytes(range(200)) * 3 + old[20000:]
+    cases = {
+        "identical": old,
+        "few changes": relink(old, 2, 12),
+        "insertion": relink(inserted, 3, 4),
+        "deletion": old[:10000] + old[14000:],
+        "larger": old + firmware(20 * 1024, 4),
+        "smaller": old[:30000],
+        "unrelated": firmware(40 * 1024, 5),
+    }
+
+    with tempfile.TemporaryDirectory() as workdir:
+        server = ota_server.start(workdir, drop_after=64, drops=2)
+        url = "http://127.0.0.1:{}/firmware.patch".format(server.server_port)
+
+        for name, new in cases.items():
+            patch = delta_patch.create_patch(old, new)
+            check(delta_patch.apply_patch(old, patch) == new, name + ": Python round trip")
+
+            with open(os.path.join(workdir, "firmware.patch"), "wb") as f:
+                f.write(patch)
+            server.config["drops"] = 2
+            served = download(url)
+            check(served == patch and server.config["drops"] < 2, name + ": patch from the stand-in")
+            check(reader(old, served, workdir) == new, name + ": FirmwareWriter result")
+            print("{:12} {:6} bytes, patch {:6} bytes".format(name, len(new), len(patch)))
+
+        new = cases["few changes"]
+        patch = delta_patch.create_patch(old, new)
+        stream = bytearray(delta_patch.gzip.decompress(patch))
+
+        def repack(data):
+            return delta_patch.gzip.compress(bytes(data), mtime=0)
+
+        # the reader refuses what it can't apply
+        check(reader(old, patch[:len(patch) // 2], workdir) is None, "truncated patch")
+        check(reader(old, b"not a patch at all", workdir) is None, "not gzip")
+        check(reader(old, repack(b"ENDSLEY/BSDIFF40" + stream[16:]), workdir) is None, "wrong magic")
+        check(reader(old, repack(stream + b"\0" * 24), workdir) is None, "data after the last segment")
+
+        # seeks out of the old image are caught by the next segment
+        control = delta_patch.diff(old, cases["insertion"])
+        check(len(control) > 1, "insertion needs more than one segment")
+        for seek in (1 << 30, -(1 << 20)):
+            bad = bytearray(delta_patch.MAGIC + delta_patch.offtout(len(cases["insertion"])))
+            for i, (diff, extra, z) in enumerate(control):
+                bad += delta_patch.offtout(len(diff)) + delta_patch.offtout(len(extra))
+                bad += delta_patch.offtout(seek if i == 0 else z) + diff + extra
+            check(reader(old, repack(bad), workdir) is None, "seek out of the partition by {}".format(seek))
+
+        other = bytearray(new)
+        other[12] = 2  # ESP32-S2
+        check(reader(old, delta_patch.create_patch(old, bytes(other)), workdir) is None, "image for another chip")
+
+        # against another base the result is wrong, the image hash check in Update.end() catches that
+        check(reader(cases["unrelated"], patch, workdir) != new, "patch against another base")
+
+        server.shutdown()
+
+    if failures:
+        print("{} check(s) failed".format(failures), file=sys.stderr)
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,45 @@
+/**
+ * The download OTA of DownloadFirmwareService on the host, HTTPClient is a socket shim and the
+ * OTA partition is Update's buffer. test_download_firmware.py runs it against ota_server.py:
+ *
+ *     test_download_firmware <url> <output>
+ *
+ * Prints what firmwareDownload() returned and the OTA events, the image written is saved to output.
+ */
+
+#include <DownloadFirmwareService.h>
+#include <fstream>
+
+// the certificate bundle linked into the firmware
+const uint8_t bundleStart[1] asm("_binary_src_certs_x509_crt_bundle_bin_start") = {0};
+const uint8_t bundleEnd[1] asm("_binary_src_certs_x509_crt_bundle_bin_end") = {0};
+
+String firmwareDownload(WiFiClientSecure &client, const String &url, FirmwareFormat format, int command);
+
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        fprintf(stderr, "usage: %s <url> <output>\n", argv[0]);
+        return 2;
+    }
+
+    PsychicHttpServer server;
+    SecurityManager securityManager;
+    EventSocket socket;
+    DownloadFirmwareService service(&server, &securityManager, &socket);
+    service.begin();
+
+    String url = argv[1];
+    WiFiClientSecure client;
+    String error = firmwareDownload(client, url, url.endsWith(".bin.gz") ? FIRMWARE_GZIP : FIRMWARE_RAW, U_FLASH);
+
+    printf("result: %s\nevents:", error.length() ? error.c_str() : "ok");
+    for (String &status : socket.statuses)
+        printf(" %s", status.c_str());
+    printf("\n");
+
+    std::ofstream out(argv[2], std::ios::binary);
+    out.write((const char *)Update.written.data(), Update.written.size());
+    return 0;
+}
@@ -0,0 +1,113 @@
+"""
+The download OTA in build/test_download_firmware against the stand-in in
+ota_server.py, which cuts connections, ignores Range or changes the file
+between two attempts. What ends up in the OTA partition has to match the
+image byte for byte.
+
+    python3 test_download_firmware.py [build directory]
+"""
+
+import gzip
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+import ota_server
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+BUILD = sys.argv[1] if len(sys.argv) > 1 else os.path.join(HERE, "build")
+CLIENT = os.path.join(BUILD, "test_download_firmware")
+
+# OTA_DOWNLOAD_RETRIES in shims/DownloadFirmwareService.h
+RETRIES = 5
+
+failures = 0
+
+
+def check(condition, what):
+    global failures
+    if not condition:
+        print("check failed: " + what, file=sys.stderr)
+        failures += 1
+
+
+def firmware(size, seed, chip=0):
+    rnd = random.Random(seed)
+    data = bytearray(rnd.getrandbits(8) for _ in range(size))
+    data[0] = 0xE9
+    data[12] = chip
+    return bytes(data)
+
+
+def download(workdir, name, files, **options):
+    """ Serves files, downloads name from the stand-in, returns the result, the events, the image and the request count """
+    for file, data in files.items():
+        with open(os.path.join(workdir, file), "wb") as f:
+            f.write(data)
+    server = ota_server.start(workdir, **options)
+    output = os.path.join(workdir, "partition.bin")
+    url = "http://127.0.0.1:{}/{}".format(server.server_port, name)
+    run = subprocess.run([CLIENT, url, output], stdout=subprocess.PIPE, stderr=subprocess.PIPE, timeout=60, text=True)
+    server.shutdown()
+    server.server_close()
+
+    lines = dict(line.split(":", 1) for line in run.stdout.splitlines() if ":" in line)
+    with open(output, "rb") as f:
+        image = f.read()
+    return lines.get("result", "").strip(), lines.get("events", "").split(), image, server.config["requests"]
+
+
+def main():
+    image = firmware(300 * 1024, 1)
+    update = firmware(300 * 1024, 2)
+
+    with tempfile.TemporaryDirectory() as workdir:
+        result, events, written, requests = download(workdir, "firmware.bin", {"firmware.bin": image})
+        check(result == "ok" and written == image, "plain download: " + result)
+        check(requests == 1 and events[0] == "preparing" and events[-1] == "finished", "plain download events")
+
+        result, events, written, requests = download(workdir, "firmware.bin", {"firmware.bin": image}, drop_after=50000, drops=3)
+        check(result == "ok" and written == image, "resumed download: " + result)
+        check(requests == 4, "resumed download needs 4 requests, took {}".format(requests))
+
+        result, events, written, requests = download(workdir, "firmware.bin.gz", {"firmware.bin.gz": gzip.compress(image)},
+                                                     drop_after=100000, drops=2)
+        check(result == "ok" and written == image, "resumed gzip download: " + result)
+
+        # the same ETag on a full response, the part already written is skipped
+        result, events, written, requests = download(workdir, "firmware.bin", {"firmware.bin": image},
+                                                     drop_after=120000, drops=1, no_range=True)
+        check(result == "ok" and written == image, "server without Range: " + result)
+        check(requests == 2, "server without Range needs 2 requests, took {}".format(requests))
+
+        def replace(requests):
+            if requests == 1:
+                with open(os.path.join(workdir, "firmware.bin"), "wb") as f:
+                    f.write(update)
+
+        result, events, written, requests = download(workdir, "firmware.bin", {"firmware.bin": image},
+                                                     drop_after=50000, drops=1, hook=replace)
+        check(result == "Firmware changed on the server during the download", "changed file: " + result)
+        check(events[-1] != "finished", "changed file is not finished")
+
+        result, events, written, requests = download(workdir, "firmware.bin", {"firmware.bin": image}, drop_after=20000, drops=100)
+        check(result != "ok", "endless disconnects have to fail")
+        check(requests == RETRIES + 1, "gave up after {} requests".format(requests))
+
+        # the chip type of raw images is checked before anything is flashed
+        result, events, written, requests = download(workdir, "firmware.bin", {"firmware.bin": firmware(300 * 1024, 3, chip=9)})
+        check(result == "Wrong firmware for this device", "image for another chip: " + result)
+        check(len(written) == 0, "image for another chip was flashed")
+
+        result, events, written, requests = download(workdir, "missing.bin", {})
+        check(result == "Download failed with HTTP status 404", "missing file: " + result)
+
+    if failures:
+        print("{} check(s) failed".format(failures), file=sys.stderr)
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,129 @@
+/**
+ * FirmwareWriter on the host, Update.write() collects the image and the running partition is a buffer.
+ *
+ * Without arguments raw and gzip images are written in uneven chunks and broken ones have to fail.
+ * With arguments it applies a delta patch the way the device does, test_delta_patch.py drives that:
+ *
+ *     test_firmware_writer <running firmware> <patch> <output>
+ *
+ * The exit code is 0 if the writer accepted the patch, the output is only written then.
+ */
+
+#include "harness.h"
+#include <FirmwareWriter.h>
+#include <esp_ota_ops.h>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+typedef std::vector<uint8_t> Bytes;
+
+static Bytes readFile(const char *path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return Bytes(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// hands the data over in random sized pieces like the network does
+static bool writeAll(FirmwareFormat format, const Bytes &data, unsigned seed)
+{
+    FirmwareWriter writer;
+    std::mt19937 random(seed);
+    Update.written.clear();
+
+    if (!writer.begin(format))
+        return false;
+
+    size_t pos = 0;
+    while (pos < data.size())
+    {
+        size_t len = min(data.size() - pos, (size_t)(random() % 3000 + 1));
+        if (!writer.write(data.data() + pos, len))
+            break;
+        pos += len;
+    }
+
+    return writer.end();
+}
+
+static Bytes image(size_t size, unsigned seed)
+{
+    std::mt19937 random(seed);
+    Bytes data(size);
+    for (size_t i = 0; i < size; i++)
+        data[i] = i % 64 < 48 ? random() & 0xff : i & 0xff;
+    data[0] = ESP_MAGIC_BYTE;
+    data[12] = ESP_CHIP_ID;
+    return data;
+}
+
+static Bytes gzip(const Bytes &data)
+{
+    z_stream stream = {};
+    deflateInit2(&stream, 9, Z_DEFLATED, 31, 9, Z_DEFAULT_STRATEGY);
+    Bytes out(deflateBound(&stream, data.size()) + 32);
+    stream.next_in = (Bytef *)data.data();
+    stream.avail_in = data.size();
+    stream.next_out = out.data();
+    stream.avail_out = out.size();
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+
+static int applyPatch(const char *oldPath, const char *patchPath, const char *outPath)
+{
+    // the partition is larger than the image in it and erased flash reads 0xff
+    runningPartition.data = readFile(oldPath);
+    runningPartition.data.resize(runningPartition.data.size() + 4096, 0xff);
+    runningPartition.size = runningPartition.data.size();
+
+    if (!writeAll(FIRMWARE_DELTA, readFile(patchPath), 1))
+        return 1;
+
+    std::ofstream out(outPath, std::ios::binary);
+    out.write((const char *)Update.written.data(), Update.written.size());
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 4)
+        return applyPatch(argv[1], argv[2], argv[3]);
+
+    Bytes firmware = image(100000, 7);
+
+    // raw images go through untouched
+    CHECK(writeAll(FIRMWARE_RAW, firmware, 1));
+    CHECK(Update.written == firmware);
+
+    // gzip images are inflated through the 32 kB window
+    Bytes compressed = gzip(firmware);
+    CHECK(writeAll(FIRMWARE_GZIP, compressed, 2));
+    CHECK(Update.written == firmware);
+
+    // a flipped bit in the gzip trailer fails the CRC check
+    Bytes badCrc = compressed;
+    badCrc[badCrc.size() - 6] ^= 1;
+    CHECK(!writeAll(FIRMWARE_GZIP, badCrc, 3));
+
+    // so does a stream that stops early
+    Bytes truncated(compressed.begin(), compressed.begin() + compressed.size() / 2);
+    CHECK(!writeAll(FIRMWARE_GZIP, truncated, 4));
+
+    // an image for another chip is refused before it is flashed, compressed ones once they are inflated
+    Bytes otherChip = firmware;
+    otherChip[12] = ESP_CHIP_ID + 1;
+    CHECK(!writeAll(FIRMWARE_RAW, otherChip, 5));
+    CHECK(Update.written.empty());
+    CHECK(!writeAll(FIRMWARE_GZIP, gzip(otherChip), 5));
+
+    // a failing flash write stops the writer
+    Update.failAfter = 50000;
+    CHECK(!writeAll(FIRMWARE_RAW, firmware, 6));
+    Update.failAfter = -1;
+
+    return finish();
+}
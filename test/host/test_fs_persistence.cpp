@@ -0,0 +1,234 @@
+/**
+ * FSPersistence across power cuts on the in-memory filesystem of shims/FS.h, which commits a file
+ * when it is closed like esp_littlefs. The power is cut after every write, close, rename and remove
+ * of a settings write, and once more at every step of the recovery on the next boot. Every boot
+ * has to come up with either the old or the new settings. Copies left by a cut, the temporary file
+ * and the backup, are read in their turn, a copy with a flipped bit is skipped for the next one.
+ */
+
+#include "harness.h"
+#include <FSPersistence.h>
+
+static const char *PATH = "/config/wifiSettings.json";
+static const char *FILE_PATH = "/config/wifiSettings.msgpack";
+
+struct WiFiSettings
+{
+    String ssid;
+    int channel = 0;
+
+    static void read(WiFiSettings &settings, JsonObject &root)
+    {
+        root["ssid"] = settings.ssid;
+        root["channel"] = settings.channel;
+    }
+
+    static StateUpdateResult update(JsonObject &root, WiFiSettings &settings, const String &originId)
+    {
+        settings.ssid = root["ssid"] | "default";
+        settings.channel = root["channel"] | 1;
+        return StateUpdateResult::CHANGED;
+    }
+};
+
+// a device with the settings service and its persistence, as it comes up after a reset
+struct Device
+{
+    StatefulService<WiFiSettings> service;
+    FSPersistence<WiFiSettings> persistence;
+
+    Device(fs::FS &fs) : persistence(WiFiSettings::read, WiFiSettings::update, &service, &fs, PATH, 0, 0) {}
+
+    String boot()
+    {
+        persistence.readFromFS();
+        return ssid();
+    }
+
+    String ssid()
+    {
+        String ssid;
+        service.read([&ssid](WiFiSettings &settings) { ssid = settings.ssid; });
+        return ssid;
+    }
+
+    void save(const char *ssid)
+    {
+        service.updateWithoutPropagation([ssid](WiFiSettings &settings) {
+            settings.ssid = ssid;
+            settings.channel++;
+            return StateUpdateResult::CHANGED;
+        }, "test");
+        persistence.writeToFS();
+    }
+};
+
+static void copyStorage(fs::FS &to, fs::FS &from)
+{
+    to.storage().files = from.storage().files;
+    to.storage().directories = from.storage().directories;
+}
+
+// the first boot writes the defaults without a backup, every write of "old" keeps the previous file as backup
+static void prepare(fs::FS &fs, int writes)
+{
+    Device device(fs);
+    device.boot();
+    for (int i = 0; i < writes; i++)
+        device.save("old");
+}
+
+// the power is cut at step cut of writing "new", false once the write has fewer steps
+static bool cutWrite(fs::FS &fs, long cut)
+{
+    Device device(fs);
+    device.boot();
+    fs.storage().cutAfter = cut;
+    try
+    {
+        device.save("new");
+    }
+    catch (const fs::PowerCut &)
+    {
+        fs.storage().reboot();
+        return true;
+    }
+    fs.storage().reboot();
+    return false;
+}
+
+static String bootWithCut(fs::FS &fs, long cut, bool *cutHappened)
+{
+    Device device(fs);
+    fs.storage().cutAfter = cut;
+    try
+    {
+        String ssid = device.boot();
+        *cutHappened = false;
+        fs.storage().reboot();
+        return ssid;
+    }
+    catch (const fs::PowerCut &)
+    {
+        *cutHappened = true;
+        fs.storage().reboot();
+        return "";
+    }
+}
+
+static std::vector<uint8_t> &content(fs::FS &fs, const std::string &path)
+{
+    return fs.storage().files[path].data;
+}
+
+static void powerCuts(int previousWrites)
+{
+    String old = previousWrites ? "old" : "default";
+    fs::FS base;
+    prepare(base, previousWrites);
+
+    long cut = 1;
+    for (;; cut++)
+    {
+        fs::FS flash;
+        copyStorage(flash, base);
+        if (!cutWrite(flash, cut))
+        {
+            CHECK(Device(flash).boot() == "new");
+            break;
+        }
+
+        // the next boot finds the old or the new settings and keeps them
+        fs::FS once;
+        copyStorage(once, flash);
+        String ssid = Device(once).boot();
+        if (ssid != old && ssid != "new")
+            fprintf(stderr, "power cut at step %ld after %d write(s): \"%s\"\n", cut, previousWrites, ssid.c_str());
+        CHECK(ssid == old || ssid == "new");
+        CHECK(Device(once).boot() == ssid);
+
+        // the recovery itself is cut at every step, the boot after it still finds one of them
+        for (long recoveryCut = 1;; recoveryCut++)
+        {
+            fs::FS twice;
+            copyStorage(twice, flash);
+            bool cutHappened;
+            bootWithCut(twice, recoveryCut, &cutHappened);
+            String again = Device(twice).boot();
+            CHECK(again == old || again == "new");
+            CHECK(Device(twice).boot() == again);
+            if (!cutHappened)
+                break;
+        }
+    }
+    printf("%ld power cuts in a write after %d earlier write(s), old or new settings after each\n", cut - 1, previousWrites);
+}
+
+int main()
+{
+    // the first write after the defaults creates the backup, later writes replace it
+    powerCuts(0);
+    powerCuts(1);
+
+    // a reset between the two renames leaves no file, the temporary file is the newer copy
+    {
+        fs::FS flash;
+        prepare(flash, 1);
+        Device(flash).save("new");
+        flash.storage().files[std::string(FILE_PATH) + FS_TEMPORARY_SUFFIX] = flash.storage().files[FILE_PATH];
+        flash.storage().files.erase(FILE_PATH);
+        CHECK(Device(flash).boot() == "new");
+        CHECK(flash.storage().files.count(FILE_PATH) == 1);
+        CHECK(Device(flash).boot() == "new");
+    }
+
+    // with an incomplete temporary file the backup is read
+    {
+        fs::FS flash;
+        prepare(flash, 2);
+        flash.storage().files[std::string(FILE_PATH) + FS_TEMPORARY_SUFFIX].data.assign(5, 0x81);
+        flash.storage().files[std::string(FILE_PATH) + FS_BACKUP_SUFFIX] = flash.storage().files[FILE_PATH];
+        flash.storage().files.erase(FILE_PATH);
+        CHECK(Device(flash).boot() == "old");
+        CHECK(flash.storage().files.count(FILE_PATH) == 1);
+    }
+
+    // a flipped bit anywhere in the file: the content is skipped for the backup, never applied
+    fs::FS base;
+    prepare(base, 1);
+    Device(base).save("new");
+    size_t size = content(base, FILE_PATH).size();
+    size_t contentSize = size - FS_CHECKSUM_SIZE;
+    int fallbacks = 0;
+    for (size_t bit = 0; bit < size * 8; bit++)
+    {
+        fs::FS flash;
+        copyStorage(flash, base);
+        content(flash, FILE_PATH)[bit / 8] ^= 1 << (bit % 8);
+
+        String ssid = Device(flash).boot();
+        if (bit / 8 < contentSize)
+            CHECK(ssid == "old");
+        else
+            CHECK(ssid == "old" || ssid == "new");
+        fallbacks += ssid == "old";
+
+        // the damaged file is replaced by the recovered settings
+        CHECK(content(flash, FILE_PATH) != content(base, FILE_PATH) || ssid == "new");
+        CHECK(Device(flash).boot() == ssid);
+    }
+    printf("%u flipped bits in a %u byte file, %d read from the backup\n", (unsigned)(size * 8), (unsigned)size, fallbacks);
+
+    // without an intact copy the defaults are applied and written
+    {
+        fs::FS flash;
+        copyStorage(flash, base);
+        content(flash, FILE_PATH)[0] ^= 1;
+        content(flash, std::string(FILE_PATH) + FS_BACKUP_SUFFIX)[0] ^= 1;
+        CHECK(Device(flash).boot() == "default");
+        CHECK(Device(flash).boot() == "default");
+    }
+
+    FSPersistenceBase::shutdown(false);
+    return finish();
+}
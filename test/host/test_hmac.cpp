@@ -0,0 +1,214 @@
+/**
+ * HMAC-SHA256 for the JWT signatures. The naive HMAC hashes both padded key blocks for every
+ * signature, like mbedtls_md_hmac_starts() did, ArduinoJsonJWT hashes them once per secret and
+ * continues from copies of the two states. Both are checked against the RFC 4231 test cases, the
+ * tokens of ArduinoJsonJWT against the naive HMAC. mbedtls comes from shims/mbedtls/sha256.h.
+ */
+
+#include "harness.h"
+#include <ArduinoJsonJWT.h>
+#include <string>
+
+// the naive HMAC (RFC 2104), key blocks and all for every message
+static std::string naiveHmac(const std::string &secret, const std::string &data)
+{
+    uint8_t key[64] = {0};
+    if (secret.size() > 64)
+        mbedtls_sha256((const unsigned char *)secret.data(), secret.size(), key, 0);
+    else
+        memcpy(key, secret.data(), secret.size());
+
+    uint8_t pad[64];
+    uint8_t result[32];
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+
+    for (int i = 0; i < 64; i++)
+        pad[i] = key[i] ^ 0x36;
+    mbedtls_sha256_starts(&ctx, 0);
+    mbedtls_sha256_update(&ctx, pad, 64);
+    mbedtls_sha256_update(&ctx, (const unsigned char *)data.data(), data.size());
+    mbedtls_sha256_finish(&ctx, result);
+
+    for (int i = 0; i < 64; i++)
+        pad[i] = key[i] ^ 0x5c;
+    mbedtls_sha256_starts(&ctx, 0);
+    mbedtls_sha256_update(&ctx, pad, 64);
+    mbedtls_sha256_update(&ctx, result, 32);
+    mbedtls_sha256_finish(&ctx, result);
+
+    mbedtls_sha256_free(&ctx);
+    return std::string((const char *)result, 32);
+}
+
+// the key states the way ArduinoJsonJWT keeps them, its sign() is private
+class PrecomputedHmac
+{
+public:
+    PrecomputedHmac(const std::string &secret)
+    {
+        uint8_t key[64] = {0};
+        if (secret.size() > 64)
+            mbedtls_sha256((const unsigned char *)secret.data(), secret.size(), key, 0);
+        else
+            memcpy(key, secret.data(), secret.size());
+
+        uint8_t pad[64];
+        for (int i = 0; i < 64; i++)
+            pad[i] = key[i] ^ 0x36;
+        mbedtls_sha256_init(&_inner);
+        mbedtls_sha256_starts(&_inner, 0);
+        mbedtls_sha256_update(&_inner, pad, 64);
+        for (int i = 0; i < 64; i++)
+            pad[i] = key[i] ^ 0x5c;
+        mbedtls_sha256_init(&_outer);
+        mbedtls_sha256_starts(&_outer, 0);
+        mbedtls_sha256_update(&_outer, pad, 64);
+    }
+
+    std::string operator()(const std::string &data) const
+    {
+        uint8_t result[32];
+        mbedtls_sha256_context ctx;
+        mbedtls_sha256_init(&ctx);
+        mbedtls_sha256_clone(&ctx, &_inner);
+        mbedtls_sha256_update(&ctx, (const unsigned char *)data.data(), data.size());
+        mbedtls_sha256_finish(&ctx, result);
+        mbedtls_sha256_clone(&ctx, &_outer);
+        mbedtls_sha256_update(&ctx, result, 32);
+        mbedtls_sha256_finish(&ctx, result);
+        mbedtls_sha256_free(&ctx);
+        return std::string((const char *)result, 32);
+    }
+
+private:
+    mbedtls_sha256_context _inner;
+    mbedtls_sha256_context _outer;
+};
+
+static std::string hex(const std::string &bytes)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string text;
+    for (unsigned char c : bytes)
+    {
+        text += digits[c >> 4];
+        text += digits[c & 0x0f];
+    }
+    return text;
+}
+
+static std::string base64url(const std::string &bytes)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    std::string text;
+    size_t i = 0;
+    for (; i + 3 <= bytes.size(); i += 3)
+    {
+        uint32_t bits = (uint8_t)bytes[i] << 16 | (uint8_t)bytes[i + 1] << 8 | (uint8_t)bytes[i + 2];
+        for (int shift = 18; shift >= 0; shift -= 6)
+            text += alphabet[(bits >> shift) & 0x3f];
+    }
+    if (i < bytes.size())
+    {
+        uint32_t bits = (uint8_t)bytes[i] << 16 | (i + 1 < bytes.size() ? (uint8_t)bytes[i + 1] << 8 : 0);
+        for (int shift = 18, n = 0; n <= (int)(bytes.size() - i); shift -= 6, n++)
+            text += alphabet[(bits >> shift) & 0x3f];
+    }
+    return text;
+}
+
+struct TestCase
+{
+    const char *name;
+    std::string key;
+    std::string data;
+    const char *mac;
+};
+
+int main()
+{
+    std::string key4;
+    for (char c = 1; c <= 0x19; c++)
+        key4 += c;
+
+    // RFC 4231 section 4, case 5 is truncated to 128 bits and left out
+    std::vector<TestCase> cases = {
+        {"case 1", std::string(20, '\x0b'), "Hi There",
+         "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7"},
+        {"case 2", "Jefe", "what do ya want for nothing?",
+         "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843"},
+        {"case 3", std::string(20, '\xaa'), std::string(50, '\xdd'),
+         "773ea91e36800e46854db8ebd09181a72959098b3ef8c122d9635514ced565fe"},
+        {"case 4", key4, std::string(50, '\xcd'),
+         "82558a389a443c0ea4cc819899f2083a85f0faa3e578f8077a2e3ff46729665b"},
+        {"case 6", std::string(131, '\xaa'), "Test Using Larger Than Block-Size Key - Hash Key First",
+         "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54"},
+        {"case 7", std::string(131, '\xaa'),
+         "This is a test using a larger than block-size key and a larger than block-size data. The key needs to "
+         "be hashed before being used by the HMAC algorithm.",
+         "9b09ffa71b942fcb27635fbcd5b0e944bfdc63644f0713938a7f51535c3a35e2"}};
+
+    ArduinoJsonJWT jwt("secret");
+    for (const TestCase &test : cases)
+    {
+        CHECK(hex(naiveHmac(test.key, test.data)) == test.mac);
+        CHECK(hex(PrecomputedHmac(test.key)(test.data)) == test.mac);
+
+        // ArduinoJsonJWT with the key as its secret signs like the naive HMAC, and reads its token back
+        jwt.setSecret(test.key.c_str());
+        JsonDocument payload;
+        payload["username"] = "admin";
+        payload["admin"] = true;
+        JsonObject object = payload.as<JsonObject>();
+        std::string token = jwt.buildJWT(object).c_str();
+        size_t dot = token.rfind('.');
+        if (token.substr(dot + 1) != base64url(naiveHmac(test.key, token.substr(0, dot))))
+            fprintf(stderr, "%s: the token signature differs from the HMAC\n", test.name);
+        CHECK(token.substr(dot + 1) == base64url(naiveHmac(test.key, token.substr(0, dot))));
+
+        JsonDocument parsed;
+        jwt.parseJWT(token.c_str(), token.size(), parsed);
+        CHECK(parsed["username"].as<String>() == "admin");
+
+        // a changed signature is rejected
+        token[token.size() - 2] = token[token.size() - 2] == 'A' ? 'B' : 'A';
+        jwt.parseJWT(token.c_str(), token.size(), parsed);
+        CHECK(!parsed.is<JsonObject>());
+    }
+
+    // the part of a token of the framework that is signed
+    jwt.setSecret("a random JWT secret of the framework");
+    JsonDocument payload;
+    payload["username"] = "admin";
+    payload["admin"] = true;
+    JsonObject object = payload.as<JsonObject>();
+    std::string token = jwt.buildJWT(object).c_str();
+    std::string data = token.substr(0, token.rfind('.'));
+    std::string secret = "a random JWT secret of the framework";
+
+    const int rounds = 100000;
+    PrecomputedHmac precomputed(secret);
+    volatile uint8_t sink = 0;
+    uint32_t start = micros();
+    for (int i = 0; i < rounds; i++)
+        sink ^= naiveHmac(secret, data)[0];
+    uint32_t naive = micros() - start;
+    start = micros();
+    for (int i = 0; i < rounds; i++)
+        sink ^= precomputed(data)[0];
+    uint32_t states = micros() - start;
+    start = micros();
+    for (int i = 0; i < rounds; i++)
+    {
+        JsonDocument parsed;
+        jwt.parseJWT(token.c_str(), token.size(), parsed);
+        sink ^= parsed.is<JsonObject>();
+    }
+    uint32_t parse = micros() - start;
+
+    printf("HMAC-SHA256 over %u bytes: naive %.2f us, precomputed key states %.2f us, parseJWT %.2f us\n",
+           (unsigned)data.size(), naive * 1.0 / rounds, states * 1.0 / rounds, parse * 1.0 / rounds);
+
+    return finish();
+}
@@ -0,0 +1,190 @@
+/**
+ * JSON responses serialized through ChunkPrinter into the server's buffer against the two passes
+ * PsychicJsonResponse::send() made before: measureJson() for the length, a malloc'd buffer and
+ * serializeJson() into it. The documents are shaped like the SystemStatus and WiFi scan responses,
+ * the scan list is larger than the buffer and goes out chunked. Both have to send the same bytes.
+ */
+
+#include "harness.h"
+#include <ArduinoJson.h>
+#include <ChunkPrinter.h>
+#include <string>
+
+// the default of PsychicJson.h, which needs the whole server
+#define JSON_BUFFER_SIZE 4 * 1024
+
+// the response only collects what would go out on the socket
+static std::string sent;
+static size_t sends;
+
+PsychicResponse::PsychicResponse(PsychicRequest *request) : _request(request), _code(200), _contentLength(0), _body("") {}
+PsychicResponse::~PsychicResponse() {}
+esp_err_t PsychicResponse::send() { return ESP_OK; }
+
+esp_err_t PsychicResponse::sendChunk(uint8_t *chunk, size_t chunksize)
+{
+    sent.append((const char *)chunk, chunksize);
+    sends++;
+    return ESP_OK;
+}
+
+static esp_err_t sendWhole(const char *buffer, size_t len)
+{
+    sent.append(buffer, len);
+    sends++;
+    return ESP_OK;
+}
+
+static void systemStatus(JsonDocument &document)
+{
+    JsonObject root = document.to<JsonObject>();
+    root["esp_platform"] = "esp32s3";
+    root["firmware_version"] = "0.6.0";
+    root["max_alloc_heap"] = 110580;
+    root["free_psram"] = 8312340;
+    root["used_psram"] = 73268;
+    root["psram_size"] = 8385608;
+    root["cpu_freq_mhz"] = 240;
+    root["cpu_type"] = "ESP32-S3";
+    root["cpu_rev"] = 2;
+    root["cpu_cores"] = 2;
+    root["free_heap"] = 184512;
+    root["used_heap"] = 143928;
+    root["total_heap"] = 328440;
+    root["min_free_heap"] = 170116;
+    root["sketch_size"] = 1632768;
+    root["free_sketch_space"] = 3342336;
+    root["sdk_version"] = "v5.1.4-828-gd8a7b0cd4e-dirty";
+    root["arduino_version"] = "v3.0.7";
+    root["flash_chip_size"] = 16777216;
+    root["flash_chip_speed"] = 80000000;
+    root["fs_total"] = 3407872;
+    root["fs_used"] = 786432;
+    root["core_temp"] = 41.7;
+    root["cpu_reset_reason"] = "Software reset via esp_restart";
+    root["uptime"] = 86417;
+
+    JsonObject rateLimits = root["rate_limits"].to<JsonObject>();
+    rateLimits["signIn"] = 5;
+    rateLimits["api"] = 40;
+    rateLimits["tracked"] = 12;
+}
+
+static void wifiList(JsonDocument &document, int count)
+{
+    JsonObject root = document.to<JsonObject>();
+    JsonArray networks = root["networks"].to<JsonArray>();
+    for (int i = 0; i < count; i++)
+    {
+        char ssid[33], bssid[18];
+        snprintf(ssid, sizeof(ssid), "Network %d %s", i, i % 3 ? "5G" : "guest");
+        snprintf(bssid, sizeof(bssid), "A4:CF:12:%02X:%02X:%02X", i, i * 7 & 0xff, i * 13 & 0xff);
+
+        JsonObject network = networks.add<JsonObject>();
+        network["rssi"] = -40 - i % 50;
+        network["ssid"] = ssid;
+        network["bssid"] = bssid;
+        network["channel"] = 1 + i % 13;
+        network["encryption_type"] = (uint8_t)(i % 5);
+    }
+}
+
+// what send() did before: measure, allocate, serialize, send
+static esp_err_t twoPass(PsychicResponse &response, JsonVariant root)
+{
+    esp_err_t err;
+    size_t length = measureJson(root);
+    size_t bufferSize = length < JSON_BUFFER_SIZE ? length + 1 : JSON_BUFFER_SIZE;
+    char *buffer = (char *)malloc(bufferSize);
+    if (buffer == NULL)
+        return ESP_FAIL;
+
+    if (length < JSON_BUFFER_SIZE)
+    {
+        serializeJson(root, buffer, bufferSize);
+        err = sendWhole(buffer, length);
+    }
+    else
+    {
+        ChunkPrinter dest(&response, (uint8_t *)buffer, bufferSize);
+        serializeJson(root, dest);
+        dest.flush();
+        err = ESP_OK;
+    }
+    free(buffer);
+    return err;
+}
+
+// what send() does now, with the buffer the server keeps
+static esp_err_t onePass(PsychicResponse &response, JsonVariant root, char *buffer)
+{
+    ChunkPrinter dest(&response, (uint8_t *)buffer, JSON_BUFFER_SIZE);
+    serializeJson(root, dest);
+    if (dest.sent() == 0)
+    {
+        esp_err_t err = sendWhole(buffer, dest.buffered());
+        dest.clear();
+        return err;
+    }
+    dest.flush();
+    return ESP_OK;
+}
+
+static void compare(const char *name, JsonDocument &document, size_t rounds)
+{
+    PsychicResponse response(NULL);
+    char *buffer = (char *)malloc(JSON_BUFFER_SIZE);
+    JsonVariant root = document;
+
+    sent.clear();
+    sends = 0;
+    CHECK(twoPass(response, root) == ESP_OK);
+    std::string before = sent;
+    size_t beforeSends = sends;
+
+    sent.clear();
+    sends = 0;
+    CHECK(onePass(response, root, buffer) == ESP_OK);
+    CHECK(sent == before);
+    CHECK(sends == beforeSends);
+    CHECK(sent.size() == measureJson(root));
+
+    uint32_t start = micros();
+    for (size_t i = 0; i < rounds; i++)
+    {
+        sent.clear();
+        twoPass(response, root);
+    }
+    uint32_t twoPassTime = micros() - start;
+
+    start = micros();
+    for (size_t i = 0; i < rounds; i++)
+    {
+        sent.clear();
+        onePass(response, root, buffer);
+    }
+    uint32_t onePassTime = micros() - start;
+
+    printf("%s, %u bytes in %u send(s): two passes %.1f us, ChunkPrinter %.1f us per response\n", name,
+           (unsigned)before.size(), (unsigned)beforeSends, twoPassTime / (double)rounds, onePassTime / (double)rounds);
+    free(buffer);
+}
+
+int main()
+{
+    JsonDocument status;
+    systemStatus(status);
+    compare("SystemStatus", status, 20000);
+
+    // 60 networks are more than JSON_BUFFER_SIZE
+    JsonDocument networks;
+    wifiList(networks, 60);
+    CHECK(measureJson(networks) > JSON_BUFFER_SIZE);
+    compare("WiFi scan, 60 networks", networks, 2000);
+
+    JsonDocument fewNetworks;
+    wifiList(fewNetworks, 8);
+    compare("WiFi scan, 8 networks", fewNetworks, 20000);
+
+    return finish();
+}
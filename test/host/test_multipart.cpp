@@ -0,0 +1,248 @@
+/**
+ * The multipart parser of PsychicUploadHandler, which scans item data block-wise for the delimiter,
+ * against the byte-wise loop it had before. Bodies are received in the chunk sizes of the test, so
+ * boundaries and their CRLF end up split across two receives, and the data holds prefixes of the
+ * delimiter. Both have to deliver the same fields and file contents.
+ */
+
+#include "harness.h"
+#include <PsychicHttp.h>
+#include <map>
+#include <random>
+
+static const char *BOUNDARY = "----PsychicBoundary7MA4YWxkTrZu0gW";
+
+struct Upload
+{
+    std::map<std::string, std::string> files;
+    std::map<std::string, std::string> fields;
+    std::map<std::string, size_t> fileSizes;
+    size_t callbacks = 0;
+    size_t finals = 0;
+    size_t firstLength = 0;
+    bool ordered = true;
+
+    bool operator==(const Upload &other) const
+    {
+        return files == other.files && fields == other.fields && fileSizes == other.fileSizes && finals == other.finals;
+    }
+};
+
+class TestHandler : public PsychicUploadHandler
+{
+public:
+    TestHandler(Upload &upload)
+    {
+        onUpload([&upload](PsychicRequest *request, const String &filename, uint64_t index, uint8_t *data, size_t len, bool final) {
+            std::string &file = upload.files[filename.c_str()];
+            if (index != file.size())
+                upload.ordered = false;
+            if (upload.callbacks++ == 0)
+                upload.firstLength = len;
+            file.append((const char *)data, len);
+            upload.finals += final;
+            return ESP_OK;
+        });
+    }
+
+    esp_err_t parse(PsychicRequest *request, bool bytewise)
+    {
+        _request = request;
+        _parsedLength = 0;
+        return bytewise ? _bytewiseUploadHandler(request) : _multipartUploadHandler(request);
+    }
+
+private:
+    // _multipartUploadHandler() as it was, every byte went through _parseMultipartPostByte()
+    esp_err_t _bytewiseUploadHandler(PsychicRequest *request)
+    {
+        esp_err_t err = ESP_OK;
+
+        String value = request->header("Content-Type");
+        _boundary = value.substring(value.indexOf('=') + 1);
+        _boundary.replace("\"", "");
+
+        char *buf = (char *)malloc(FILE_CHUNK_SIZE);
+        int received;
+        unsigned long index = 0;
+        int remaining = request->contentLength();
+
+        while (remaining > 0)
+        {
+            if ((received = httpd_req_recv(request->request(), buf, min(remaining, FILE_CHUNK_SIZE))) <= 0)
+            {
+                if (received == HTTPD_SOCK_ERR_TIMEOUT)
+                    continue;
+                else if (received == HTTPD_SOCK_ERR_FAIL)
+                {
+                    err = ESP_FAIL;
+                    break;
+                }
+            }
+
+            for (int i = 0; i < received; i++)
+            {
+                remaining--;
+                index++;
+                _parseMultipartPostByte(buf[i], !remaining);
+                _parsedLength++;
+            }
+        }
+
+        free(buf);
+        return err;
+    }
+};
+
+class TestRequest : public PsychicRequest
+{
+public:
+    using PsychicRequest::PsychicRequest;
+};
+
+struct Part
+{
+    std::string name;
+    std::string filename;
+    std::string content;
+};
+
+static std::string multipart(const std::vector<Part> &parts)
+{
+    std::string body;
+    for (const Part &part : parts)
+    {
+        body += "--" + std::string(BOUNDARY) + "\r\n";
+        body += "Content-Disposition: form-data; name=\"" + part.name + "\"";
+        if (!part.filename.empty())
+            body += "; filename=\"" + part.filename + "\"\r\nContent-Type: application/octet-stream";
+        body += "\r\n\r\n" + part.content + "\r\n";
+    }
+    return body + "--" + BOUNDARY + "--\r\n";
+}
+
+static Upload upload(PsychicHttpServer &server, const std::string &body, const std::vector<size_t> &chunks, bool bytewise)
+{
+    HostRequest req(HTTP_POST, "/upload", body);
+    req.header("Content-Type", std::string("multipart/form-data; boundary=") + BOUNDARY);
+    req.chunks = chunks;
+
+    Upload result;
+    {
+        TestRequest request(&server, &req);
+        TestHandler handler(result);
+        CHECK(handler.parse(&request, bytewise) == ESP_OK);
+
+        for (PsychicWebParameter *param = request.params(); param != NULL; param = param->next())
+        {
+            if (param->isFile())
+                result.fileSizes[param->value()] = param->size();
+            else
+                result.fields[param->name()] = param->value();
+        }
+    }
+    return result;
+}
+
+// the block-wise parser has to come up with what the byte-wise one did
+static void compare(PsychicHttpServer &server, const char *name, const std::vector<Part> &parts, const std::vector<size_t> &chunks)
+{
+    std::string body = multipart(parts);
+    Upload before = upload(server, body, chunks, true);
+    Upload now = upload(server, body, chunks, false);
+
+    bool same = now == before && now.ordered && before.ordered;
+    for (const Part &part : parts)
+    {
+        if (part.filename.empty())
+            same = same && now.fields[part.name] == part.content;
+        else if (!part.content.empty())
+            same = same && now.files[part.filename] == part.content && now.fileSizes[part.filename] == part.content.size();
+    }
+
+    // the first callback of a file sees a whole buffer, or the whole file
+    if (now.callbacks)
+        same = same && now.firstLength == min((size_t)FILE_CHUNK_SIZE, now.files.begin()->second.size());
+
+    if (!same)
+        fprintf(stderr, "%s: the block-wise parser differs\n", name);
+    CHECK(same);
+}
+
+// receives of at most FILE_CHUNK_SIZE, like the handler asks for, one of them ends at offset
+static std::vector<size_t> endingAt(size_t offset, size_t total)
+{
+    const size_t chunk = FILE_CHUNK_SIZE;
+    std::vector<size_t> chunks(offset / chunk, chunk);
+    if (offset % chunk)
+        chunks.push_back(offset % chunk);
+    chunks.resize(chunks.size() + total / chunk + 1, chunk);
+    return chunks;
+}
+
+static std::string randomData(size_t size, unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::string data(size, 0);
+    for (char &c : data)
+        c = random() & 0xff;
+    return data;
+}
+
+int main()
+{
+    PsychicHttpServer server;
+    std::string delimiter = std::string("\r\n--") + BOUNDARY;
+
+    std::vector<Part> form = {{"ssid", "", "Home Network"},
+                              {"password", "", "hunter2"},
+                              {"file", "firmware.bin", randomData(20000, 1)}};
+    compare(server, "whole body", form, {});
+
+    // every chunk size up to a bit more than the delimiter, boundaries land everywhere
+    for (size_t size = 1; size <= delimiter.size() + 8; size++)
+        compare(server, "fixed chunks", form, {size});
+
+    // the CR of the delimiter is the last byte of one receive, the LF the first of the next
+    std::string body = multipart(form);
+    size_t cr = body.find(delimiter, body.find("firmware.bin"));
+    compare(server, "CR at the chunk edge", form, endingAt(cr + 1, body.size()));
+    compare(server, "CRLF at the chunk edge", form, endingAt(cr + 2, body.size()));
+    compare(server, "dashes at the chunk edge", form, endingAt(cr + 4, body.size()));
+
+    // data with everything that starts like the delimiter, also right before the real one. The whole
+    // delimiter can't be in the data, senders pick a boundary that isn't.
+    std::string lookalike = "a\rb\r\nc\r\n-d\r\n--e\r\n--" + std::string(BOUNDARY).substr(0, 10) + "f";
+    lookalike += delimiter.substr(0, delimiter.size() - 1) + "g\r";
+    std::vector<Part> tricky = {{"note", "", lookalike},
+                                {"file", "tricky.bin", lookalike + randomData(9000, 2) + lookalike + "\r\n"},
+                                {"empty", "", ""},
+                                {"nothing", "nothing.bin", ""}};
+    compare(server, "delimiter prefixes", tricky, {});
+    for (unsigned seed = 0; seed < 200; seed++)
+    {
+        std::mt19937 random(seed);
+        std::vector<size_t> chunks;
+        for (int i = 0; i < 64; i++)
+            chunks.push_back(random() % 3 ? random() % 40 + 1 : random() % 3000 + 1);
+        compare(server, "random chunks", tricky, chunks);
+        compare(server, "random chunks", form, chunks);
+    }
+
+    // a 1 MB file the way it comes off the socket
+    std::vector<Part> large = {{"file", "littlefs.bin", randomData(1024 * 1024, 3)}};
+    body = multipart(large);
+    compare(server, "1 MB", large, {1436});
+
+    uint32_t times[2];
+    for (int bytewise = 1; bytewise >= 0; bytewise--)
+    {
+        uint32_t start = micros();
+        for (int i = 0; i < 5; i++)
+            upload(server, body, {1436}, bytewise);
+        times[bytewise] = (micros() - start) / 5;
+    }
+    printf("1 MB multipart upload: byte-wise %.1f ms, block-wise %.1f ms\n", times[1] / 1000.0, times[0] / 1000.0);
+
+    return finish();
+}
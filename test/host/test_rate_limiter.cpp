@@ -0,0 +1,94 @@
+/**
+ * The token buckets of RateLimiter with the clock of millis() stopped and moved on by hand: the
+ * burst, the refill at the rate, the eviction of the client seen least recently once all buckets
+ * are taken, and the key of IPv4 peers with and without IPv6 in lwIP.
+ */
+
+#include "harness.h"
+#include <RateLimiter.h>
+#include <lwip/sockets.h>
+
+static int allowedOf(RateLimiter &limiter, uint32_t key, int requests)
+{
+    int allowed = 0;
+    for (int i = 0; i < requests; i++)
+        allowed += limiter.allow(key);
+    return allowed;
+}
+
+int main()
+{
+    hostClockStopped = true;
+    hostMillis = 1000;
+    const uint32_t client = IPAddress(192, 168, 1, 10);
+
+    // a full bucket of burst tokens, then nothing until the rate refills it
+    RateLimiter signIn("sign in", 1, 5);
+    CHECK(allowedOf(signIn, client, 8) == 5);
+    CHECK(signIn.allowed() == 5 && signIn.limited() == 3);
+    hostMillis += 999;
+    CHECK(!signIn.allow(client));
+    hostMillis += 1;
+    CHECK(signIn.allow(client));
+    CHECK(!signIn.allow(client));
+
+    // the refill stops at the burst, also after a long pause and across the wrap of millis()
+    hostMillis = 0xffffff00;
+    CHECK(allowedOf(signIn, client, 8) == 5);
+    hostMillis += 5000;
+    CHECK(allowedOf(signIn, client, 8) == 5);
+
+    // 20 per second is one token every 50 ms, partial tokens add up
+    RateLimiter api("api", 20, 40);
+    CHECK(allowedOf(api, client, 50) == 40);
+    hostMillis += 30;
+    CHECK(!api.allow(client));
+    hostMillis += 20;
+    CHECK(api.allow(client));
+    hostMillis += 500;
+    CHECK(allowedOf(api, client, 20) == 10);
+
+    // other clients have buckets of their own
+    CHECK(allowedOf(api, IPAddress(192, 168, 1, 11), 50) == 40);
+
+    // a rate of 0 is no limit
+    RateLimiter off("off", 0, 1);
+    CHECK(allowedOf(off, client, 1000) == 1000);
+
+    // with every bucket taken the client seen least recently is replaced and starts over
+    RateLimiter limiter("events", 1, 3, false);
+    CHECK(allowedOf(limiter, 1, 5) == 3);
+    for (uint32_t socket = 2; socket <= RATE_LIMIT_CLIENTS; socket++)
+    {
+        hostMillis += 1;
+        CHECK(limiter.allow(socket));
+    }
+    hostMillis += 1;
+    CHECK(!limiter.allow(1));
+    hostMillis += 1;
+    CHECK(limiter.allow(100));
+    CHECK(!limiter.allow(1));
+    hostMillis += 1;
+    for (uint32_t socket = 200; socket < 200 + RATE_LIMIT_CLIENTS; socket++)
+        CHECK(limiter.allow(socket));
+    CHECK(allowedOf(limiter, 1, 5) == 3);
+
+    // a closed socket is forgotten, the next one with its number gets a full bucket
+    CHECK(allowedOf(limiter, 1, 5) == 0);
+    limiter.remove(1);
+    CHECK(allowedOf(limiter, 1, 5) == 3);
+
+    JsonDocument doc;
+    JsonObject root = doc.to<JsonObject>();
+    limiter.read(root);
+    CHECK(root["rate"].as<uint32_t>() == 1 && root["burst"].as<uint32_t>() == 3);
+
+    // the same IPv4 peer as ::ffff:a.b.c.d and as a plain IPv4 address, an unknown peer is its socket
+    hostSockets[60].peer = hostAddress6(client);
+    hostSockets[61].peer = hostAddress4(client);
+    CHECK(RateLimiter::peerKey(61) == client);
+    CHECK(RateLimiter::peerKey(60) == client);
+    CHECK(RateLimiter::peerKey(62) == 62);
+
+    return finish();
+}
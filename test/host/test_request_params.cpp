@@ -0,0 +1,247 @@
+/**
+ * Heap allocations for the parameters of one request. malloc() is replaced by a counting one, which
+ * libstdc++ and the library go through as well.
+ *
+ * The baseline is the code before the parameters moved into the arena for good: the pairs were cut
+ * into String substrings, decoded into the arena, copied into the String members of the parameter
+ * and every parameter took a std::list node. Now the parameters and their decoded strings are
+ * arena spans chained through the parameters themselves.
+ */
+
+#include "harness.h"
+#include <PsychicHttp.h>
+#include <list>
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+static size_t allocations;
+static long live;
+
+extern "C" void *malloc(size_t size)
+{
+    allocations++;
+    live++;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    allocations++;
+    live++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    allocations++;
+    if (ptr == NULL)
+        live++;
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void *ptr)
+{
+    if (ptr != NULL)
+        live--;
+    __libc_free(ptr);
+}
+
+// a JWT in the query, like the WebSocket and event source clients send it
+static const char *URI = "/rest/item/a%20b?access_token=eyJhbGciOiJIUzI1NiIsInR5cCI6IkpXVCJ9."
+                         "eyJ1c2VybmFtZSI6ImFkbWluIiwiYWRtaW4iOnRydWV9.nHrz2c8vOI1f8QzYxCcRlmVD6Vm3hZ5Ka8bFZ_6qMtY"
+                         "&format=json&note=hello%20world%21";
+static const char *BODY = "username=admin&password=s3cr3t%21&remember=on&redirect=%2Fsettings%2Fwifi%2Fnetworks";
+
+// the router hands the request handler spans into the uri
+static const char *ROUTE_VALUE = URI + strlen("/rest/item/");
+static const size_t ROUTE_LENGTH = strlen("a%20b");
+
+class BaselineParameter
+{
+public:
+    BaselineParameter(const String &name, const String &value, bool form) : _name(name), _value(value), _size(0), _isForm(form), _isFile(false) {}
+    const String &name() const { return _name; }
+    const String &value() const { return _value; }
+
+private:
+    String _name;
+    String _value;
+    size_t _size;
+    bool _isForm;
+    bool _isFile;
+};
+
+class TestRequest : public PsychicRequest
+{
+public:
+    using PsychicRequest::PsychicRequest;
+    using PsychicRequest::_addParam;
+
+    ~TestRequest()
+    {
+        for (auto *param : _baseline)
+            param->~BaselineParameter();
+    }
+
+    // PsychicHttpServer::requestHandler() and loadParams() as they were
+    void baselineParams()
+    {
+        String value;
+        value.concat(ROUTE_VALUE, ROUTE_LENGTH);
+        baselineAddParam("id", value, true, false);
+
+        size_t query_len = httpd_req_get_url_query_len(_req);
+        if (query_len)
+        {
+            char query[query_len + 1];
+            httpd_req_get_url_query_str(_req, query, sizeof(query));
+            _query.clear();
+            _query.concat(query);
+            baselineAddParams(_query, false);
+        }
+
+        if (this->method() == HTTP_POST && this->contentType().startsWith("application/x-www-form-urlencoded"))
+            baselineAddParams(_body, true);
+    }
+
+    BaselineParameter *baselineGetParam(const char *key)
+    {
+        for (auto *param : _baseline)
+            if (param->name().equals(key))
+                return param;
+        return NULL;
+    }
+
+private:
+    std::list<BaselineParameter *> _baseline;
+
+    void baselineAddParams(const String &params, bool post)
+    {
+        size_t start = 0;
+        while (start < params.length())
+        {
+            int end = params.indexOf('&', start);
+            if (end < 0)
+                end = params.length();
+            int equal = params.indexOf('=', start);
+            if (equal < 0 || equal > end)
+                equal = end;
+            String name = params.substring(start, equal);
+            String value = equal + 1 < end ? params.substring(equal + 1, end) : String();
+            baselineAddParam(name, value, true, post);
+            start = end + 1;
+        }
+    }
+
+    void baselineAddParam(const String &name, const String &value, bool decode, bool post)
+    {
+        char *decodedName = (char *)_arena.alloc(name.length() + 1);
+        char *decodedValue = (char *)_arena.alloc(value.length() + 1);
+        _baseline.push_back(_arena.create<BaselineParameter>(urlDecode(name.c_str(), decodedName), urlDecode(value.c_str(), decodedValue), post));
+    }
+};
+
+static HostRequest *formRequest()
+{
+    HostRequest *req = new HostRequest(HTTP_POST, URI, BODY);
+    req->header("Content-Type", "application/x-www-form-urlencoded");
+    return req;
+}
+
+static size_t baselineAllocations(PsychicHttpServer &server)
+{
+    HostRequest *req = formRequest();
+    TestRequest *request = new TestRequest(&server, req);
+    request->loadBody();
+
+    size_t before = allocations;
+    request->baselineParams();
+    size_t count = allocations - before;
+
+    CHECK(request->baselineGetParam("id") != NULL && request->baselineGetParam("id")->value() == "a b");
+    CHECK(request->baselineGetParam("redirect")->value() == "/settings/wifi/networks");
+
+    delete request;
+    delete req;
+    return count;
+}
+
+static size_t paramAllocations(PsychicHttpServer &server)
+{
+    HostRequest *req = formRequest();
+    TestRequest *request = new TestRequest(&server, req);
+    request->loadBody();
+
+    size_t before = allocations;
+    request->_addParam("id", 2, ROUTE_VALUE, ROUTE_LENGTH, true, false);
+    request->loadParams();
+    size_t count = allocations - before;
+
+    // the same parameters in the same order
+    const char *names[] = {"id", "access_token", "format", "note", "username", "password", "remember", "redirect"};
+    size_t i = 0;
+    for (PsychicWebParameter *param = request->params(); param != NULL; param = param->next())
+        CHECK(i < 8 && strcmp(param->name(), names[i++]) == 0);
+    CHECK(i == 8);
+
+    CHECK(strcmp(request->getParam("id")->value(), "a b") == 0);
+    CHECK(strcmp(request->getParam("note")->value(), "hello world!") == 0);
+    CHECK(strcmp(request->getParam("password")->value(), "s3cr3t!") == 0);
+    CHECK(strcmp(request->getParam("redirect")->value(), "/settings/wifi/networks") == 0);
+    CHECK(!request->getParam("format")->isPost() && request->getParam("remember")->isPost());
+    CHECK(request->getParam("missing") == NULL);
+
+    delete request;
+    delete req;
+    return count;
+}
+
+int main()
+{
+    PsychicHttpServer server;
+    server.listen(80);
+
+    // httpd announces the connection before the first request on it
+    HostRequest connection(HTTP_GET, "/");
+    PsychicHttpServer::openCallback(server.server, connection.socket);
+
+    // through the router, the path parameter is decoded like the others
+    String seen;
+    server.on("/rest/item/{id}", HTTP_POST, [&seen](PsychicRequest *request) {
+        seen = String(request->getParam("id")->value()) + "|" + request->getParam("username")->value();
+        return request->reply(200);
+    });
+
+    HostRequest *req = formRequest();
+    req->handle = server.server;
+    size_t before = allocations;
+    CHECK(PsychicHttpServer::requestHandler(req) == ESP_OK);
+    size_t requestAllocations = allocations - before;
+    CHECK(seen == "a b|admin");
+    delete req;
+
+    // the parameters built from Strings, like the uploaded files, are deleted with the request
+    long liveBefore = live;
+    req = formRequest();
+    {
+        TestRequest request(&server, req);
+        request.addParam(new PsychicWebParameter("upload", "firmware.bin", true, true, 1234));
+        request.addParam("plain", "a%20b", false);
+        CHECK(strcmp(request.getParam("upload")->value(), "firmware.bin") == 0 && request.getParam("upload")->isFile());
+        CHECK(strcmp(request.getParam("plain")->value(), "a%20b") == 0);
+    }
+    delete req;
+    CHECK(live == liveBefore);
+
+    size_t baseline = baselineAllocations(server);
+    size_t now = paramAllocations(server);
+    printf("8 parameters, %u bytes of query and form: %u allocations before, %u now (%u for the whole request)\n",
+           (unsigned)(strlen(URI) + strlen(BODY)), (unsigned)baseline, (unsigned)now, (unsigned)requestAllocations);
+    CHECK(now < baseline);
+
+    server.stop();
+    return finish();
+}
@@ -0,0 +1,113 @@
+/**
+ * Router lookups against the linear httpd_uri_match_wildcard() scan it replaces, with 200 routes.
+ * Also checks the match priority static > parameter > wildcard.
+ */
+
+#include "harness.h"
+#include <PsychicRouter.h>
+#include <vector>
+
+struct LinearRoute
+{
+    String uri;
+    http_method method;
+    PsychicEndpoint *endpoint;
+};
+
+// what httpd did before: the first handler in registration order that matches
+static PsychicEndpoint *linearFind(std::vector<LinearRoute> &routes, const char *path, size_t len, http_method method)
+{
+    for (LinearRoute &route : routes)
+    {
+        if (route.method == method && httpd_uri_match_wildcard(route.uri.c_str(), path, len))
+            return route.endpoint;
+    }
+    return NULL;
+}
+
+static PsychicEndpoint *endpoint(size_t i)
+{
+    return (PsychicEndpoint *)(uintptr_t)(i + 1);
+}
+
+int main()
+{
+    PsychicRouter router;
+    std::vector<LinearRoute> linear;
+    std::vector<String> paths;
+
+    // a mix like the framework registers: REST endpoints, SvelteKit assets and a few catch-alls
+    for (size_t i = 0; i < 200; i++)
+    {
+        char uri[64];
+        http_method method = HTTP_GET;
+        if (i < 60)
+            snprintf(uri, sizeof(uri), "/rest/service%u", (unsigned)i);
+        else if (i < 120)
+        {
+            snprintf(uri, sizeof(uri), "/rest/service%u", (unsigned)(i - 60));
+            method = HTTP_POST;
+        }
+        else if (i < 190)
+            snprintf(uri, sizeof(uri), "/_app/immutable/chunks/asset%u.js", (unsigned)(i - 120));
+        else
+            snprintf(uri, sizeof(uri), "/files%u/*", (unsigned)(i - 190));
+
+        CHECK(router.insert(uri, method, endpoint(i)));
+        linear.push_back({uri, method, endpoint(i)});
+
+        String path(uri);
+        if (path.endsWith("*"))
+        {
+            path.remove(path.length() - 1);
+            path += "some/file.txt";
+        }
+        paths.push_back(path);
+    }
+    CHECK(router.count() == 200);
+
+    // both must agree on every route, they have no overlapping templates
+    PsychicRouteParams params;
+    for (size_t i = 0; i < linear.size(); i++)
+    {
+        const String &path = paths[i];
+        CHECK(router.find(path.c_str(), path.length(), linear[i].method, params) == endpoint(i));
+        CHECK(linearFind(linear, path.c_str(), path.length(), linear[i].method) == endpoint(i));
+    }
+
+    const size_t rounds = 2000;
+    size_t found = 0;
+
+    uint32_t start = micros();
+    for (size_t round = 0; round < rounds; round++)
+        for (size_t i = 0; i < paths.size(); i++)
+            found += linearFind(linear, paths[i].c_str(), paths[i].length(), linear[i].method) != NULL;
+    uint32_t linearTime = micros() - start;
+
+    start = micros();
+    for (size_t round = 0; round < rounds; round++)
+        for (size_t i = 0; i < paths.size(); i++)
+            found += router.find(paths[i].c_str(), paths[i].length(), linear[i].method, params) != NULL;
+    uint32_t routerTime = micros() - start;
+
+    CHECK(found == 2 * rounds * paths.size());
+
+    size_t lookups = rounds * paths.size();
+    printf("200 routes, %u lookups: linear scan %.0f ns, radix tree %.0f ns per lookup\n",
+           (unsigned)lookups, linearTime * 1000.0 / lookups, routerTime * 1000.0 / lookups);
+
+    // overlapping routes no longer match in registration order
+    PsychicRouter priority;
+    CHECK(priority.insert("/item/*", HTTP_GET, endpoint(0)));
+    CHECK(priority.insert("/item/{id}", HTTP_GET, endpoint(1)));
+    CHECK(priority.insert("/item/new", HTTP_GET, endpoint(2)));
+    CHECK(priority.find("/item/new", 9, HTTP_GET, params) == endpoint(2));
+    CHECK(priority.find("/item/42", 8, HTTP_GET, params) == endpoint(1));
+    CHECK(params.size() == 1 && params[0].length == 2 && !strncmp(params[0].value, "42", 2));
+    CHECK(priority.find("/item/42/x", 10, HTTP_GET, params) == endpoint(0));
+
+    bool exists = false;
+    CHECK(priority.find("/item/new", 9, HTTP_POST, params, &exists) == NULL && exists);
+
+    return finish();
+}
@@ -0,0 +1,123 @@
+/**
+ * The filesystem and NVS calls of a boot that reads the settings of the framework, built once
+ * storing them as files and once with SETTINGS_USE_NVS. The NVS build first migrates the settings
+ * files, which are kept for one boot and removed on the next. With SERVE_CONFIG_FILES both export
+ * every settings file as JSON.
+ */
+
+#include "harness.h"
+#include "settings_documents.h"
+#include <esp_rom_crc.h>
+
+#if FT_ENABLED(SETTINGS_USE_NVS)
+static const char *MODE = "NVS";
+#else
+static const char *MODE = "files";
+#endif
+
+// the services of one boot, reading their settings like ESP32SvelteKit::begin() does
+struct Boot
+{
+    StatefulService<Settings> services[COUNT];
+    std::unique_ptr<FSPersistence<Settings>> persistence[COUNT];
+
+    Boot(fs::FS &fs)
+    {
+        for (size_t i = 0; i < COUNT; i++)
+        {
+            persistence[i].reset(new FSPersistence<Settings>(Settings::read, Settings::update, &services[i], &fs, SETTINGS[i][0], 0, 0));
+            persistence[i]->readFromFS();
+        }
+    }
+
+    bool matches()
+    {
+        bool same = true;
+        for (size_t i = 0; i < COUNT; i++)
+        {
+            JsonDocument expected;
+            deserializeJson(expected, SETTINGS[i][1]);
+            String read, written;
+            services[i].read([&read](Settings &settings) { serializeJson(settings.document, read); });
+            serializeJson(expected, written);
+            same = same && read == written;
+        }
+        return same;
+    }
+};
+
+// settings files as the version before wrote them, MessagePack with a CRC trailer
+static void storeFiles(fs::FS &fs)
+{
+    fs.mkdir("/config");
+    for (size_t i = 0; i < COUNT; i++)
+    {
+        JsonDocument document;
+        deserializeJson(document, SETTINGS[i][1]);
+        std::vector<uint8_t> data(measureMsgPack(document));
+        serializeMsgPack(document, (char *)data.data(), data.size());
+        char trailer[FS_CHECKSUM_SIZE + 1];
+        snprintf(trailer, sizeof(trailer), FS_CHECKSUM_PREFIX "%08x\n", (unsigned int)esp_rom_crc32_le(0, data.data(), data.size()));
+        data.insert(data.end(), trailer, trailer + FS_CHECKSUM_SIZE);
+
+        String path(SETTINGS[i][0]);
+        path.replace(FS_JSON_EXTENSION, FS_MSGPACK_EXTENSION);
+        fs.storage().files[path.c_str()].data = data;
+    }
+}
+
+static void report(fs::FS &fs, const char *boot)
+{
+    auto &counts = fs.storage().counts;
+    printf("%s, %s: %u exists, %u open, %u rename, %u remove, %u NVS reads, %u NVS writes\n", MODE, boot, counts.exists,
+           counts.open, counts.rename, counts.remove, hostNvs.counts.get, hostNvs.counts.set);
+    counts = {};
+    hostNvs.counts = {};
+}
+
+int main()
+{
+    fs::FS flash;
+    storeFiles(flash);
+
+    // the first boot of this version, with NVS it migrates the files and keeps them
+    {
+        Boot boot(flash);
+        CHECK(boot.matches());
+    }
+    report(flash, "first boot");
+    CHECK(flash.storage().files.size() == COUNT);
+
+    // with NVS the next boot removes the files
+    {
+        Boot boot(flash);
+        CHECK(boot.matches());
+    }
+    report(flash, "second boot");
+    CHECK(flash.storage().files.size() == (FT_ENABLED(SETTINGS_USE_NVS) ? 0 : COUNT));
+
+    // every boot after that
+    {
+        Boot boot(flash);
+        CHECK(boot.matches());
+    }
+    auto counts = flash.storage().counts;
+    CHECK(counts.open == (FT_ENABLED(SETTINGS_USE_NVS) ? 0 : COUNT));
+    CHECK(counts.rename == 0 && counts.remove == 0 && hostNvs.counts.set == 0);
+    report(flash, "later boots");
+
+    // what the /config/ route of SERVE_CONFIG_FILES exports
+    for (size_t i = 0; i < COUNT; i++)
+    {
+        JsonDocument exported, expected;
+        CHECK(FSPersistenceBase::exportJSON(&flash, SETTINGS[i][0], exported));
+        deserializeJson(expected, SETTINGS[i][1]);
+        String a, b;
+        serializeJson(exported, a);
+        serializeJson(expected, b);
+        CHECK(a == b);
+    }
+
+    FSPersistenceBase::shutdown(false);
+    return finish();
+}
@@ -0,0 +1,84 @@
+/**
+ * readFromFS() of the settings files of the framework, built once with SETTINGS_USE_JSON and once
+ * without, which stores them as MessagePack. The documents are shaped like the WiFi, AP, Ethernet,
+ * NTP, MQTT and security settings with a few networks and users. Each build writes them through
+ * FSPersistence and times reading all of them back, like a boot does.
+ */
+
+#include "harness.h"
+#include "settings_documents.h"
+
+#if FT_ENABLED(SETTINGS_USE_JSON)
+static const char *FORMAT = "JSON";
+#else
+static const char *FORMAT = "MessagePack";
+#endif
+
+int main()
+{
+    fs::FS storage;
+    storage.mkdir("/config");
+
+    StatefulService<Settings> services[COUNT];
+    std::unique_ptr<FSPersistence<Settings>> persistence[COUNT];
+    for (size_t i = 0; i < COUNT; i++)
+    {
+        persistence[i].reset(new FSPersistence<Settings>(Settings::read, Settings::update, &services[i], &storage, SETTINGS[i][0], 0, 0));
+        services[i].updateWithoutPropagation([i](Settings &settings) {
+            deserializeJson(settings.document, SETTINGS[i][1]);
+            return StateUpdateResult::CHANGED;
+        }, "test");
+        CHECK(persistence[i]->writeToFS());
+    }
+
+    size_t bytes = 0;
+    for (const auto &file : storage.storage().files)
+        bytes += file.second.data.size();
+    CHECK(storage.storage().files.size() == COUNT);
+
+    // every file reads back to what was written
+    for (size_t i = 0; i < COUNT; i++)
+    {
+        services[i].updateWithoutPropagation([](Settings &settings) {
+            settings.document.clear();
+            return StateUpdateResult::CHANGED;
+        }, "test");
+        persistence[i]->readFromFS();
+
+        JsonDocument expected;
+        deserializeJson(expected, SETTINGS[i][1]);
+        String read, written;
+        services[i].read([&read](Settings &settings) { serializeJson(settings.document, read); });
+        serializeJson(expected, written);
+        CHECK(read == written);
+    }
+    CHECK(storage.storage().files.size() == COUNT);
+
+    const int rounds = 5000;
+    uint32_t start = micros();
+    for (int round = 0; round < rounds; round++)
+        for (size_t i = 0; i < COUNT; i++)
+            persistence[i]->readFromFS();
+    uint32_t boot = micros() - start;
+
+    // the part of it that depends on the format, parsing the files without their checksum
+    start = micros();
+    for (int round = 0; round < rounds; round++)
+    {
+        for (const auto &file : storage.storage().files)
+        {
+            JsonDocument document;
+            const uint8_t *data = file.second.data.data();
+            size_t len = file.second.data.size() - FS_CHECKSUM_SIZE;
+            DeserializationError error = FT_ENABLED(SETTINGS_USE_JSON) ? deserializeJson(document, data, len) : deserializeMsgPack(document, data, len);
+            CHECK(error == DeserializationError::Ok);
+        }
+    }
+    uint32_t parse = micros() - start;
+
+    printf("%s settings, %u files with %u bytes: readFromFS %.1f us for all, parsing %.1f us of it\n", FORMAT, (unsigned)COUNT,
+           (unsigned)bytes, boot * 1.0 / rounds, parse * 1.0 / rounds);
+
+    FSPersistenceBase::shutdown(false);
+    return finish();
+}
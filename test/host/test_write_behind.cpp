@@ -0,0 +1,127 @@
+/**
+ * The write-behind of FSPersistence with the clock of millis() stopped and moved on by hand. A burst
+ * of changes is written once after the quiet period, settings that keep changing are written at
+ * the max write delay, flushAll() writes at once and a write delay of 0 writes on every change.
+ * The writer task wakes within a tick of its deadline, so the checks look one tick on either side.
+ */
+
+#include "harness.h"
+#include <FSPersistence.h>
+#include <thread>
+
+struct Settings
+{
+    int brightness = 0;
+
+    static void read(Settings &settings, JsonObject &root)
+    {
+        root["brightness"] = settings.brightness;
+    }
+
+    static StateUpdateResult update(JsonObject &root, Settings &settings, const String &originId)
+    {
+        settings.brightness = root["brightness"] | 0;
+        return StateUpdateResult::CHANGED;
+    }
+};
+
+static fs::FS storage;
+static StatefulService<Settings> service;
+
+static void set(int brightness)
+{
+    service.update([brightness](Settings &settings) {
+        settings.brightness = brightness;
+        return StateUpdateResult::CHANGED;
+    }, "slider");
+}
+
+// real time for the writer task to catch up with the clock
+static void settle()
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+}
+
+static void advanceTo(uint32_t now)
+{
+    hostMillis = now;
+    settle();
+}
+
+static std::string stored(const char *path)
+{
+    auto &files = storage.storage().files;
+    auto it = files.find(path);
+    return it == files.end() ? "" : std::string(it->second.data.begin(), it->second.data.end());
+}
+
+int main()
+{
+    hostClockStopped = true;
+    hostMillis = 10000;
+    storage.mkdir("/config");
+
+    FSPersistence<Settings> persistence(Settings::read, Settings::update, &service, &storage, "/config/light.json", 500, 5000);
+
+    // a slider, a change every 100 ms, only the last value is written 500 ms after it
+    uint32_t writes = FSPersistenceBase::writeCount();
+    for (int i = 1; i <= 10; i++)
+    {
+        set(i * 10);
+        if (i < 10)
+            advanceTo(hostMillis + 100);
+    }
+    settle();
+    uint32_t lastChange = hostMillis;
+    CHECK(FSPersistenceBase::writeCount() == writes);
+    advanceTo(lastChange + 499);
+    CHECK(FSPersistenceBase::writeCount() == writes);
+    advanceTo(lastChange + 501);
+    CHECK(FSPersistenceBase::writeCount() == writes + 1);
+    CHECK(stored("/config/light.msgpack").size() > 0);
+
+    // nothing more to write without changes
+    advanceTo(lastChange + 10000);
+    CHECK(FSPersistenceBase::writeCount() == writes + 1);
+
+    // changing every 400 ms never gets quiet, the max write delay forces a write 5000 ms after the first change
+    writes = FSPersistenceBase::writeCount();
+    uint32_t firstChange = hostMillis;
+    for (uint32_t now = firstChange; now < firstChange + 5000; now += 400)
+    {
+        advanceTo(now);
+        set(now - firstChange);
+    }
+    advanceTo(firstChange + 4999);
+    CHECK(FSPersistenceBase::writeCount() == writes);
+    advanceTo(firstChange + 5001);
+    CHECK(FSPersistenceBase::writeCount() == writes + 1);
+
+    // flushAll() writes pending changes at once
+    writes = FSPersistenceBase::writeCount();
+    set(77);
+    FSPersistenceBase::flushAll();
+    CHECK(FSPersistenceBase::writeCount() == writes + 1);
+    advanceTo(hostMillis + 10000);
+    CHECK(FSPersistenceBase::writeCount() == writes + 1);
+
+    JsonDocument doc;
+    CHECK(FSPersistenceBase::exportJSON(&storage, "/config/light.json", doc));
+    CHECK(doc["brightness"].as<int>() == 77);
+
+    // a write delay of 0 writes synchronously on every change
+    StatefulService<Settings> direct;
+    FSPersistence<Settings> immediate(Settings::read, Settings::update, &direct, &storage, "/config/direct.json", 0, 0);
+    writes = FSPersistenceBase::writeCount();
+    for (int i = 0; i < 5; i++)
+    {
+        direct.update([i](Settings &settings) {
+            settings.brightness = i;
+            return StateUpdateResult::CHANGED;
+        }, "test");
+    }
+    CHECK(FSPersistenceBase::writeCount() == writes + 5);
+
+    FSPersistenceBase::shutdown();
+    return finish();
+}